@@ -0,0 +1,203 @@
+#include "Bench.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <sstream>
+
+#include "Arguments.hpp"
+
+namespace {
+struct Benchmark {
+  std::string name;
+  std::vector<size_t> sizes;
+  std::function<BenchCase(size_t)> setup;
+};
+
+std::vector<Benchmark>& Registry() {
+  static std::vector<Benchmark> benchmarks;
+  return benchmarks;
+}
+
+// Seconds per call, the fastest of a few batches of at least min_time
+double Time(const BenchCase& c, double min_time) {
+  using Clock = std::chrono::steady_clock;
+  const auto seconds = [](Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+  };
+
+  c.run();  // Warm up caches and lazily grown buffers
+  size_t calls = 1;
+  for (;;) {
+    const auto start = Clock::now();
+    for (size_t i = 0; i < calls; ++i) c.run();
+    const auto elapsed = seconds(start);
+    if (elapsed >= min_time) break;
+    calls = elapsed > 0 ? size_t(calls * std::min(10., 1.2 * min_time / elapsed)) + 1
+                        : calls * 10;
+  }
+
+  auto best = 1e30;
+  for (int batch = 0; batch < 3; ++batch) {
+    const auto start = Clock::now();
+    for (size_t i = 0; i < calls; ++i) c.run();
+    best = std::min(best, seconds(start) / calls);
+  }
+  return best;
+}
+
+// Counts per item over about min_time of calls
+PerfCounters::Values Count(const BenchCase& c, double seconds,
+                           double min_time) {
+  // Opened now, so the workers the setup started are counted too
+  const PerfCounters counters;
+  const auto calls = std::max(size_t(min_time / seconds), size_t(1));
+  const auto before = counters.Read();
+  for (size_t i = 0; i < calls; ++i) c.run();
+  const auto after = counters.Read();
+
+  PerfCounters::Values values;
+  for (int event = 0; event < PerfCounters::kEventCount; ++event) {
+    values[event] = (after[event] - before[event]) / calls / c.items;
+  }
+  return values;
+}
+
+std::string Key(const std::string& name, size_t size) {
+  return name + "/" + std::to_string(size);
+}
+
+// Value of "field": in one line of our own output, empty if absent
+std::string Field(const std::string& line, const std::string& field) {
+  const auto key = "\"" + field + "\": ";
+  const auto start = line.find(key);
+  if (start == std::string::npos) return {};
+  auto begin = start + key.size();
+  if (line[begin] == '"') {
+    ++begin;
+    return line.substr(begin, line.find('"', begin) - begin);
+  }
+  return line.substr(begin, line.find_first_of(",}", begin) - begin);
+}
+}  // namespace
+
+void RegisterBenchmark(const std::string& name,
+                       const std::vector<size_t>& sizes,
+                       std::function<BenchCase(size_t)> setup) {
+  Registry().push_back({name, sizes, std::move(setup)});
+}
+
+std::vector<BenchResult> RunBenchmarks(const std::string& filter,
+                                       double min_time, bool perf) {
+  std::vector<BenchResult> results;
+  std::cout << std::left << std::setw(32) << "benchmark" << std::right
+            << std::setw(8) << "size" << std::setw(14) << "time/call"
+            << std::setw(14) << "items/s" << std::setw(14) << "bytes/s"
+            << std::endl;
+  for (const auto& b : Registry()) {
+    if (b.name.find(filter) == std::string::npos) continue;
+    for (const auto size : b.sizes) {
+      const auto c = b.setup(size);
+      const auto seconds = Time(c, min_time);
+      PerfCounters::Values counters;
+      counters.fill(std::numeric_limits<double>::quiet_NaN());
+      if (perf) counters = Count(c, seconds, min_time);
+      results.push_back({b.name, size, c.items, seconds, c.items / seconds,
+                         c.bytes / seconds, counters});
+      const auto& r = results.back();
+      std::cout << std::left << std::setw(32) << r.name << std::right
+                << std::setw(8) << r.size << std::setw(14) << r.seconds
+                << std::setw(14) << r.items_per_second << std::setw(14)
+                << r.bytes_per_second << std::endl;
+      for (int event = 0; event < PerfCounters::kEventCount; ++event) {
+        if (std::isnan(r.counters[event])) continue;
+        std::cout << "    " << PerfCounters::GetName(event)
+                  << "/item: " << r.counters[event] << std::endl;
+      }
+    }
+  }
+  return results;
+}
+
+bool WriteResults(const std::string& path,
+                  const std::vector<BenchResult>& results) {
+  std::ofstream file(path);
+  if (!file) {
+    std::cerr << "Cannot write " << path << std::endl;
+    return false;
+  }
+  // One benchmark per line, so ReadBaseline() needs no JSON parser
+  file << "{\n  \"benchmarks\": [\n";
+  for (size_t i = 0; i < results.size(); ++i) {
+    const auto& r = results[i];
+    file << "    {\"name\": \"" << r.name << "\", \"size\": " << r.size
+         << ", \"items\": " << r.items << ", \"seconds\": " << r.seconds
+         << ", \"items_per_second\": " << r.items_per_second
+         << ", \"bytes_per_second\": " << r.bytes_per_second;
+    for (int event = 0; event < PerfCounters::kEventCount; ++event) {
+      if (std::isnan(r.counters[event])) continue;
+      file << ", \"" << PerfCounters::GetName(event)
+           << "_per_item\": " << r.counters[event];
+    }
+    file << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+  }
+  file << "  ]\n}\n";
+  return bool(file);
+}
+
+bool ReadBaseline(const std::string& path,
+                  std::map<std::string, double>& baseline) {
+  baseline.clear();
+  std::ifstream file(path);
+  if (!file) {
+    std::cerr << "Cannot read " << path << std::endl;
+    return false;
+  }
+  for (std::string line; std::getline(file, line);) {
+    const auto name = Field(line, "name"), size = Field(line, "size"),
+               rate = Field(line, "items_per_second");
+    if (name.empty() && size.empty() && rate.empty()) continue;
+    unsigned long n;
+    float items_per_second;
+    if (name.empty() || !ParseNumber(size.c_str(), n) ||
+        !ParseNumber(rate.c_str(), items_per_second)) {
+      std::cerr << "Not a benchmark result in " << path << ": " << line
+                << std::endl;
+      return false;
+    }
+    baseline[Key(name, n)] = items_per_second;
+  }
+  if (file.bad() || baseline.empty()) {
+    std::cerr << "No benchmark results in " << path << std::endl;
+    return false;
+  }
+  return true;
+}
+
+size_t CompareBaseline(const std::vector<BenchResult>& results,
+                       const std::map<std::string, double>& baseline,
+                       double tolerance) {
+  size_t regressions = 0;
+  for (const auto& r : results) {
+    const auto it = baseline.find(Key(r.name, r.size));
+    if (it == baseline.end() || it->second <= 0) continue;
+    const auto ratio = r.items_per_second / it->second;
+    if (ratio < 1 - tolerance) {
+      ++regressions;
+      std::cout << "Regression: " << Key(r.name, r.size) << " at "
+                << std::setprecision(3) << ratio << "x the baseline"
+                << std::endl;
+    } else if (ratio > 1 + tolerance) {
+      std::cout << "Faster: " << Key(r.name, r.size) << " at "
+                << std::setprecision(3) << ratio << "x the baseline"
+                << std::endl;
+    }
+  }
+  return regressions;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "PerfCounters.hpp"
+
+/**
+ * One problem size of a benchmark, ready to run
+ * items and bytes are what one call of run() processes. Bytes count each
+ * item's data once, so bytes/s is a lower bound on memory traffic.
+ */
+struct BenchCase {
+  std::function<void()> run;
+  double items = 0, bytes = 0;
+};
+
+struct BenchResult {
+  std::string name;
+  size_t size;
+  double items, seconds;  // seconds per call
+  double items_per_second, bytes_per_second;
+  PerfCounters::Values counters;  // Per item, NaN where not counted
+};
+
+/**
+ * Benchmark run at each of sizes, setup builds the state for one size
+ */
+void RegisterBenchmark(const std::string& name,
+                       const std::vector<size_t>& sizes,
+                       std::function<BenchCase(size_t)> setup);
+
+/**
+ * Benchmarks whose name contains filter, each call timed over min_time
+ * Prints a table as it goes. With perf, hardware counters are read over
+ * another min_time of calls.
+ */
+std::vector<BenchResult> RunBenchmarks(const std::string& filter,
+                                       double min_time, bool perf = false);
+
+bool WriteResults(const std::string& path,
+                  const std::vector<BenchResult>& results);
+
+/**
+ * items/s by "name/size" from a file written by WriteResults()
+ * False, with a message, if the file cannot be read or holds no results.
+ */
+bool ReadBaseline(const std::string& path,
+                  std::map<std::string, double>& baseline);
+
+/**
+ * Prints results off the baseline by more than tolerance, returns how many
+ * are slower
+ */
+size_t CompareBaseline(const std::vector<BenchResult>& results,
+                       const std::map<std::string, double>& baseline,
+                       double tolerance);
+
+// One per library
+void RegisterFEMBenchmarks();
+void RegisterSPHBenchmarks();
+void RegisterRigidBenchmarks();
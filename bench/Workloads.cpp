@@ -0,0 +1,71 @@
+#include "Workloads.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <glm/glm.hpp>
+
+#include "NeighborSearch.hpp"
+#include "RigidScenes.hpp"
+
+std::shared_ptr<Grid> MakeGrid(size_t size) {
+  const auto cell = .5f;
+  const auto grid = std::make_shared<Grid>(
+      glm::vec3(0.f, size * cell / 2 + .5f, 0.f), glm::vec3(0.f),
+      glm::vec3(cell), glm::uvec3(size), 100.f, .4f, 1.f);
+  grid->SetThreads(1);
+  return grid;
+}
+
+double TetrahedronBytes() {
+  // Frame, velocity and rest normals in, 4 forces out
+  return sizeof(Grid::Indices) + 4 * 2 * sizeof(glm::vec3) +
+         4 * sizeof(glm::vec3) + sizeof(glm::mat3) + 4 * sizeof(glm::vec3);
+}
+
+std::shared_ptr<SPHSimulator> MakeSPH(size_t size) {
+  SPHParameters params;
+  const auto side = std::round(std::cbrt(float(size)));
+  const auto half = side * params.h / 2;
+  params.box_x = params.box_z = std::max(1.f, half + params.h);
+  const auto center = glm::vec3(0.f, half, 0.f);
+  const auto simulator = std::make_shared<SPHSimulator>(
+      center - half, center + half,
+      [=](const glm::vec3& x) {
+        return glm::all(glm::lessThan(glm::abs(x - center), glm::vec3(half)));
+      },
+      params);
+  simulator->SetThreads(1);
+  return simulator;
+}
+
+double CountNeighbors(const SPHSimulator& simulator) {
+  const auto& system = simulator.GetParticles();
+  NeighborSearch search(500, system.Size(), 2 * simulator.GetH());
+  search.Update(system);
+  double pairs = 0;
+  for (const auto& n : search.neighbors) pairs += n.size();
+  return pairs;
+}
+
+double SPHPassBytes(const SPHSimulator& simulator) {
+  // Each pair reads the neighbor and its index, each particle is written
+  const auto particles = simulator.GetParticles().Size();
+  return CountNeighbors(simulator) *
+             (ParticleSystem::kBytesPerParticle + sizeof(size_t)) +
+         particles * ParticleSystem::kBytesPerParticle;
+}
+
+std::shared_ptr<RigidWorld> MakeRigidWorld(size_t size) {
+  const auto world = std::make_shared<RigidWorld>();
+  world->sleep_ = false;
+  world->SetThreads(1);
+  GetRigidScene("tumble", int(size), *world);
+  for (int step = 0; step < 90; ++step) world->Step(1.f / 60);
+  return world;
+}
+
+double CountContacts(const std::vector<Manifold>& manifolds) {
+  double contacts = 0;
+  for (const auto& m : manifolds) contacts += m.count;
+  return contacts;
+}
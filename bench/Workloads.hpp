@@ -0,0 +1,32 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "Grid.hpp"
+#include "RigidWorld.hpp"
+#include "SPHSimulator.hpp"
+
+/**
+ * Problems shared by physim_bench and physim_scaling, on one thread
+ */
+
+// size^3 cells resting above the ground, GUI defaults otherwise
+std::shared_ptr<Grid> MakeGrid(size_t size);
+
+// Read and written per tetrahedron by Grid::DeformTetrahedra
+double TetrahedronBytes();
+
+// Cube of about size particles at rest on the floor
+std::shared_ptr<SPHSimulator> MakeSPH(size_t size);
+
+// Neighbor pairs of the current positions
+double CountNeighbors(const SPHSimulator& simulator);
+
+// Read and written by the density or the force pass
+double SPHPassBytes(const SPHSimulator& simulator);
+
+// size tumbling boxes a second and a half in, piled up, never asleep
+std::shared_ptr<RigidWorld> MakeRigidWorld(size_t size);
+
+double CountContacts(const std::vector<Manifold>& manifolds);
@@ -0,0 +1,22 @@
+#include "Bench.hpp"
+#include "Workloads.hpp"
+
+void RegisterFEMBenchmarks() {
+  const std::vector<size_t> sizes{4, 8, 16};
+
+  RegisterBenchmark("Grid::DeformTetrahedra", sizes, [](size_t size) {
+    const auto grid = MakeGrid(size);
+    const double tetrahedra = grid->ParticleIndices().size();
+    return BenchCase{[grid] { grid->DeformTetrahedra(); }, tetrahedra,
+                     tetrahedra * TetrahedronBytes()};
+  });
+
+  RegisterBenchmark("Grid::Update", sizes, [](size_t size) {
+    const auto grid = MakeGrid(size);
+    const double tetrahedra = grid->ParticleIndices().size();
+    const double particles = grid->Particles().size();
+    return BenchCase{[grid] { grid->Update(1E-3f); }, tetrahedra,
+                     tetrahedra * TetrahedronBytes() +
+                         particles * 2 * sizeof(GridParticle)};
+  });
+}
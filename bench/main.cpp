@@ -0,0 +1,61 @@
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Arguments.hpp"
+#include "Bench.hpp"
+
+// Microbenchmarks of the simulation kernels, single threaded
+// physim_bench [--filter name] [--min-time s] [--json file]
+//              [--baseline file] [--tolerance fraction] [--perf]
+// Exits with failure when a benchmark is slower than the baseline by more
+// than the tolerance. --perf adds hardware counters per item where allowed.
+int main(int argc, char* argv[]) {
+  std::vector<std::string> args(argv + 1, argv + argc);
+  std::string filter, json = "bench.json", baseline_path;
+  auto min_time = .2f, tolerance = .1f;
+  auto perf = false;
+  for (size_t i = 0; i < args.size(); ++i) {
+    if (args[i] == "--filter" && i + 1 < args.size()) {
+      filter = args[++i];
+    } else if (args[i] == "--min-time" && i + 1 < args.size()) {
+      if (!ParseNumber(args[++i].c_str(), min_time) || min_time <= 0) {
+        std::cerr << "Not a positive number: " << args[i] << std::endl;
+        return EXIT_FAILURE;
+      }
+    } else if (args[i] == "--json" && i + 1 < args.size()) {
+      json = args[++i];
+    } else if (args[i] == "--baseline" && i + 1 < args.size()) {
+      baseline_path = args[++i];
+    } else if (args[i] == "--tolerance" && i + 1 < args.size()) {
+      if (!ParseNumber(args[++i].c_str(), tolerance) || tolerance < 0) {
+        std::cerr << "Not a fraction: " << args[i] << std::endl;
+        return EXIT_FAILURE;
+      }
+    } else if (args[i] == "--perf") {
+      perf = true;
+    } else {
+      std::cerr << "Unknown argument " << args[i] << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  // Before the benchmarks run, a bad baseline is found without the wait
+  std::map<std::string, double> baseline;
+  if (!baseline_path.empty() && !ReadBaseline(baseline_path, baseline)) {
+    return EXIT_FAILURE;
+  }
+
+  RegisterFEMBenchmarks();
+  RegisterSPHBenchmarks();
+  RegisterRigidBenchmarks();
+
+  const auto results = RunBenchmarks(filter, min_time, perf);
+  if (!WriteResults(json, results)) return EXIT_FAILURE;
+  if (!baseline_path.empty() &&
+      CompareBaseline(results, baseline, tolerance)) {
+    return EXIT_FAILURE;
+  }
+}
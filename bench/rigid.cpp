@@ -0,0 +1,90 @@
+#include <glm/glm.hpp>
+#include <memory>
+
+#include "Bench.hpp"
+#include "ContactSolver.hpp"
+#include "Narrowphase.hpp"
+#include "Workloads.hpp"
+
+namespace {
+const auto time_step = 1.f / 60;
+}  // namespace
+
+void RegisterRigidBenchmarks() {
+  const std::vector<size_t> sizes{64, 256, 1024};
+
+  // Box pairs from the broadphase into manifolds
+  RegisterBenchmark("Narrowphase::Update", sizes, [](size_t size) {
+    const auto world = MakeRigidWorld(size);
+    struct State {
+      std::vector<OBB> boxes;
+      std::vector<Broadphase::Pair> pairs;
+      std::vector<char> asleep;
+      Narrowphase narrowphase;
+    };
+    const auto state = std::make_shared<State>();
+    for (const auto& rb : world->GetBodies()) {
+      state->boxes.push_back(OBB::FromBody(rb));
+    }
+    state->pairs = world->GetPairs();
+    state->asleep.assign(state->boxes.size(), false);
+    const double pairs = state->pairs.size();
+    return BenchCase{[state] {
+                       state->narrowphase.Update(state->boxes, state->pairs,
+                                                 state->asleep);
+                     },
+                     pairs,
+                     pairs * 2 * sizeof(OBB) +
+                         world->GetManifolds().size() * sizeof(Manifold)};
+  });
+
+  RegisterBenchmark("ContactSolver::Solve", sizes, [](size_t size) {
+    const auto world = MakeRigidWorld(size);
+    struct State {
+      std::vector<RigidBody> bodies;
+      std::vector<Manifold> manifolds;
+      Islands islands;
+      ContactSolver solver;
+      JobArena jobs{1};
+    };
+    const auto state = std::make_shared<State>();
+    state->bodies = world->GetBodies();
+    state->manifolds = world->GetManifolds();
+    state->islands.Build(state->bodies.size(), state->manifolds);
+    const auto contacts = CountContacts(state->manifolds);
+    // Every iteration reads and writes both bodies of every contact
+    return BenchCase{[state] {
+                       state->solver.Solve(state->bodies, state->manifolds,
+                                           state->islands, time_step,
+                                           state->jobs);
+                     },
+                     contacts,
+                     contacts * state->solver.iterations_ * 4 *
+                         sizeof(RigidBody)};
+  });
+
+  // Free flight, no contacts
+  RegisterBenchmark("RigidBody::Integrate", sizes, [](size_t size) {
+    const auto world = MakeRigidWorld(size);
+    const auto bodies =
+        std::make_shared<std::vector<RigidBody>>(world->GetBodies());
+    return BenchCase{[bodies] {
+                       for (auto& rb : *bodies) {
+                         rb.AddForce(rb.m_ * glm::vec3(0.f, -9.8f, 0.f),
+                                     glm::vec3(0.f));
+                         rb.IntegrateVelocity(time_step);
+                         rb.IntegratePosition(time_step);
+                       }
+                     },
+                     double(bodies->size()),
+                     double(bodies->size() * 2 * sizeof(RigidBody))};
+  });
+
+  RegisterBenchmark("RigidWorld::Step", sizes, [](size_t size) {
+    const auto world = MakeRigidWorld(size);
+    return BenchCase{[world] { world->Step(time_step); },
+                     double(world->Size()),
+                     double(world->Size() * 2 * sizeof(RigidBody) +
+                            world->GetManifolds().size() * sizeof(Manifold))};
+  });
+}
@@ -0,0 +1,273 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "JobSystem.hpp"
+#include "Narrowphase.hpp"
+#include "Workloads.hpp"
+
+namespace {
+// A simulator split into the passes of one step
+struct Workload {
+  struct Phase {
+    std::string name;
+    std::function<void()> run;
+    double bytes;  // Read and written per step, estimated
+  };
+  double items;
+  std::vector<Phase> phases;
+  std::function<bool()> error;
+};
+
+struct Simulator {
+  std::string name;
+  std::vector<size_t> sizes;
+  int dimensions;  // Items grow as size^dimensions
+  std::function<Workload(size_t size, size_t threads)> make;
+};
+
+struct Row {
+  std::string simulator, mode, phase;
+  size_t size, threads;
+  double items, seconds, speedup, efficiency, bytes;
+};
+
+Workload MakeFEMWorkload(size_t size, size_t threads) {
+  const auto dt = 1E-3f;
+  const auto grid = MakeGrid(size);
+  grid->SetThreads(threads);
+  const double particles = grid->Particles().size();
+  const double tetrahedra = grid->ParticleIndices().size();
+  return {particles,
+          {{"gravity", [grid] { grid->ApplyGravity(); },
+            particles * sizeof(GridParticle)},
+           {"deform", [grid] { grid->DeformTetrahedra(); },
+            tetrahedra * TetrahedronBytes()},
+           {"integrate", [grid, dt] { grid->Integrate(dt); },
+            particles * 2 * sizeof(GridParticle)}},
+          [grid] { return grid->GetError(); }};
+}
+
+Workload MakeSPHWorkload(size_t size, size_t threads) {
+  const auto dt = 1E-3f;
+  const auto simulator = MakeSPH(size);
+  simulator->SetThreads(threads);
+  const double particles = simulator->GetParticles().Size();
+  const auto pass = SPHPassBytes(*simulator);
+  const auto particle = double(ParticleSystem::kBytesPerParticle);
+  return {particles,
+          {{"neighbors", [simulator] { simulator->UpdateNeighbors(); },
+            particles * particle +
+                CountNeighbors(*simulator) * sizeof(size_t)},
+           {"density", [simulator] { simulator->UpdateDensity(); }, pass},
+           {"forces", [simulator] { simulator->UpdateForces(); }, pass},
+           {"box", [simulator] { simulator->ApplyBoxPenalty(); },
+            particles * (particle + sizeof(glm::vec3))},
+           {"integrate", [simulator, dt] { simulator->Integrate(dt); },
+            particles * 2 * particle}},
+          [simulator] { return simulator->GetError(); }};
+}
+
+Workload MakeRigidWorkload(size_t size, size_t threads) {
+  const auto dt = 1.f / 60;
+  const auto world = MakeRigidWorld(size);
+  world->SetThreads(threads);
+  const double bodies = world->Size();
+  const auto& manifolds = world->GetManifolds();
+  return {bodies,
+          {{"detect", [world, dt] { world->Detect(dt); },
+            double(world->GetPairs().size() * 2 * sizeof(OBB) +
+                   manifolds.size() * sizeof(Manifold))},
+           {"solve", [world, dt] { world->Solve(dt); },
+            CountContacts(manifolds) * world->solver_.iterations_ * 4 *
+                sizeof(RigidBody)},
+           {"integrate", [world, dt] { world->Integrate(dt); },
+            bodies * 2 * sizeof(RigidBody)}},
+          [] { return false; }};
+}
+
+// Seconds per step of every phase, then of the whole step
+std::vector<double> Measure(Workload& workload, size_t warmup, size_t steps) {
+  using Clock = std::chrono::steady_clock;
+  for (size_t step = 0; step < warmup; ++step) {
+    for (auto& phase : workload.phases) phase.run();
+  }
+  std::vector<double> seconds(workload.phases.size() + 1, 0.);
+  for (size_t step = 0; step < steps; ++step) {
+    for (size_t i = 0; i < workload.phases.size(); ++i) {
+      const auto start = Clock::now();
+      workload.phases[i].run();
+      const std::chrono::duration<double> elapsed = Clock::now() - start;
+      seconds[i] += elapsed.count();
+    }
+  }
+  for (size_t i = 0; i < workload.phases.size(); ++i) {
+    seconds[i] /= steps;
+    seconds.back() += seconds[i];
+  }
+  return seconds;
+}
+
+std::vector<size_t> ParseList(const std::string& text) {
+  std::vector<size_t> list;
+  std::istringstream stream(text);
+  for (std::string item; std::getline(stream, item, ',');) {
+    list.push_back(std::stoul(item));
+  }
+  return list;
+}
+
+// Problem for the given threads when weak scaling from base at reference
+size_t WeakSize(size_t base, int dimensions, size_t threads,
+                size_t reference) {
+  return size_t(std::round(
+      base * std::pow(double(threads) / reference, 1. / dimensions)));
+}
+
+bool WriteCSV(const std::string& path, const std::vector<Row>& rows) {
+  std::ofstream file(path);
+  if (!file) {
+    std::cerr << "Cannot write " << path << std::endl;
+    return false;
+  }
+  file << "simulator,mode,size,items,threads,phase,seconds_per_step,speedup,"
+          "efficiency,bytes_per_step,bytes_per_second\n";
+  for (const auto& r : rows) {
+    file << r.simulator << "," << r.mode << "," << r.size << "," << r.items
+         << "," << r.threads << "," << r.phase << "," << r.seconds << ","
+         << r.speedup << "," << r.efficiency << "," << r.bytes << ","
+         << r.bytes / r.seconds << "\n";
+  }
+  return true;
+}
+}  // namespace
+
+// Strong or weak scaling of the simulators over thread counts
+// physim_scaling [--sim fem,sph,rigid] [--threads 1,2,4] [--steps n]
+//                [--fem sizes] [--sph sizes] [--rigid sizes] [--weak]
+//                [--csv file]
+// Strong scaling steps every size on every thread count. Weak scaling grows
+// each size with the threads, so every thread keeps the same share. Speedup
+// is in items per second against the fewest threads, efficiency is speedup
+// per thread added. The CSV has one row per phase and a total row per run.
+int main(int argc, char* argv[]) {
+  std::vector<Simulator> simulators{
+      {"fem", {8, 16, 24}, 3, MakeFEMWorkload},
+      {"sph", {4096, 8000}, 1, MakeSPHWorkload},
+      {"rigid", {256, 1024, 4096}, 1, MakeRigidWorkload}};
+
+  std::vector<std::string> args(argv + 1, argv + argc);
+  std::vector<size_t> threads;
+  std::string selected = "fem,sph,rigid", csv = "scaling.csv";
+  size_t steps = 20;
+  auto weak = false;
+  for (size_t i = 0; i < args.size(); ++i) {
+    const auto has_value = i + 1 < args.size();
+    const auto sizes = std::find_if(
+        simulators.begin(), simulators.end(),
+        [&](const Simulator& s) { return args[i] == "--" + s.name; });
+    if (args[i] == "--sim" && has_value) {
+      selected = args[++i];
+    } else if (args[i] == "--threads" && has_value) {
+      threads = ParseList(args[++i]);
+    } else if (args[i] == "--steps" && has_value) {
+      steps = std::max<size_t>(std::stoul(args[++i]), 1);
+    } else if (args[i] == "--weak") {
+      weak = true;
+    } else if (args[i] == "--csv" && has_value) {
+      csv = args[++i];
+    } else if (sizes != simulators.end() && has_value) {
+      sizes->sizes = ParseList(args[++i]);
+    } else {
+      std::cerr << "Unknown argument " << args[i] << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  selected = "," + selected + ",";
+
+  // Powers of two up to the pool, and the pool itself
+  const auto pool = JobSystem::Global().Size();
+  if (threads.empty()) {
+    for (size_t t = 1; t < pool; t *= 2) threads.push_back(t);
+    threads.push_back(pool);
+  }
+  for (const auto t : threads) {
+    if (!t || t > pool) {
+      std::cerr << "Cannot run " << t << " threads on a pool of " << pool
+                << ", set PHYSIM_THREADS" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  const auto mode = weak ? "weak" : "strong";
+  const auto warmup = std::max<size_t>(steps / 10, 2);
+  std::vector<Row> rows;
+  auto failed = false;
+  std::cout << std::left << std::setw(8) << "sim" << std::right
+            << std::setw(8) << "size" << std::setw(10) << "items"
+            << std::setw(9) << "threads" << std::setw(14) << "time/step"
+            << std::setw(10) << "speedup" << std::setw(12) << "efficiency"
+            << std::setw(14) << "bytes/s" << std::endl;
+  for (const auto& s : simulators) {
+    if (selected.find("," + s.name + ",") == std::string::npos) continue;
+    for (const auto base : s.sizes) {
+      // Items per second of every phase on the fewest threads
+      std::vector<double> reference;
+      for (const auto t : threads) {
+        const auto size =
+            weak ? WeakSize(base, s.dimensions, t, threads.front()) : base;
+        auto workload = s.make(size, t);
+        const auto seconds = Measure(workload, warmup, steps);
+        if (workload.error()) {
+          std::cerr << s.name << " " << size << " blew up on " << t
+                    << " threads" << std::endl;
+          failed = true;
+        }
+        if (reference.empty()) {
+          for (const auto time : seconds) {
+            reference.push_back(workload.items / time);
+          }
+        }
+
+        double bytes = 0;
+        for (size_t i = 0; i <= workload.phases.size(); ++i) {
+          const auto total = i == workload.phases.size();
+          if (!total) bytes += workload.phases[i].bytes;
+          Row row{s.name,
+                  mode,
+                  total ? "total" : workload.phases[i].name,
+                  size,
+                  t,
+                  workload.items,
+                  seconds[i],
+                  0.,
+                  0.,
+                  total ? bytes : workload.phases[i].bytes};
+          // Sizes only grow about as fast as the threads, so weak scaling
+          // is measured in items per second too
+          row.speedup = workload.items / seconds[i] / reference[i];
+          row.efficiency = row.speedup * threads.front() / t;
+          rows.push_back(row);
+        }
+
+        const auto& r = rows.back();
+        std::cout << std::left << std::setw(8) << s.name << std::right
+                  << std::setw(8) << size << std::setw(10) << r.items
+                  << std::setw(9) << t << std::setw(14) << r.seconds
+                  << std::setw(10) << r.speedup << std::setw(12)
+                  << r.efficiency << std::setw(14) << r.bytes / r.seconds
+                  << std::endl;
+      }
+    }
+  }
+
+  if (!WriteCSV(csv, rows) || failed) return EXIT_FAILURE;
+}
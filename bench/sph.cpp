@@ -0,0 +1,57 @@
+#include "Bench.hpp"
+#include "Integrator.hpp"
+#include "NeighborSearch.hpp"
+#include "Workloads.hpp"
+
+void RegisterSPHBenchmarks() {
+  const std::vector<size_t> sizes{1000, 4096, 8000};
+
+  RegisterBenchmark("NeighborSearch::Update", sizes, [](size_t size) {
+    const auto simulator = MakeSPH(size);
+    const auto& system = simulator->GetParticles();
+    const auto search = std::make_shared<NeighborSearch>(
+        500, system.Size(), 2 * simulator->GetH());
+    return BenchCase{[=] { search->Update(simulator->GetParticles()); },
+                     double(system.Size()),
+                     system.Size() * ParticleSystem::kBytesPerParticle +
+                         CountNeighbors(*simulator) * sizeof(size_t)};
+  });
+
+  RegisterBenchmark("SPHSimulator::UpdateDensity", sizes, [](size_t size) {
+    const auto simulator = MakeSPH(size);
+    simulator->UpdateNeighbors();
+    return BenchCase{[=] { simulator->UpdateDensity(); },
+                     double(simulator->GetParticles().Size()),
+                     SPHPassBytes(*simulator)};
+  });
+
+  RegisterBenchmark("SPHSimulator::UpdateForces", sizes, [](size_t size) {
+    const auto simulator = MakeSPH(size);
+    simulator->UpdateNeighbors();
+    simulator->UpdateDensity();
+    return BenchCase{[=] { simulator->UpdateForces(); },
+                     double(simulator->GetParticles().Size()),
+                     SPHPassBytes(*simulator)};
+  });
+
+  RegisterBenchmark("Integrator::Integrate", sizes, [](size_t size) {
+    const auto simulator = MakeSPH(size);
+    const auto system =
+        std::make_shared<ParticleSystem>(simulator->GetParticles());
+    const auto forces = std::make_shared<std::vector<glm::vec3>>(
+        system->Size(), glm::vec3(0.f, -9.8f, 0.f));
+    // Particle read and written, force read
+    return BenchCase{[=] { Integrator().Integrate(*system, *forces, 1E-6f); },
+                     double(system->Size()),
+                     double(system->Size() *
+                            (2 * ParticleSystem::kBytesPerParticle +
+                             sizeof(glm::vec3)))};
+  });
+
+  RegisterBenchmark("SPHSimulator::Update", sizes, [](size_t size) {
+    const auto simulator = MakeSPH(size);
+    return BenchCase{[=] { simulator->Update(1E-3f); },
+                     double(simulator->GetParticles().Size()),
+                     3 * SPHPassBytes(*simulator)};
+  });
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+/**
+ * The whole of text as a base 10 number, no sign or spaces
+ * Unlike std::stoul nothing throws, unlike std::strtoul nothing is half
+ * read.
+ */
+inline bool ParseNumber(const char* text, unsigned long& value) {
+  if (*text < '0' || *text > '9') return false;
+  char* end;
+  errno = 0;
+  value = std::strtoul(text, &end, 10);
+  return *end == '\0' && errno == 0;
+}
+
+/**
+ * The whole of text as a finite number
+ */
+inline bool ParseNumber(const char* text, float& value) {
+  char* end;
+  errno = 0;
+  value = std::strtof(text, &end);
+  return end != text && *end == '\0' && errno == 0 && std::isfinite(value);
+}
+
+/**
+ * argv[i] into value if there is one, value keeps its default otherwise
+ * False, with a message on std::cerr, if it is not a number
+ */
+template <typename T>
+bool ParseArgument(int argc, char* argv[], int i, T& value) {
+  if (i >= argc || ParseNumber(argv[i], value)) return true;
+  std::cerr << "Not a number: " << argv[i] << std::endl;
+  return false;
+}
@@ -0,0 +1,233 @@
+#include "Checkpoint.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+using namespace checkpoint;
+
+namespace {
+const char kMagic[4] = {'P', 'C', 'K', 'P'};
+
+// Names are padded with zeros, not terminated when they fill the field
+void CopyName(char (&to)[8], const char* from) {
+  std::memcpy(to, from, std::min(std::strlen(from), sizeof(to)));
+}
+
+std::uint64_t Align(std::uint64_t offset) {
+  return (offset + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+// Nothing but write(), see Checkpoint::WriteFile()
+bool WriteAll(int fd, const void* data, size_t bytes) {
+  auto in = static_cast<const char*>(data);
+  while (bytes) {
+    const auto n = write(fd, in, bytes);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    in += n;
+    bytes -= size_t(n);
+  }
+  return true;
+}
+}  // namespace
+
+Checkpoint::Checkpoint(const char* kind, std::uint64_t step) {
+  std::memcpy(header_.magic, kMagic, 4);
+  header_.version = kVersion;
+  CopyName(header_.kind, kind);
+  header_.step = step;
+}
+
+void Checkpoint::Add(const char* tag, const void* data, size_t element_size,
+                     size_t count) {
+  Section section{};
+  CopyName(section.tag, tag);
+  section.element_size = element_size;
+  section.count = count;
+  sections_.push_back(section);
+  data_.push_back(data);
+}
+
+std::vector<std::uint8_t> Checkpoint::Head() const {
+  auto header = header_;
+  auto sections = sections_;
+  auto offset = sizeof(FileHeader) + sections.size() * sizeof(Section);
+  for (auto& s : sections) {
+    s.offset = Align(offset);
+    offset = s.offset + s.element_size * s.count;
+  }
+  header.sections = sections.size();
+  header.bytes = offset;
+
+  std::vector<std::uint8_t> head(sizeof(FileHeader) +
+                                 sections.size() * sizeof(Section));
+  std::memcpy(head.data(), &header, sizeof(header));
+  std::memcpy(head.data() + sizeof(header), sections.data(),
+              sections.size() * sizeof(Section));
+  return head;
+}
+
+bool Checkpoint::WriteFile(const std::string& temporary,
+                           const std::string& path,
+                           const std::vector<std::uint8_t>& head) const {
+  static const char kZeros[kAlignment] = {};
+  const auto fd =
+      open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) return false;
+
+  auto ok = WriteAll(fd, head.data(), head.size());
+  const auto sections =
+      reinterpret_cast<const Section*>(head.data() + sizeof(FileHeader));
+  std::uint64_t position = head.size();
+  for (size_t i = 0; ok && i < sections_.size(); ++i) {
+    const auto& s = sections[i];
+    const auto bytes = s.element_size * s.count;
+    ok = WriteAll(fd, kZeros, size_t(s.offset - position)) &&
+         WriteAll(fd, data_[i], size_t(bytes));
+    position = s.offset + bytes;
+  }
+  // On the disk before the rename makes it visible
+  ok = ok && fsync(fd) == 0;
+  return close(fd) == 0 && ok && rename(temporary.c_str(), path.c_str()) == 0;
+}
+
+bool Checkpoint::Write(const std::string& path) const {
+  if (!WriteFile(path + ".tmp", path, Head())) {
+    std::cerr << "Cannot write checkpoint " << path << ": "
+              << std::strerror(errno) << std::endl;
+    return false;
+  }
+  return true;
+}
+
+CheckpointWriter::CheckpointWriter(std::string path, std::uint64_t every_n)
+    : path_(std::move(path)),
+      temporary_(path_ + ".tmp"),
+      every_n_(every_n ? every_n : 1) {}
+
+CheckpointWriter::~CheckpointWriter() { Wait(); }
+
+std::unique_ptr<CheckpointWriter> CheckpointWriter::FromEnvironment() {
+  const auto path = std::getenv("PHYSIM_CHECKPOINT");
+  if (!path || !*path) return nullptr;
+  const auto every = std::getenv("PHYSIM_CHECKPOINT_EVERY");
+  return std::make_unique<CheckpointWriter>(
+      path, every ? std::strtoull(every, nullptr, 10) : 1000);
+}
+
+bool CheckpointWriter::Write(const Checkpoint& checkpoint) {
+  if (!Reap(false)) {
+    ++skipped_;
+    return false;
+  }
+
+  // Everything the child needs is allocated before the fork, other threads
+  // may hold the allocator's locks at that moment
+  const auto head = checkpoint.Head();
+  const auto pid = fork();
+  if (pid == 0) {
+    _exit(checkpoint.WriteFile(temporary_, path_, head) ? EXIT_SUCCESS
+                                                         : EXIT_FAILURE);
+  }
+  if (pid < 0) {
+    // Out of processes, write in place instead
+    if (!checkpoint.Write(path_)) return false;
+    ++written_;
+    return true;
+  }
+  child_ = pid;
+  return true;
+}
+
+void CheckpointWriter::Wait() { Reap(true); }
+
+bool CheckpointWriter::Reap(bool wait) {
+  if (child_ < 0) return true;
+  int status;
+  const auto pid = waitpid(child_, &status, wait ? 0 : WNOHANG);
+  if (pid == 0) return false;  // Still writing
+  child_ = -1;
+  if (pid > 0 && WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS) {
+    ++written_;
+  } else {
+    std::cerr << "Cannot write checkpoint " << path_ << std::endl;
+  }
+  return true;
+}
+
+CheckpointFile::CheckpointFile(const std::string& path, const char* kind)
+    : path_(path) {
+  const auto fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    std::cerr << "Cannot open checkpoint " << path << std::endl;
+    return;
+  }
+  struct stat st {};
+  fstat(fd, &st);
+  size_ = size_t(st.st_size);
+  if (size_ < sizeof(FileHeader)) {
+    std::cerr << "Truncated checkpoint " << path << std::endl;
+    close(fd);
+    return;
+  }
+  const auto data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    std::cerr << "Cannot map checkpoint " << path << std::endl;
+    return;
+  }
+  data_ = static_cast<const std::uint8_t*>(data);
+
+  // The only fix-up: offsets to pointers into the mapping
+  header_ = reinterpret_cast<const FileHeader*>(data_);
+  sections_ = reinterpret_cast<const Section*>(data_ + sizeof(FileHeader));
+  auto valid = !std::memcmp(header_->magic, kMagic, 4) &&
+               header_->version == kVersion && header_->bytes == size_ &&
+               header_->sections <=
+                   (size_ - sizeof(FileHeader)) / sizeof(Section);
+  for (size_t i = 0; valid && i < header_->sections; ++i) {
+    const auto& s = sections_[i];
+    valid = s.offset % kAlignment == 0 && s.offset <= size_ &&
+            (!s.element_size ||
+             s.count <= (size_ - s.offset) / s.element_size);
+  }
+  const auto right_kind =
+      valid && !std::strncmp(header_->kind, kind, sizeof(header_->kind));
+  if (!right_kind) {
+    if (valid) {
+      std::cerr << "Checkpoint " << path << " is not of " << kind
+                << std::endl;
+    } else {
+      std::cerr << "Invalid checkpoint " << path << std::endl;
+    }
+    munmap(data, size_);
+    data_ = nullptr;
+  }
+}
+
+CheckpointFile::~CheckpointFile() {
+  if (data_) munmap(const_cast<std::uint8_t*>(data_), size_);
+}
+
+const Section* CheckpointFile::Find(const char* tag,
+                                    size_t element_size) const {
+  for (size_t i = 0; i < header_->sections; ++i) {
+    const auto& s = sections_[i];
+    if (std::strncmp(s.tag, tag, sizeof(s.tag))) continue;
+    if (s.element_size == element_size) return &s;
+    std::cerr << "Checkpoint " << path_ << " has " << tag
+              << " of another layout" << std::endl;
+    return nullptr;
+  }
+  std::cerr << "Checkpoint " << path_ << " has no " << tag << std::endl;
+  return nullptr;
+}
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * Binary checkpoint of a simulation, loaded by mapping it
+ *
+ * Layout: FileHeader, Section table, then every section's raw elements,
+ * each section starting at a multiple of kAlignment. Elements are written
+ * as they are in memory, so the file is only read back on the machine
+ * type that wrote it and loading is a pointer into the mapping per
+ * section. A different version or element size is refused, not converted.
+ */
+namespace checkpoint {
+constexpr std::uint32_t kVersion = 1;
+constexpr std::uint64_t kAlignment = 64;
+
+struct FileHeader {
+  char magic[4];
+  std::uint32_t version;
+  char kind[8];  // Simulation that wrote it, like "fem"
+  std::uint64_t step;
+  std::uint64_t sections;
+  std::uint64_t bytes;  // Whole file, to tell truncated ones
+};
+
+struct Section {
+  char tag[8];
+  std::uint64_t offset;  // From the start of the file
+  std::uint64_t element_size;
+  std::uint64_t count;
+};
+}  // namespace checkpoint
+
+/**
+ * Sections of one checkpoint, before it is written
+ *
+ * Vectors are referenced, not copied, and must not change until the
+ * checkpoint is written. Anything passed by value or moved in is owned.
+ */
+class Checkpoint {
+public:
+  Checkpoint(const char* kind, std::uint64_t step);
+
+  template <typename T>
+  void Add(const char* tag, const std::vector<T>& values) {
+    static_assert(std::is_trivially_copyable<T>::value, "Raw bytes only");
+    Add(tag, values.data(), sizeof(T), values.size());
+  }
+
+  template <typename T>
+  void Add(const char* tag, std::vector<T>&& values) {
+    const auto owned = std::make_shared<std::vector<T>>(std::move(values));
+    owned_.push_back(owned);
+    Add(tag, *owned);
+  }
+
+  template <typename T>
+  void AddValue(const char* tag, const T& value) {
+    static_assert(std::is_trivially_copyable<T>::value, "Raw bytes only");
+    const auto owned = std::make_shared<T>(value);
+    owned_.push_back(owned);
+    Add(tag, owned.get(), sizeof(T), 1);
+  }
+
+  void Add(const char* tag, const void* data, size_t element_size,
+           size_t count);
+
+  /**
+   * Writes path in place, waiting for the disk
+   */
+  bool Write(const std::string& path) const;
+
+private:
+  friend class CheckpointWriter;
+
+  // Header and section table
+  std::vector<std::uint8_t> Head() const;
+
+  // Writes temporary and renames it to path. Only system calls, so a
+  // forked child of a threaded process can call it.
+  bool WriteFile(const std::string& temporary, const std::string& path,
+                 const std::vector<std::uint8_t>& head) const;
+
+  checkpoint::FileHeader header_{};
+  std::vector<checkpoint::Section> sections_;
+  std::vector<const void*> data_;
+  std::vector<std::shared_ptr<const void>> owned_;
+};
+
+/**
+ * Writes checkpoints every N steps without stopping the step loop
+ *
+ * Each checkpoint is written by a forked child, which sees the memory as
+ * it was at the fork however the parent goes on, so the parent only pays
+ * for the fork. A checkpoint due while the last one is still being
+ * written is skipped. Files are written next to the path and renamed over
+ * it, a crash never leaves a partial checkpoint behind.
+ */
+class CheckpointWriter {
+public:
+  CheckpointWriter(std::string path, std::uint64_t every_n);
+  ~CheckpointWriter();
+
+  CheckpointWriter(const CheckpointWriter&) = delete;
+  CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+  /**
+   * PHYSIM_CHECKPOINT=path, every PHYSIM_CHECKPOINT_EVERY steps (1000 by
+   * default), else null
+   */
+  static std::unique_ptr<CheckpointWriter> FromEnvironment();
+
+  bool IsDue(std::uint64_t step) const { return step % every_n_ == 0; }
+
+  /**
+   * False if skipped, written in place where there is no fork()
+   */
+  bool Write(const Checkpoint& checkpoint);
+
+  /**
+   * Until the checkpoint being written is on disk
+   */
+  void Wait();
+
+  size_t Written() const { return written_; }
+  size_t Skipped() const { return skipped_; }
+
+private:
+  // Whether the child is done, reporting its failure
+  bool Reap(bool wait);
+
+  std::string path_, temporary_;
+  std::uint64_t every_n_;
+  int child_ = -1;
+  size_t written_ = 0, skipped_ = 0;
+};
+
+/**
+ * Mapped checkpoint, sections are read in place
+ *
+ * The simulators own their state in vectors they go on changing, so they
+ * Read() each section out of the mapping with one copy instead of keeping
+ * pointers into it. Nothing is parsed or converted either way, but every
+ * index into another section must be checked before it is used.
+ */
+class CheckpointFile {
+public:
+  /**
+   * Refused with a message on std::cerr if it is not a checkpoint of kind
+   */
+  CheckpointFile(const std::string& path, const char* kind);
+  ~CheckpointFile();
+
+  CheckpointFile(const CheckpointFile&) = delete;
+  CheckpointFile& operator=(const CheckpointFile&) = delete;
+
+  explicit operator bool() const { return data_ != nullptr; }
+
+  std::uint64_t GetStep() const { return header_->step; }
+
+  /**
+   * Elements of a section in the mapping, null if it is missing or holds
+   * another type
+   */
+  template <typename T>
+  const T* Get(const char* tag, size_t& count) const {
+    const auto section = Find(tag, sizeof(T));
+    if (!section) return nullptr;
+    count = size_t(section->count);
+    return reinterpret_cast<const T*>(data_ + section->offset);
+  }
+
+  template <typename T>
+  bool Read(const char* tag, std::vector<T>& values) const {
+    size_t count;
+    const auto data = Get<T>(tag, count);
+    if (data) values.assign(data, data + count);
+    return data != nullptr;
+  }
+
+  template <typename T>
+  bool ReadValue(const char* tag, T& value) const {
+    size_t count;
+    const auto data = Get<T>(tag, count);
+    if (data && count == 1) value = *data;
+    return data && count == 1;
+  }
+
+private:
+  const checkpoint::Section* Find(const char* tag, size_t element_size) const;
+
+  std::string path_;
+  const std::uint8_t* data_ = nullptr;
+  size_t size_ = 0;
+
+  const checkpoint::FileHeader* header_ = nullptr;
+  const checkpoint::Section* sections_ = nullptr;
+};
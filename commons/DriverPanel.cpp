@@ -0,0 +1,17 @@
+#include "DriverPanel.hpp"
+
+#include <imgui.h>
+
+#include "SimulationDriver.hpp"
+
+void DrawDriverPanel(SimulationDriver& driver) {
+  if (auto scale = driver.GetTimeScale();
+      ImGui::SliderFloat("Time scale", &scale, .05f, 2.f)) {
+    driver.SetTimeScale(scale);
+  }
+  if (auto substeps = driver.GetMaxSubsteps();
+      ImGui::SliderInt("Max substeps", &substeps, 1, 64)) {
+    driver.SetMaxSubsteps(substeps);
+  }
+  ImGui::Text("Simulated/real time: %.2f", driver.GetDilation());
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+class SimulationDriver;
+
+/**
+ * Time scale, substep budget and achieved speed of a driver, for an ImGui
+ * window between its Begin() and End()
+ */
+void DrawDriverPanel(SimulationDriver& driver);
@@ -0,0 +1,285 @@
+#include "FrameRecorder.hpp"
+
+#include <glad/glad.h>
+#include <zlib.h>
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "Profiler.hpp"
+
+namespace {
+const std::uint8_t kPngSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a,
+                                       '\n'};
+
+void PutU32(std::vector<std::uint8_t>& out, std::uint32_t x) {
+  for (int shift = 24; shift >= 0; shift -= 8) {
+    out.push_back(std::uint8_t(x >> shift));
+  }
+}
+
+void PutChunk(std::vector<std::uint8_t>& out, const char (&type)[5],
+              const std::uint8_t* data, size_t size) {
+  PutU32(out, std::uint32_t(size));
+  const auto start = out.size();
+  out.insert(out.end(), type, type + 4);
+  out.insert(out.end(), data, data + size);
+  PutU32(out, std::uint32_t(crc32(0, out.data() + start, uInt(size + 4))));
+}
+
+// RGBA rows, bottom first as GL reads them, to an 8-bit RGBA PNG
+bool EncodePng(const std::uint8_t* pixels, int width, int height,
+               std::vector<std::uint8_t>& png) {
+  // Every scanline gets the Sub filter, cheap and about halves the size
+  const auto stride = size_t(width) * 4;
+  std::vector<std::uint8_t> scanlines((stride + 1) * height);
+  auto out = scanlines.data();
+  for (int y = height - 1; y >= 0; --y) {
+    const auto row = pixels + y * stride;
+    *out++ = 1;
+    for (size_t i = 0; i < stride; ++i) {
+      *out++ = std::uint8_t(row[i] - (i >= 4 ? row[i - 4] : 0));
+    }
+  }
+
+  std::vector<std::uint8_t> compressed(compressBound(uLong(scanlines.size())));
+  auto compressed_size = uLongf(compressed.size());
+  if (compress2(compressed.data(), &compressed_size, scanlines.data(),
+                uLong(scanlines.size()), Z_BEST_SPEED) != Z_OK) {
+    return false;
+  }
+
+  std::vector<std::uint8_t> header;
+  PutU32(header, std::uint32_t(width));
+  PutU32(header, std::uint32_t(height));
+  // 8 bits, RGBA, deflate, adaptive filters, not interlaced
+  header.insert(header.end(), {8, 6, 0, 0, 0});
+
+  png.assign(kPngSignature, kPngSignature + 8);
+  PutChunk(png, "IHDR", header.data(), header.size());
+  PutChunk(png, "IDAT", compressed.data(), compressed_size);
+  PutChunk(png, "IEND", nullptr, 0);
+  return true;
+}
+}  // namespace
+
+FrameRecorder::FrameRecorder(std::string output, int width, int height)
+    : output_(std::move(output)),
+      width_(width),
+      height_(height),
+      png_(output_.find('%') != std::string::npos) {
+  if (png_ && !ParsePattern()) {
+    // Neither PNGs nor a raw stream, every frame fails
+    std::cerr << "Output needs one %d or %0Nd and no other %: " << output_
+              << std::endl;
+    png_ = false;
+    error_ = true;
+  } else if (!png_) {
+    raw_.open(output_, std::ios::binary | std::ios::trunc);
+    if (!raw_) {
+      std::cerr << "Cannot open " << output_ << std::endl;
+      error_ = true;
+    }
+  }
+
+  glCreateRenderbuffers(1, &color_);
+  glNamedRenderbufferStorage(color_, GL_RGBA8, width_, height_);
+  glCreateRenderbuffers(1, &depth_);
+  glNamedRenderbufferStorage(depth_, GL_DEPTH_COMPONENT24, width_, height_);
+  glCreateFramebuffers(1, &framebuffer_);
+  glNamedFramebufferRenderbuffer(framebuffer_, GL_COLOR_ATTACHMENT0,
+                                 GL_RENDERBUFFER, color_);
+  glNamedFramebufferRenderbuffer(framebuffer_, GL_DEPTH_ATTACHMENT,
+                                 GL_RENDERBUFFER, depth_);
+  if (glCheckNamedFramebufferStatus(framebuffer_, GL_FRAMEBUFFER) !=
+      GL_FRAMEBUFFER_COMPLETE) {
+    std::cerr << "Incomplete framebuffer of " << width_ << 'x' << height_
+              << std::endl;
+    error_ = true;
+  }
+
+  const auto bytes = GLsizeiptr(width_) * height_ * 4;
+  glCreateBuffers(kSlots, pixel_buffers_);
+  for (auto buffer : pixel_buffers_) {
+    glNamedBufferStorage(buffer, bytes, nullptr, GL_MAP_READ_BIT);
+  }
+
+  writer_ = std::thread(&FrameRecorder::WriteLoop, this);
+}
+
+FrameRecorder::~FrameRecorder() {
+  Finish();
+  for (auto fence : fences_) {
+    if (fence) glDeleteSync(static_cast<GLsync>(fence));
+  }
+  glDeleteBuffers(kSlots, pixel_buffers_);
+  glDeleteFramebuffers(1, &framebuffer_);
+  glDeleteRenderbuffers(1, &depth_);
+  glDeleteRenderbuffers(1, &color_);
+}
+
+glm::ivec2 FrameRecorder::SizeFromEnvironment() {
+  glm::ivec2 size{640, 480};
+  const auto value = std::getenv("PHYSIM_RENDER_SIZE");
+  if (value && (std::sscanf(value, "%dx%d", &size.x, &size.y) != 2 ||
+                size.x <= 0 || size.y <= 0)) {
+    std::cerr << "PHYSIM_RENDER_SIZE is not WxH: " << value << std::endl;
+    size = {640, 480};
+  }
+  return size;
+}
+
+bool FrameRecorder::ParsePattern() {
+  const auto percent = output_.find('%');
+  auto end = percent + 1;
+  if (end < output_.size() && output_[end] == '0') {
+    while (++end < output_.size() && std::isdigit(output_[end])) {
+    }
+    // Only zero padding, and not more than a file name could take
+    if (end == percent + 2 || end - percent > 5) return false;
+    digits_ = std::stoul(output_.substr(percent + 2, end - percent - 2));
+  }
+  if (end >= output_.size() || output_[end] != 'd' ||
+      output_.find('%', end) != std::string::npos) {
+    return false;
+  }
+  prefix_ = output_.substr(0, percent);
+  suffix_ = output_.substr(end + 1);
+  return true;
+}
+
+void FrameRecorder::Bind() {
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_);
+  glViewport(0, 0, width_, height_);
+}
+
+void FrameRecorder::Capture() {
+  PROFILE_ZONE("FrameRecorder::Capture");
+  const auto slot = int(captured_ % kSlots);
+  if (fences_[slot]) Retrieve(slot);
+
+  // Into the pixel buffer, so this only queues the copy
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer_);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, pixel_buffers_[slot]);
+  glPixelStorei(GL_PACK_ALIGNMENT, 4);
+  glReadPixels(0, 0, width_, height_, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  fences_[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  indices_[slot] = captured_++;
+}
+
+void FrameRecorder::Retrieve(int slot) {
+  PROFILE_ZONE("FrameRecorder::Retrieve");
+  auto& fence = fences_[slot];
+  while (glClientWaitSync(static_cast<GLsync>(fence),
+                          GL_SYNC_FLUSH_COMMANDS_BIT,
+                          1000000) == GL_TIMEOUT_EXPIRED) {
+  }
+  glDeleteSync(static_cast<GLsync>(fence));
+  fence = nullptr;
+
+  Frame frame{indices_[slot], {}};
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    changed_.wait(lock, [this] { return queue_.size() < kQueued; });
+    if (!free_.empty()) {
+      frame.pixels = std::move(free_.back());
+      free_.pop_back();
+    }
+  }
+  const auto bytes = size_t(width_) * height_ * 4;
+  frame.pixels.resize(bytes);
+  const auto mapped = glMapNamedBufferRange(pixel_buffers_[slot], 0,
+                                            GLsizeiptr(bytes), GL_MAP_READ_BIT);
+  std::memcpy(frame.pixels.data(), mapped, bytes);
+  glUnmapNamedBuffer(pixel_buffers_[slot]);
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    queue_.push_back(std::move(frame));
+  }
+  changed_.notify_all();
+}
+
+void FrameRecorder::Finish() {
+  if (!writer_.joinable()) return;
+  // Oldest first, frames are written in order
+  for (auto i = captured_ > kSlots ? captured_ - kSlots : 0; i < captured_;
+       ++i) {
+    const auto slot = int(i % kSlots);
+    if (fences_[slot]) Retrieve(slot);
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  changed_.notify_all();
+  writer_.join();
+  raw_.close();
+}
+
+size_t FrameRecorder::Written() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return written_;
+}
+
+bool FrameRecorder::GetError() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return error_;
+}
+
+void FrameRecorder::WriteLoop() {
+  Profiler::SetThreadName("frame writer");
+  while (true) {
+    Frame frame;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      changed_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+      if (queue_.empty()) return;
+      frame = std::move(queue_.front());
+      queue_.pop_front();
+    }
+    // Failed frames are still taken, Capture() must not wait for them
+    const auto ok = Write(frame);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      written_ += ok;
+      error_ |= !ok;
+      free_.push_back(std::move(frame.pixels));
+    }
+    changed_.notify_all();
+  }
+}
+
+bool FrameRecorder::Write(const Frame& frame) {
+  PROFILE_ZONE("FrameRecorder::Write");
+  const auto stride = size_t(width_) * 4;
+  if (!png_) {
+    for (auto y = height_ - 1; y >= 0; --y) {
+      raw_.write(reinterpret_cast<const char*>(frame.pixels.data()) +
+                     y * stride,
+                 std::streamsize(stride));
+    }
+    return bool(raw_);
+  }
+
+  auto number = std::to_string(frame.index);
+  if (number.size() < digits_) number.insert(0, digits_ - number.size(), '0');
+  const auto path = prefix_ + number + suffix_;
+  std::vector<std::uint8_t> png;
+  if (!EncodePng(frame.pixels.data(), width_, height_, png)) {
+    std::cerr << "Cannot encode " << path << std::endl;
+    return false;
+  }
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write(reinterpret_cast<const char*>(png.data()),
+             std::streamsize(png.size()));
+  if (!file) {
+    std::cerr << "Cannot write " << path << std::endl;
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <glm/glm.hpp>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Renders into a framebuffer of its own and writes every frame out
+ *
+ * Capture() only queues a read of the frame into the next of kSlots pixel
+ * buffers, guarded by a fence, and returns; the buffer is mapped when the
+ * ring comes around to it, kSlots - 1 frames later, by when the GPU is long
+ * done with it. Mapped frames are encoded by a thread of its own while the
+ * next ones simulate and render. When it falls kQueued frames behind,
+ * Capture() waits for it rather than piling frames up.
+ *
+ * An output with one %d or %0Nd for the frame number, like
+ * "frames/%05d.png", gets one PNG per frame. Any other % in it is an
+ * error. An output without one gets all frames as one raw RGBA stream,
+ * top row first, for ffmpeg -f rawvideo -pix_fmt rgba -s WxH -i output.
+ */
+class FrameRecorder {
+public:
+  static constexpr int kSlots = 3;
+  static constexpr size_t kQueued = 8;
+
+  /**
+   * Needs a current GL context, see OffscreenContext
+   */
+  FrameRecorder(std::string output, int width, int height);
+
+  /**
+   * Finish()
+   */
+  ~FrameRecorder();
+
+  FrameRecorder(const FrameRecorder&) = delete;
+  FrameRecorder& operator=(const FrameRecorder&) = delete;
+
+  /**
+   * PHYSIM_RENDER_SIZE=WxH, else 640x480 like the windows
+   */
+  static glm::ivec2 SizeFromEnvironment();
+
+  /**
+   * Draws from here on go to the frame, viewport included
+   */
+  void Bind();
+
+  /**
+   * After the frame is drawn
+   */
+  void Capture();
+
+  /**
+   * Until every captured frame is written
+   */
+  void Finish();
+
+  int Width() const { return width_; }
+  int Height() const { return height_; }
+
+  size_t Written() const;
+  bool GetError() const;
+
+private:
+  struct Frame {
+    size_t index;
+    std::vector<std::uint8_t> pixels;  // Bottom row first, as read
+  };
+
+  // Waits for the read into slot, and hands its pixels to the writer
+  void Retrieve(int slot);
+
+  // Splits output_ around its %d or %0Nd, false if it has any other %
+  bool ParsePattern();
+
+  void WriteLoop();
+  bool Write(const Frame& frame);
+
+  std::string output_;
+  int width_, height_;
+  bool png_;
+  std::string prefix_, suffix_;  // Of the frame number
+  size_t digits_ = 0;            // Zero padded to
+  std::ofstream raw_;
+
+  unsigned framebuffer_ = 0, color_ = 0, depth_ = 0;
+  unsigned pixel_buffers_[kSlots] = {};
+  void* fences_[kSlots] = {};
+  size_t indices_[kSlots] = {};
+  size_t captured_ = 0;
+
+  // Frames for the writer, and emptied ones back for reuse
+  mutable std::mutex mutex_;
+  std::condition_variable changed_;
+  std::deque<Frame> queue_;
+  std::vector<std::vector<std::uint8_t>> free_;
+  size_t written_ = 0;
+  bool error_ = false, stop_ = false;
+  std::thread writer_;
+};
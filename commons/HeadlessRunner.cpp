@@ -0,0 +1,70 @@
+#include "HeadlessRunner.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+#include "MetricsServer.hpp"
+
+HeadlessRunner::HeadlessRunner(const char* kind)
+    : kind_(kind),
+      metrics_(kind),
+      server_(MetricsServer::FromEnvironment()),
+      checkpoints_(CheckpointWriter::FromEnvironment()) {
+  if (PerfCounters::IsRequested()) phases_.emplace();
+}
+
+HeadlessRunner::~HeadlessRunner() = default;
+
+const char* HeadlessRunner::RestorePath() {
+  return std::getenv("PHYSIM_RESTORE");
+}
+
+bool HeadlessRunner::Restore(
+    const char* path, const std::function<bool(const CheckpointFile&)>& load) {
+  const CheckpointFile file(path, kind_.c_str());
+  if (!file || !load(file)) return false;
+  first_step_ = file.GetStep();
+  std::cout << "Restored step " << first_step_ << " from " << path
+            << std::endl;
+  return true;
+}
+
+void HeadlessRunner::Pass(const char* name, const char* unit, double items,
+                          const std::function<void()>& f) {
+  metrics_.Phase(name, [&] {
+    if (phases_) {
+      phases_->Measure(name, unit, items, f);
+    } else {
+      f();
+    }
+  });
+}
+
+size_t HeadlessRunner::Run(size_t steps, float time_step,
+                           const std::function<bool()>& step,
+                           const std::function<void(Checkpoint&)>& save) {
+  const auto start = std::chrono::steady_clock::now();
+  size_t taken = 0;
+  for (auto error = false; taken < steps && !error;) {
+    error = step();
+    metrics_.EndStep(time_step, error);
+    ++taken;
+
+    // A blown up state is not worth resuming from
+    const auto current = first_step_ + taken;
+    if (!error && checkpoints_ && checkpoints_->IsDue(current)) {
+      Checkpoint checkpoint(kind_.c_str(), current);
+      save(checkpoint);
+      checkpoints_->Write(checkpoint);
+    }
+  }
+  seconds_ =
+      std::chrono::duration<float>(std::chrono::steady_clock::now() - start)
+          .count();
+  return taken;
+}
+
+void HeadlessRunner::PrintCounters(std::ostream& out) const {
+  if (phases_) phases_->Print(out);
+}
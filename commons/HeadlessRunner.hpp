@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "Checkpoint.hpp"
+#include "Metrics.hpp"
+#include "PerfCounters.hpp"
+
+class MetricsServer;
+
+/**
+ * Step loop of the headless runners, with what they share around it
+ *
+ * PHYSIM_PERF=1 adds hardware counters of every pass, PHYSIM_METRICS=port
+ * serves live metrics, PHYSIM_CHECKPOINT=file writes checkpoints and
+ * PHYSIM_RESTORE=file resumes from one. Each runner only says how to step,
+ * save and load its simulation.
+ */
+class HeadlessRunner {
+public:
+  /**
+   * kind names the simulation in metrics and checkpoints, like "fem"
+   */
+  explicit HeadlessRunner(const char* kind);
+  ~HeadlessRunner();
+
+  HeadlessRunner(const HeadlessRunner&) = delete;
+  HeadlessRunner& operator=(const HeadlessRunner&) = delete;
+
+  /**
+   * PHYSIM_RESTORE if it is set, else null
+   */
+  static const char* RestorePath();
+
+  /**
+   * Loads the checkpoint at path through load, steps go on from its step
+   */
+  bool Restore(const char* path,
+               const std::function<bool(const CheckpointFile&)>& load);
+
+  SimulationMetrics& GetMetrics() { return metrics_; }
+
+  /**
+   * Runs one pass of a step, timed and maybe counted per item
+   */
+  void Pass(const char* name, const char* unit, double items,
+            const std::function<void()>& f);
+
+  /**
+   * Calls step until steps are taken or it returns an error, and save into
+   * every checkpoint due. Returns the steps taken.
+   */
+  size_t Run(size_t steps, float time_step, const std::function<bool()>& step,
+             const std::function<void(Checkpoint&)>& save);
+
+  /**
+   * Wall time of Run()
+   */
+  float GetSeconds() const { return seconds_; }
+
+  /**
+   * Counts of every pass, with PHYSIM_PERF=1
+   */
+  void PrintCounters(std::ostream& out) const;
+
+private:
+  std::string kind_;
+  std::optional<PhaseCounters> phases_;
+  SimulationMetrics metrics_;
+  std::unique_ptr<MetricsServer> server_;
+  std::unique_ptr<CheckpointWriter> checkpoints_;
+
+  std::uint64_t first_step_ = 0;
+  float seconds_ = 0.f;
+};
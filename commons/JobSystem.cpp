@@ -0,0 +1,201 @@
+#include "JobSystem.hpp"
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+class JobSystem::Job {
+public:
+  std::function<void()> fn;
+
+  // Unfinished dependencies, plus one until Spawn() is done with them
+  std::atomic<size_t> pending{1};
+
+  std::mutex mutex;  // Guards dependents, and done against them
+  std::atomic<bool> done{false};
+  std::vector<Handle> dependents;
+};
+
+namespace {
+// Pool whose worker the thread is, if any
+thread_local const JobSystem* current_pool = nullptr;
+thread_local size_t current_queue = 0;
+
+// Attempts before an idle worker blocks
+constexpr int kSpins = 64;
+
+void Pin(size_t worker) {
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(worker % std::max(1U, std::thread::hardware_concurrency()), &set);
+  if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set)) {
+    std::cerr << "Cannot pin worker " << worker << std::endl;
+  }
+#endif
+}
+}  // namespace
+
+JobSystem::JobSystem(size_t threads, bool pin) {
+  if (!threads) threads = std::max(1U, std::thread::hardware_concurrency());
+  for (size_t i = 0; i < threads; ++i) {
+    queues_.push_back(std::make_unique<Queue>());
+  }
+  for (size_t i = 1; i < threads; ++i) {
+    threads_.emplace_back(&JobSystem::Loop, this, i, pin);
+  }
+}
+
+JobSystem::~JobSystem() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  wake_.notify_all();
+  for (auto& t : threads_) t.join();
+}
+
+JobSystem& JobSystem::Global() {
+  static JobSystem pool([] {
+    const auto threads = std::getenv("PHYSIM_THREADS");
+    return threads ? size_t(std::strtoul(threads, nullptr, 10)) : 0;
+  }(), [] {
+    const auto pin = std::getenv("PHYSIM_PIN");
+    return pin && std::string(pin) != "0";
+  }());
+  return pool;
+}
+
+JobSystem::Handle JobSystem::Spawn(std::function<void()> fn,
+                                   const std::vector<Handle>& after) {
+  auto job = std::make_shared<Job>();
+  job->fn = std::move(fn);
+  job->pending = after.size() + 1;
+  for (const auto& dependency : after) {
+    if (dependency) {
+      std::lock_guard<std::mutex> lock(dependency->mutex);
+      if (!dependency->done) {
+        dependency->dependents.push_back(job);
+        continue;
+      }
+    }
+    --job->pending;
+  }
+  Release(job);
+  return job;
+}
+
+void JobSystem::Wait(const Handle& job) {
+  if (!job) return;
+  const auto queue = Current();
+  while (!job->done) {
+    if (auto next = Pop(queue)) {
+      Run(next);
+      continue;
+    }
+
+    // Woken by the job finishing, or by new work to help with
+    std::unique_lock<std::mutex> lock(mutex_);
+    ++sleeping_;
+    ++waiting_;
+    wake_.wait(lock, [&] { return job->done || queued_ > 0; });
+    --waiting_;
+    --sleeping_;
+  }
+}
+
+size_t JobSystem::Current() const {
+  return current_pool == this ? current_queue : 0;
+}
+
+void JobSystem::Push(Handle job) {
+  // Counted first so it never drops below the jobs really queued
+  ++queued_;
+  {
+    auto& queue = *queues_[Current()];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.jobs.push_back(std::move(job));
+  }
+  // Either this sees the sleeper, or the sleeper sees the job
+  if (sleeping_ > 0) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    wake_.notify_all();
+  }
+}
+
+JobSystem::Handle JobSystem::Pop(size_t queue) {
+  if (!queued_) return nullptr;
+  {
+    auto& own = *queues_[queue];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.jobs.empty()) {
+      auto job = std::move(own.jobs.back());
+      own.jobs.pop_back();
+      --queued_;
+      return job;
+    }
+  }
+  for (size_t k = 1; k < queues_.size(); ++k) {
+    auto& victim = *queues_[(queue + k) % queues_.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.jobs.empty()) {
+      auto job = std::move(victim.jobs.front());
+      victim.jobs.pop_front();
+      --queued_;
+      return job;
+    }
+  }
+  return nullptr;
+}
+
+void JobSystem::Run(const Handle& job) {
+  job->fn();
+  job->fn = nullptr;  // Captures go now, not with the last handle
+
+  std::vector<Handle> dependents;
+  {
+    std::lock_guard<std::mutex> lock(job->mutex);
+    job->done = true;
+    dependents.swap(job->dependents);
+  }
+  for (const auto& dependent : dependents) Release(dependent);
+
+  if (waiting_ > 0) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    wake_.notify_all();
+  }
+}
+
+void JobSystem::Release(const Handle& job) {
+  if (--job->pending == 0) Push(job);
+}
+
+void JobSystem::Loop(size_t worker, bool pin) {
+  current_pool = this;
+  current_queue = worker;
+  if (pin) Pin(worker);
+#ifdef PHYSIM_PROFILE
+  Profiler::SetThreadName("worker " + std::to_string(worker));
+#endif
+
+  for (int idle = 0;;) {
+    if (auto job = Pop(worker)) {
+      Run(job);
+      idle = 0;
+    } else if (++idle < kSpins) {
+      std::this_thread::yield();
+    } else {
+      std::unique_lock<std::mutex> lock(mutex_);
+      ++sleeping_;
+      wake_.wait(lock, [this] { return stop_ || queued_ > 0; });
+      --sleeping_;
+      if (stop_) return;
+      idle = 0;
+    }
+  }
+}
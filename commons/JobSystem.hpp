@@ -0,0 +1,155 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Profiler.hpp"
+
+/**
+ * Work-stealing thread pool shared by the simulators
+ *
+ * Every worker has its own deque. It pushes and pops at the back, others
+ * steal from the front, so a worker keeps running what it spawned last while
+ * thieves take the oldest jobs. Threads outside the pool share one more
+ * deque. Waiting for a job runs other jobs until it is done, so jobs can
+ * spawn and wait on jobs of their own without tying up a worker.
+ *
+ * A pool of size n starts n - 1 threads, whoever waits is the n-th, so a
+ * pool of size 1 runs everything inline.
+ */
+class JobSystem {
+public:
+  class Job;
+  using Handle = std::shared_ptr<Job>;
+
+  /**
+   * threads includes the caller, 0 for one per hardware thread
+   * pin binds worker i to CPU i, the caller is left where it is.
+   */
+  explicit JobSystem(size_t threads = 0, bool pin = false);
+  ~JobSystem();
+
+  JobSystem(const JobSystem&) = delete;
+  JobSystem& operator=(const JobSystem&) = delete;
+
+  /**
+   * The pool of the process
+   * One thread per hardware thread, PHYSIM_THREADS overrides the count and
+   * PHYSIM_PIN=1 pins the workers.
+   */
+  static JobSystem& Global();
+
+  size_t Size() const { return queues_.size(); }
+
+  /**
+   * Runs fn once every job in after is done
+   */
+  Handle Spawn(std::function<void()> fn, const std::vector<Handle>& after = {});
+
+  /**
+   * Returns once job is done, running other jobs meanwhile
+   */
+  void Wait(const Handle& job);
+
+  /**
+   * Calls fn(begin, end) over [0, n) in ranges of at most grain items
+   * At most max_workers threads take part, 0 for all of them. Ranges are
+   * handed out from a shared counter, so uneven ranges balance themselves.
+   */
+  template <typename F>
+  void ParallelFor(size_t n, size_t grain, F&& fn, size_t max_workers = 0);
+
+private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Handle> jobs;
+  };
+
+  // Queue of the calling thread
+  size_t Current() const;
+
+  void Push(Handle job);
+
+  Handle Pop(size_t queue);
+
+  void Run(const Handle& job);
+
+  // Counts down a dependency, pushes the job after the last one
+  void Release(const Handle& job);
+
+  void Loop(size_t worker, bool pin);
+
+  std::vector<std::unique_ptr<Queue>> queues_;  // 0 is for outside threads
+  std::vector<std::thread> threads_;
+
+  std::atomic<size_t> queued_{0};
+  std::atomic<size_t> sleeping_{0}, waiting_{0};
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  bool stop_ = false;
+};
+
+/**
+ * A simulator's share of a pool, at most a given number of its threads
+ */
+class JobArena {
+public:
+  /**
+   * threads 0 for the whole pool
+   */
+  explicit JobArena(size_t threads = 0,
+                    JobSystem& pool = JobSystem::Global())
+      : pool_(&pool) {
+    SetThreads(threads);
+  }
+
+  void SetThreads(size_t threads) {
+    threads_ = threads ? std::min(threads, pool_->Size()) : pool_->Size();
+  }
+  size_t GetThreads() const { return threads_; }
+
+  JobSystem& GetPool() const { return *pool_; }
+
+  template <typename F>
+  void ParallelFor(size_t n, size_t grain, F&& fn) const {
+    pool_->ParallelFor(n, grain, std::forward<F>(fn), threads_);
+  }
+
+private:
+  JobSystem* pool_;
+  size_t threads_;
+};
+
+template <typename F>
+void JobSystem::ParallelFor(size_t n, size_t grain, F&& fn,
+                            size_t max_workers) {
+  grain = std::max<size_t>(grain, 1);
+  auto lanes = std::min((n + grain - 1) / grain, Size());
+  if (max_workers) lanes = std::min(lanes, max_workers);
+
+  std::atomic<size_t> next{0};
+  const auto work = [&] {
+    PROFILE_ZONE("ParallelFor");
+    for (size_t begin; (begin = next.fetch_add(grain)) < n;) {
+      fn(begin, std::min(begin + grain, n));
+    }
+  };
+  if (lanes <= 1) {
+    work();
+    return;
+  }
+
+  std::vector<Handle> jobs;
+  jobs.reserve(lanes - 1);
+  for (size_t i = 1; i < lanes; ++i) jobs.push_back(Spawn(work));
+  work();
+  for (const auto& job : jobs) Wait(job);
+}
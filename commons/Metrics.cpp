@@ -0,0 +1,136 @@
+#include "Metrics.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <sstream>
+
+namespace {
+// Prometheus floats, with its spelling of the special values
+void WriteValue(std::ostream& out, double value) {
+  if (std::isnan(value)) {
+    out << "NaN";
+  } else if (std::isinf(value)) {
+    out << (value > 0 ? "+Inf" : "-Inf");
+  } else {
+    out << value;
+  }
+}
+
+void WriteSample(std::ostream& out, const std::string& name,
+                 const std::string& labels, double value) {
+  out << name;
+  if (!labels.empty()) out << '{' << labels << '}';
+  out << ' ';
+  WriteValue(out, value);
+  out << '\n';
+}
+}  // namespace
+
+MetricsRegistry& MetricsRegistry::Global() {
+  static MetricsRegistry registry;
+  return registry;
+}
+
+MetricsRegistry::Family& MetricsRegistry::GetFamily(const std::string& name,
+                                                    const std::string& help,
+                                                    bool counter) {
+  for (const auto& f : families_) {
+    if (f->name == name && f->counter == counter) return *f;
+  }
+  families_.push_back(std::make_unique<Family>());
+  auto& f = *families_.back();
+  f.name = name;
+  f.help = help;
+  f.counter = counter;
+  return f;
+}
+
+Counter& MetricsRegistry::GetCounter(const std::string& name,
+                                     const std::string& help,
+                                     const std::string& labels) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto& f = GetFamily(name, help, true);
+  for (const auto& c : f.counters) {
+    if (c.first == labels) return *c.second;
+  }
+  f.counters.emplace_back(labels, std::make_unique<Counter>());
+  return *f.counters.back().second;
+}
+
+Gauge& MetricsRegistry::GetGauge(const std::string& name,
+                                 const std::string& help,
+                                 const std::string& labels) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto& f = GetFamily(name, help, false);
+  for (const auto& g : f.gauges) {
+    if (g.first == labels) return *g.second;
+  }
+  f.gauges.emplace_back(labels, std::make_unique<Gauge>());
+  return *f.gauges.back().second;
+}
+
+std::string MetricsRegistry::Render() const {
+  std::ostringstream out;
+  out.precision(17);
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto& f : families_) {
+    out << "# HELP " << f->name << ' ' << f->help << '\n'
+        << "# TYPE " << f->name << ' ' << (f->counter ? "counter" : "gauge")
+        << '\n';
+    for (const auto& c : f->counters) {
+      WriteSample(out, f->name, c.first, c.second->Get());
+    }
+    for (const auto& g : f->gauges) {
+      WriteSample(out, f->name, g.first, g.second->Get());
+    }
+  }
+  return out.str();
+}
+
+SimulationMetrics::SimulationMetrics(const std::string& simulation,
+                                     MetricsRegistry& registry)
+    : registry_(registry),
+      labels_("simulation=\"" + simulation + "\""),
+      steps_(registry.GetCounter("physim_steps_total", "Steps taken",
+                                 labels_)),
+      simulated_(registry.GetCounter("physim_simulated_seconds_total",
+                                     "Simulated time", labels_)),
+      errors_(registry.GetCounter(
+          "physim_errors_total",
+          "Steps that blew up, with NaN or infinite state", labels_)),
+      steps_per_second_(registry.GetGauge(
+          "physim_steps_per_second", "Steps per wall second, over about "
+          "a second", labels_)),
+      window_start_(std::chrono::steady_clock::now()) {}
+
+void SimulationMetrics::EndStep(double dt, bool error) {
+  steps_.Add();
+  simulated_.Add(dt);
+  if (error && !error_) errors_.Add();
+  error_ = error;
+
+  ++window_steps_;
+  const auto now = std::chrono::steady_clock::now();
+  const std::chrono::duration<double> elapsed = now - window_start_;
+  if (elapsed.count() >= 1.) {
+    steps_per_second_.Set(window_steps_ / elapsed.count());
+    window_start_ = now;
+    window_steps_ = 0;
+  }
+}
+
+Gauge& SimulationMetrics::GetGauge(const std::string& name,
+                                   const std::string& help) {
+  return registry_.GetGauge(name, help, labels_);
+}
+
+Counter& SimulationMetrics::GetPhase(const char* phase) {
+  for (const auto& p : phases_) {
+    if (p.first == phase || !std::strcmp(p.first, phase)) return *p.second;
+  }
+  phases_.emplace_back(
+      phase, &registry_.GetCounter("physim_phase_seconds_total",
+                                   "Wall time in each phase of a step",
+                                   labels_ + ",phase=\"" + phase + "\""));
+  return *phases_.back().second;
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Value only ever added to, like steps taken
+ * Updates are a lock-free atomic add, safe from any thread.
+ */
+class Counter {
+public:
+  void Add(double amount = 1.) {
+    auto value = value_.load(std::memory_order_relaxed);
+    while (!value_.compare_exchange_weak(value, value + amount,
+                                         std::memory_order_relaxed)) {
+    }
+  }
+  double Get() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+  std::atomic<double> value_{0.};
+};
+
+/**
+ * Value that goes up and down, like a particle count
+ */
+class Gauge {
+public:
+  void Set(double value) { value_.store(value, std::memory_order_relaxed); }
+  double Get() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+  std::atomic<double> value_{0.};
+};
+
+/**
+ * Counters and gauges by name and labels, rendered for Prometheus
+ *
+ * Registering takes a lock and returns a reference that stays valid, so
+ * step loops register once and then only touch atomics. Rendering takes
+ * the same lock and reads the atomics, it never waits on a step.
+ */
+class MetricsRegistry {
+public:
+  static MetricsRegistry& Global();
+
+  /**
+   * labels like simulation="fem", the same name, labels and kind give the
+   * same metric
+   */
+  Counter& GetCounter(const std::string& name, const std::string& help,
+                      const std::string& labels = "");
+  Gauge& GetGauge(const std::string& name, const std::string& help,
+                  const std::string& labels = "");
+
+  /**
+   * Text exposition format 0.0.4
+   */
+  std::string Render() const;
+
+private:
+  struct Family {
+    std::string name, help;
+    bool counter;
+    std::vector<std::pair<std::string, std::unique_ptr<Counter>>> counters;
+    std::vector<std::pair<std::string, std::unique_ptr<Gauge>>> gauges;
+  };
+
+  Family& GetFamily(const std::string& name, const std::string& help,
+                    bool counter);
+
+  mutable std::mutex mutex_;
+  std::vector<std::unique_ptr<Family>> families_;
+};
+
+/**
+ * Metrics of one simulation, updated by its step loop
+ *
+ * Steps, simulated time, blow-ups (steps that end in error after one that
+ * did not) and the time of every phase, all labelled with the simulation.
+ * Simulation specific gauges come from GetGauge().
+ */
+class SimulationMetrics {
+public:
+  explicit SimulationMetrics(
+      const std::string& simulation,
+      MetricsRegistry& registry = MetricsRegistry::Global());
+
+  /**
+   * Runs f, adding its wall time to the phase
+   */
+  template <typename F>
+  void Phase(const char* phase, F&& f) {
+    const auto start = std::chrono::steady_clock::now();
+    f();
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    GetPhase(phase).Add(elapsed.count());
+  }
+
+  void EndStep(double dt, bool error);
+
+  Gauge& GetGauge(const std::string& name, const std::string& help);
+
+private:
+  Counter& GetPhase(const char* phase);
+
+  MetricsRegistry& registry_;
+  std::string labels_;
+
+  Counter &steps_, &simulated_, &errors_;
+  Gauge& steps_per_second_;
+  std::vector<std::pair<const char*, Counter*>> phases_;
+
+  // Steps/s over windows of about a second
+  bool error_ = false;
+  std::chrono::steady_clock::time_point window_start_;
+  size_t window_steps_ = 0;
+};
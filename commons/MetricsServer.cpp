@@ -0,0 +1,164 @@
+#include "MetricsServer.hpp"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace {
+#ifdef __linux__
+// Closes fd keeping errno for the message
+int Fail(int fd) {
+  const auto error = errno;
+  if (fd >= 0) close(fd);
+  errno = error;
+  return -1;
+}
+
+// Socket listening on address, -1 on failure
+int Listen(const std::string& address, std::string& unix_path) {
+  int fd = -1;
+  if (address.compare(0, 5, "unix:") == 0) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    unix_path = address.substr(5);
+    if (unix_path.empty() || unix_path.size() >= sizeof(addr.sun_path)) {
+      std::cerr << "Bad socket path " << unix_path << std::endl;
+      return -1;
+    }
+    std::strcpy(addr.sun_path, unix_path.c_str());
+    unlink(unix_path.c_str());  // Left over by a run that crashed
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd >= 0 &&
+        bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+      fd = Fail(fd);
+    }
+  } else {
+    const auto colon = address.rfind(':');
+    const auto host =
+        colon == std::string::npos ? "127.0.0.1" : address.substr(0, colon);
+    const auto port = std::atoi(
+        address.c_str() + (colon == std::string::npos ? 0 : colon + 1));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(std::uint16_t(port));
+    if (port <= 0 || port > 65535 ||
+        inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1) {
+      std::cerr << "Bad address " << address << std::endl;
+      return -1;
+    }
+    fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    const int on = 1;
+    if (fd >= 0) setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    if (fd >= 0 &&
+        bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+      fd = Fail(fd);
+    }
+  }
+  if (fd >= 0 && listen(fd, 8) < 0) fd = Fail(fd);
+  if (fd < 0) {
+    std::cerr << "Cannot serve metrics on " << address << ": "
+              << std::strerror(errno) << std::endl;
+  }
+  return fd;
+}
+
+void SendAll(int fd, const std::string& data) {
+  for (size_t sent = 0; sent < data.size();) {
+    const auto n =
+        send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+    if (n <= 0) return;
+    sent += size_t(n);
+  }
+}
+#endif
+}  // namespace
+
+MetricsServer::MetricsServer(const std::string& address,
+                             MetricsRegistry& registry)
+    : registry_(registry) {
+#ifdef __linux__
+  fd_ = Listen(address, unix_path_);
+  if (fd_ >= 0) thread_ = std::thread(&MetricsServer::Loop, this);
+#else
+  std::cerr << "Metrics are served on Linux only, not on " << address
+            << std::endl;
+#endif
+}
+
+MetricsServer::~MetricsServer() {
+  stop_ = true;
+  if (thread_.joinable()) thread_.join();
+#ifdef __linux__
+  if (fd_ >= 0) close(fd_);
+  if (!unix_path_.empty()) unlink(unix_path_.c_str());
+#endif
+}
+
+std::unique_ptr<MetricsServer> MetricsServer::FromEnvironment() {
+  const auto address = std::getenv("PHYSIM_METRICS");
+  if (!address || !*address) return nullptr;
+  auto server = std::make_unique<MetricsServer>(address);
+  if (!server->IsListening()) return nullptr;
+  std::cout << "Serving metrics on " << address << std::endl;
+  return server;
+}
+
+void MetricsServer::Loop() {
+#ifdef __linux__
+  // Wakes up now and then to notice stop_
+  pollfd listener{fd_, POLLIN, 0};
+  while (!stop_) {
+    if (poll(&listener, 1, 100) <= 0) continue;
+    const auto client = accept4(fd_, nullptr, nullptr, SOCK_CLOEXEC);
+    if (client < 0) continue;
+    Serve(client);
+    close(client);
+  }
+#endif
+}
+
+void MetricsServer::Serve(int client) const {
+#ifdef __linux__
+  // A slow client gets a second, then the next one's turn
+  timeval timeout{1, 0};
+  setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+  std::string request;
+  char buffer[1024];
+  while (request.find("\r\n\r\n") == std::string::npos &&
+         request.size() < 8192) {
+    const auto n = recv(client, buffer, sizeof(buffer), 0);
+    if (n <= 0) break;
+    request.append(buffer, size_t(n));
+  }
+
+  const auto line = request.substr(0, request.find("\r\n"));
+  const auto target = line.substr(0, line.find(' ', 4));
+  std::string status = "200 OK", type = "text/plain; version=0.0.4", body;
+  if (target == "GET /metrics" || target == "GET /") {
+    body = registry_.Render();
+  } else if (line.compare(0, 4, "GET ") != 0) {
+    status = "405 Method Not Allowed";
+    body = "Only GET\n";
+    type = "text/plain";
+  } else {
+    status = "404 Not Found";
+    body = "Metrics are at /metrics\n";
+    type = "text/plain";
+  }
+  SendAll(client, "HTTP/1.1 " + status + "\r\nContent-Type: " + type +
+                      "\r\nContent-Length: " + std::to_string(body.size()) +
+                      "\r\nConnection: close\r\n\r\n" + body);
+#endif
+}
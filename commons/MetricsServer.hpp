@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "Metrics.hpp"
+
+/**
+ * Serves a registry at GET /metrics over HTTP, on a thread of its own
+ *
+ * One request at a time, each connection is closed after its answer.
+ * Scrapes only read the registry, simulation threads never wait on them.
+ */
+class MetricsServer {
+public:
+  /**
+   * address is "port" or "host:port" for TCP, localhost when no host is
+   * given, or "unix:path" for a Unix socket
+   */
+  explicit MetricsServer(const std::string& address,
+                         MetricsRegistry& registry = MetricsRegistry::Global());
+  ~MetricsServer();
+
+  MetricsServer(const MetricsServer&) = delete;
+  MetricsServer& operator=(const MetricsServer&) = delete;
+
+  /**
+   * False if the address could not be bound, the reason went to std::cerr
+   */
+  bool IsListening() const { return fd_ >= 0; }
+
+  /**
+   * A server on PHYSIM_METRICS if it is set and can be bound, else null
+   */
+  static std::unique_ptr<MetricsServer> FromEnvironment();
+
+private:
+  void Loop();
+
+  // Answers one connection
+  void Serve(int client) const;
+
+  MetricsRegistry& registry_;
+  std::string unix_path_;  // Removed on exit
+  int fd_ = -1;
+  std::atomic<bool> stop_{false};
+  std::thread thread_;
+};
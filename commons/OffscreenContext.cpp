@@ -0,0 +1,99 @@
+#include "OffscreenContext.hpp"
+
+#include <glad/glad.h>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <cstring>
+#include <iostream>
+
+namespace {
+EGLDisplay GetDisplay() {
+  // Client extensions, or null where EGL has none
+  const auto extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+  if (extensions && std::strstr(extensions, "EGL_MESA_platform_surfaceless")) {
+    const auto get_platform_display =
+        reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+            eglGetProcAddress("eglGetPlatformDisplayEXT"));
+    if (get_platform_display) {
+      const auto display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA,
+                                                EGL_DEFAULT_DISPLAY, nullptr);
+      if (display != EGL_NO_DISPLAY && eglInitialize(display, nullptr, nullptr))
+        return display;
+    }
+  }
+  const auto display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  if (display != EGL_NO_DISPLAY && eglInitialize(display, nullptr, nullptr))
+    return display;
+  return EGL_NO_DISPLAY;
+}
+}  // namespace
+
+OffscreenContext::OffscreenContext() {
+  const auto display = GetDisplay();
+  if (display == EGL_NO_DISPLAY) {
+    std::cerr << "No EGL display" << std::endl;
+    return;
+  }
+  display_ = display;
+
+  const EGLint config_attributes[] = {EGL_SURFACE_TYPE,
+                                      EGL_PBUFFER_BIT,
+                                      EGL_RENDERABLE_TYPE,
+                                      EGL_OPENGL_BIT,
+                                      EGL_NONE};
+  EGLConfig config;
+  EGLint configs = 0;
+  if (!eglBindAPI(EGL_OPENGL_API) ||
+      !eglChooseConfig(display, config_attributes, &config, 1, &configs) ||
+      !configs) {
+    std::cerr << "No EGL config for desktop GL" << std::endl;
+    return;
+  }
+
+  // 4.5 for the direct state access of the renderers
+  const EGLint context_attributes[] = {EGL_CONTEXT_MAJOR_VERSION,
+                                       4,
+                                       EGL_CONTEXT_MINOR_VERSION,
+                                       5,
+                                       EGL_CONTEXT_OPENGL_PROFILE_MASK,
+                                       EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                                       EGL_NONE};
+  const auto context =
+      eglCreateContext(display, config, EGL_NO_CONTEXT, context_attributes);
+  if (context == EGL_NO_CONTEXT) {
+    std::cerr << "Cannot create a GL 4.5 context: 0x" << std::hex
+              << eglGetError() << std::dec << std::endl;
+    return;
+  }
+
+  auto current = eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE,
+                                context) == EGL_TRUE;
+  if (!current) {
+    // No EGL_KHR_surfaceless_context, draw to the framebuffer object anyway
+    const EGLint surface_attributes[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1,
+                                         EGL_NONE};
+    const auto surface =
+        eglCreatePbufferSurface(display, config, surface_attributes);
+    if (surface != EGL_NO_SURFACE) {
+      surface_ = surface;
+      current = eglMakeCurrent(display, surface, surface, context) == EGL_TRUE;
+    }
+  }
+  if (!current || gladLoadGLLoader(reinterpret_cast<GLADloadproc>(
+                      eglGetProcAddress)) == 0) {
+    std::cerr << "Cannot make the GL context current" << std::endl;
+    eglDestroyContext(display, context);
+    return;
+  }
+  context_ = context;
+}
+
+OffscreenContext::~OffscreenContext() {
+  if (!display_) return;
+  eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+  if (context_) eglDestroyContext(display_, context_);
+  if (surface_) eglDestroySurface(display_, surface_);
+  eglTerminate(display_);
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+/**
+ * GL context without a window or a display server, through EGL
+ *
+ * Mesa's surfaceless platform is preferred, so llvmpipe renders on servers
+ * without a GPU or X; any other EGL display is used through a 1x1 pbuffer
+ * when it cannot make a context current without a surface. Draws go to a
+ * framebuffer object, see FrameRecorder. The context is current on the
+ * constructing thread and GL is loaded by then.
+ */
+class OffscreenContext {
+public:
+  OffscreenContext();
+  ~OffscreenContext();
+
+  OffscreenContext(const OffscreenContext&) = delete;
+  OffscreenContext& operator=(const OffscreenContext&) = delete;
+
+  /**
+   * False with a message on std::cerr if there is no context
+   */
+  explicit operator bool() const { return context_ != nullptr; }
+
+private:
+  // EGL handles, kept out of the header like GLsync elsewhere
+  void* display_ = nullptr;
+  void* context_ = nullptr;
+  void* surface_ = nullptr;
+};
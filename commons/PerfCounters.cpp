@@ -0,0 +1,170 @@
+#include "PerfCounters.hpp"
+
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <limits>
+#include <utility>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+const char* const kNames[] = {"cycles",       "instructions",  "llc_misses",
+                              "dtlb_misses",  "branch_misses", "task_clock_ns"};
+
+#ifdef __linux__
+// Type and config of every event, in the order of PerfCounters::Event
+const std::pair<std::uint32_t, std::uint64_t> kEvents[] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL |
+                             PERF_COUNT_HW_CACHE_OP_READ << 8 |
+                             PERF_COUNT_HW_CACHE_RESULT_MISS << 16},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB |
+                             PERF_COUNT_HW_CACHE_OP_READ << 8 |
+                             PERF_COUNT_HW_CACHE_RESULT_MISS << 16},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK}};
+
+std::vector<int> GetThreadIds() {
+  std::vector<int> tids;
+  if (const auto dir = opendir("/proc/self/task")) {
+    while (const auto entry = readdir(dir)) {
+      if (entry->d_name[0] != '.') tids.push_back(std::atoi(entry->d_name));
+    }
+    closedir(dir);
+  }
+  return tids;
+}
+
+int Open(int event, int tid) {
+  perf_event_attr attr{};
+  attr.size = sizeof(attr);
+  attr.type = kEvents[event].first;
+  attr.config = kEvents[event].second;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format =
+      PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return int(syscall(SYS_perf_event_open, &attr, tid, -1, -1,
+                     PERF_FLAG_FD_CLOEXEC));
+}
+#endif
+}  // namespace
+
+const char* PerfCounters::GetName(int event) { return kNames[event]; }
+
+bool PerfCounters::IsRequested() {
+  const auto perf = std::getenv("PHYSIM_PERF");
+  return perf && std::string(perf) != "0";
+}
+
+PerfCounters::PerfCounters() {
+#ifdef __linux__
+  const auto tids = GetThreadIds();
+  for (int event = 0; event < kEventCount; ++event) {
+    // All threads or none, a partial count would look like a real one
+    std::vector<Counter> opened;
+    for (const auto tid : tids) {
+      const auto fd = Open(event, tid);
+      if (fd < 0) break;
+      opened.push_back({fd, event});
+    }
+    if (opened.size() == tids.size()) {
+      counters_.insert(counters_.end(), opened.begin(), opened.end());
+    } else {
+      for (const auto& c : opened) close(c.fd);
+    }
+  }
+#endif
+}
+
+PerfCounters::~PerfCounters() {
+#ifdef __linux__
+  for (const auto& c : counters_) close(c.fd);
+#endif
+}
+
+bool PerfCounters::IsAvailable(int event) const {
+  for (const auto& c : counters_) {
+    if (c.event == event) return true;
+  }
+  return false;
+}
+
+bool PerfCounters::IsAvailable() const {
+  for (int event = 0; event < kEventCount; ++event) {
+    if (event != kTaskClock && IsAvailable(event)) return true;
+  }
+  return false;
+}
+
+PerfCounters::Values PerfCounters::Read() const {
+  Values values;
+  values.fill(std::numeric_limits<double>::quiet_NaN());
+#ifdef __linux__
+  for (const auto& c : counters_) {
+    std::uint64_t data[3];  // Value, time enabled, time running
+    if (read(c.fd, data, sizeof(data)) != sizeof(data)) continue;
+    auto& value = values[c.event];
+    if (std::isnan(value)) value = 0;
+    // Scaled up for the time the event was multiplexed out
+    if (data[2]) value += double(data[0]) * data[1] / data[2];
+  }
+#endif
+  return values;
+}
+
+void PhaseCounters::Add(const char* phase, const char* unit, double items,
+                        const PerfCounters::Values& before,
+                        const PerfCounters::Values& after) {
+  auto it = phases_.begin();
+  while (it != phases_.end() && it->name != phase) ++it;
+  if (it == phases_.end()) {
+    phases_.push_back({phase, unit});
+    it = phases_.end() - 1;
+  }
+  it->items += items;
+  for (int event = 0; event < PerfCounters::kEventCount; ++event) {
+    it->totals[event] += after[event] - before[event];
+  }
+}
+
+void PhaseCounters::Print(std::ostream& out) const {
+  if (!counters_.IsAvailable()) {
+    out << "No hardware counters, perf_event_paranoid or no PMU in a VM"
+        << std::endl;
+  }
+  out << std::left << std::setw(20) << "phase" << std::setw(12) << "per"
+      << std::right;
+  for (int event = 0; event < PerfCounters::kEventCount; ++event) {
+    out << std::setw(15) << PerfCounters::GetName(event);
+  }
+  out << std::setw(8) << "IPC" << std::endl;
+
+  for (const auto& p : phases_) {
+    out << std::left << std::setw(20) << p.name << std::setw(12) << p.unit
+        << std::right;
+    for (const auto total : p.totals) {
+      if (std::isnan(total)) {
+        out << std::setw(15) << "-";
+      } else {
+        out << std::setw(15) << total / p.items;
+      }
+    }
+    const auto ipc = p.totals[PerfCounters::kInstructions] /
+                     p.totals[PerfCounters::kCycles];
+    if (std::isnan(ipc)) {
+      out << std::setw(8) << "-";
+    } else {
+      out << std::setw(8) << std::setprecision(3) << ipc
+          << std::setprecision(6);
+    }
+    out << std::endl;
+  }
+}
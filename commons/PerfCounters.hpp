@@ -0,0 +1,99 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * Hardware counters of the whole process, through Linux perf_event_open
+ *
+ * Every thread alive when the counters are opened is counted, so open them
+ * after the job system started its workers. Only user space is counted,
+ * which the default perf_event_paranoid allows. Events the kernel or the
+ * CPU refuses, as in most VMs, read as NaN and everything else still works.
+ * Counts are scaled up when the kernel multiplexes events.
+ */
+class PerfCounters {
+public:
+  enum Event {
+    kCycles,
+    kInstructions,
+    kLLCMisses,
+    kDTLBMisses,
+    kBranchMisses,
+    kTaskClock,  // Nanoseconds on a CPU summed over threads, always there
+    kEventCount
+  };
+  using Values = std::array<double, kEventCount>;
+
+  static const char* GetName(int event);
+
+  /**
+   * PHYSIM_PERF=1 asks the headless runners for counters
+   */
+  static bool IsRequested();
+
+  PerfCounters();
+  ~PerfCounters();
+
+  PerfCounters(const PerfCounters&) = delete;
+  PerfCounters& operator=(const PerfCounters&) = delete;
+
+  bool IsAvailable(int event) const;
+
+  /**
+   * Whether any hardware event is
+   */
+  bool IsAvailable() const;
+
+  /**
+   * Counts so far, NaN for events that are not available
+   */
+  Values Read() const;
+
+private:
+  struct Counter {
+    int fd;
+    int event;
+  };
+  std::vector<Counter> counters_;
+};
+
+/**
+ * Counters of named phases over many runs, per item of work
+ */
+class PhaseCounters {
+public:
+
+  /**
+   * Runs f, adding its counts and items to the phase
+   */
+  template <typename F>
+  void Measure(const char* phase, const char* unit, double items, F&& f) {
+    const auto before = counters_.Read();
+    f();
+    Add(phase, unit, items, before, counters_.Read());
+  }
+
+  /**
+   * Table of counts per item with IPC, one row per phase
+   * Says so when there are no hardware counters.
+   */
+  void Print(std::ostream& out) const;
+
+private:
+  struct Phase {
+    std::string name, unit;
+    double items = 0;
+    PerfCounters::Values totals{};
+  };
+
+  void Add(const char* phase, const char* unit, double items,
+           const PerfCounters::Values& before,
+           const PerfCounters::Values& after);
+
+  PerfCounters counters_;
+  std::vector<Phase> phases_;
+};
@@ -0,0 +1,207 @@
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PROFILE_TSC
+#endif
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+// Written only by its thread, slots are atomic so readers never race it
+struct Ring {
+  struct Slot {
+    std::atomic<const char*> name{nullptr};
+    std::atomic<std::uint64_t> begin{0}, end{0};
+    std::atomic<std::uint32_t> depth{0};
+  };
+
+  explicit Ring(std::uint32_t index)
+      : index(index), name("thread " + std::to_string(index)) {}
+
+  std::uint32_t index;
+  std::string name;  // Guarded by State::mutex
+  std::atomic<std::uint64_t> head{0};  // Zones ever written
+  Slot slots[Profiler::kCapacity];
+  std::uint32_t depth = 0;  // Zones open on the thread
+};
+
+struct State {
+  State() : start_ticks(Profiler::Now()), start_time(Clock::now()) {}
+
+  std::mutex mutex;  // Guards rings and their names
+  std::vector<std::unique_ptr<Ring>> rings;
+
+  std::uint64_t start_ticks;
+  Clock::time_point start_time;
+};
+
+// Never destroyed, workers may still close zones during exit
+State& GetState() {
+  static const auto state = [] {
+    const auto trace = std::getenv("PHYSIM_TRACE");
+    if (trace && *trace) {
+      std::atexit([] {
+        Profiler::WriteChromeTrace(std::getenv("PHYSIM_TRACE"));
+      });
+    }
+    return new State;
+  }();
+  return *state;
+}
+
+thread_local Ring* current_ring = nullptr;
+
+Ring& GetRing() {
+  if (!current_ring) {
+    auto& state = GetState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.rings.push_back(
+        std::make_unique<Ring>(std::uint32_t(state.rings.size())));
+    current_ring = state.rings.back().get();
+  }
+  return *current_ring;
+}
+
+void WriteEscaped(std::ostream& out, const std::string& text) {
+  for (const auto c : text) {
+    if (c == '"' || c == '\\') out << '\\';
+    out << c;
+  }
+}
+}  // namespace
+
+std::atomic<bool> Profiler::enabled_{true};
+
+std::uint64_t Profiler::Now() {
+#ifdef PROFILE_TSC
+  return __rdtsc();
+#else
+  return Clock::now().time_since_epoch().count();
+#endif
+}
+
+double Profiler::TicksPerSecond() {
+#ifdef PROFILE_TSC
+  // Against steady_clock since the first zone, over at least 10ms
+  auto& state = GetState();
+  for (;;) {
+    const auto ticks = Now() - state.start_ticks;
+    const std::chrono::duration<double> elapsed =
+        Clock::now() - state.start_time;
+    if (elapsed.count() >= .01) return ticks / elapsed.count();
+  }
+#else
+  return double(Clock::period::den) / Clock::period::num;
+#endif
+}
+
+void Profiler::SetThreadName(const std::string& name) {
+  auto& ring = GetRing();
+  std::lock_guard<std::mutex> lock(GetState().mutex);
+  ring.name = name;
+}
+
+std::vector<std::string> Profiler::GetThreadNames() {
+  auto& state = GetState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  std::vector<std::string> names;
+  for (const auto& ring : state.rings) names.push_back(ring->name);
+  return names;
+}
+
+std::uint32_t Profiler::Enter() { return GetRing().depth++; }
+
+void Profiler::Leave(const char* name, std::uint64_t begin,
+                     std::uint32_t depth) {
+  const auto end = Now();
+  auto& ring = *current_ring;
+  ring.depth = depth;
+  const auto head = ring.head.load(std::memory_order_relaxed);
+  auto& slot = ring.slots[head % kCapacity];
+  slot.name.store(name, std::memory_order_relaxed);
+  slot.begin.store(begin, std::memory_order_relaxed);
+  slot.end.store(end, std::memory_order_relaxed);
+  slot.depth.store(depth, std::memory_order_relaxed);
+  ring.head.store(head + 1, std::memory_order_release);
+}
+
+std::vector<Profiler::Zone> Profiler::Collect(std::uint64_t since) {
+  std::vector<Ring*> rings;
+  {
+    auto& state = GetState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    for (const auto& ring : state.rings) rings.push_back(ring.get());
+  }
+
+  std::vector<Zone> zones;
+  for (const auto ring : rings) {
+    const auto head = ring->head.load(std::memory_order_acquire);
+    const auto first = head > kCapacity ? head - kCapacity : 0;
+
+    // Zones close in order, so walk back until one closed before since
+    std::vector<Zone> copied;
+    for (auto i = head; i-- > first;) {
+      const auto& slot = ring->slots[i % kCapacity];
+      Zone zone{slot.name.load(std::memory_order_relaxed),
+                slot.begin.load(std::memory_order_relaxed),
+                slot.end.load(std::memory_order_relaxed),
+                slot.depth.load(std::memory_order_relaxed), ring->index};
+      if (zone.end < since) break;
+      copied.push_back(zone);
+    }
+
+    // Drop the oldest slots if the thread reused them while they were copied
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const auto now = ring->head.load(std::memory_order_relaxed);
+    const auto valid = now > kCapacity ? now - kCapacity : 0;
+    const auto keep =
+        head > valid ? std::min<std::uint64_t>(head - valid, copied.size()) : 0;
+    zones.insert(zones.end(), std::make_reverse_iterator(copied.begin() + keep),
+                 copied.rend());
+  }
+  return zones;
+}
+
+bool Profiler::WriteChromeTrace(const std::string& path) {
+  std::ofstream file(path);
+  if (!file) {
+    std::cerr << "Cannot write " << path << std::endl;
+    return false;
+  }
+
+  const auto zones = Collect();
+  const auto names = GetThreadNames();
+  const auto start = GetState().start_ticks;
+  const auto us = 1E6 / TicksPerSecond();
+
+  file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+  for (size_t t = 0; t < names.size(); ++t) {
+    file << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, "
+            "\"tid\": "
+         << t << ", \"args\": {\"name\": \"";
+    WriteEscaped(file, names[t]);
+    file << "\"}}" << (t + 1 < names.size() || !zones.empty() ? "," : "")
+         << "\n";
+  }
+  for (size_t i = 0; i < zones.size(); ++i) {
+    const auto& z = zones[i];
+    file << "{\"name\": \"";
+    WriteEscaped(file, z.name);
+    file << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << z.thread
+         << ", \"ts\": " << (z.begin - start) * us
+         << ", \"dur\": " << (z.end - z.begin) * us << "}"
+         << (i + 1 < zones.size() ? "," : "") << "\n";
+  }
+  file << "]}\n";
+  return true;
+}
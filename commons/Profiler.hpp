@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Scoped-zone profiler, one ring of zones per thread
+ *
+ * A zone is recorded when it closes, by the thread that opened it, into a
+ * ring of the last kCapacity zones of that thread. Recording takes no lock,
+ * readers copy the rings and drop what was overwritten meanwhile. Zones
+ * nest, each knows its depth on its thread.
+ *
+ * Timestamps are TSC ticks on x86 and steady_clock ticks elsewhere, see
+ * TicksPerSecond(). Names must outlive the profiler, string literals do.
+ *
+ * Without PHYSIM_PROFILE defined PROFILE_ZONE() compiles to nothing. With
+ * it, PHYSIM_TRACE=file writes a Chrome trace of every ring at exit.
+ */
+class Profiler {
+public:
+  struct Zone {
+    const char* name;
+    std::uint64_t begin, end;  // Ticks
+    std::uint32_t depth;       // 0 for zones not inside another
+    std::uint32_t thread;      // Index into GetThreadNames()
+  };
+
+  static constexpr std::size_t kCapacity = 1 << 14;
+
+  static std::uint64_t Now();
+
+  static double TicksPerSecond();
+
+  /**
+   * Zones are dropped while disabled
+   */
+  static void SetEnabled(bool enabled) { enabled_ = enabled; }
+  static bool IsEnabled() { return enabled_; }
+
+  /**
+   * Names the calling thread in traces, "thread n" otherwise
+   */
+  static void SetThreadName(const std::string& name);
+  static std::vector<std::string> GetThreadNames();
+
+  /**
+   * Zones of every thread that closed at or after since, oldest first per
+   * thread
+   */
+  static std::vector<Zone> Collect(std::uint64_t since = 0);
+
+  /**
+   * Trace event JSON for chrome://tracing or Perfetto
+   */
+  static bool WriteChromeTrace(const std::string& path);
+
+  // Used by ScopedZone, returns the depth of the new zone
+  static std::uint32_t Enter();
+  static void Leave(const char* name, std::uint64_t begin, std::uint32_t depth);
+
+private:
+  static std::atomic<bool> enabled_;
+};
+
+class ScopedZone {
+public:
+  explicit ScopedZone(const char* name) : name_(name) {
+    if (Profiler::IsEnabled()) {
+      depth_ = Profiler::Enter();
+      begin_ = Profiler::Now();
+    }
+  }
+  ~ScopedZone() {
+    if (begin_) Profiler::Leave(name_, begin_, depth_);
+  }
+
+  ScopedZone(const ScopedZone&) = delete;
+  ScopedZone& operator=(const ScopedZone&) = delete;
+
+private:
+  const char* name_;
+  std::uint64_t begin_ = 0;
+  std::uint32_t depth_ = 0;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+#ifdef PHYSIM_PROFILE
+#define PROFILE_ZONE(name) \
+  const ScopedZone PROFILE_CONCAT(profile_zone_, __LINE__)(name)
+#else
+#define PROFILE_ZONE(name) static_cast<void>(0)
+#endif
@@ -0,0 +1,153 @@
+#include "ProfilerPanel.hpp"
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Profiler.hpp"
+
+namespace {
+// Same color for a name every frame
+ImU32 ZoneColor(const char* name) {
+  const auto hue = std::hash<std::string>()(name) % 360 / 360.f;
+  return ImColor::HSV(hue, .5f, .7f);
+}
+
+void DrawLanes(const std::vector<Profiler::Zone>& zones,
+               const Profiler::Zone& root, double ms_per_tick) {
+  const auto names = Profiler::GetThreadNames();
+  const auto row = ImGui::GetTextLineHeightWithSpacing();
+  const auto width = ImGui::GetContentRegionAvail().x;
+  const auto scale = width / float(root.end - root.begin);
+  const auto draw = ImGui::GetWindowDrawList();
+
+  // The root's thread first, then every thread busy during the root
+  std::vector<std::uint32_t> lanes{root.thread};
+  for (const auto& z : zones) {
+    if (z.end >= root.begin && z.begin <= root.end &&
+        std::find(lanes.begin(), lanes.end(), z.thread) == lanes.end()) {
+      lanes.push_back(z.thread);
+    }
+  }
+
+  for (const auto lane : lanes) {
+    std::vector<const Profiler::Zone*> shown;
+    auto top = ~0U, bottom = 0U;
+    for (const auto& z : zones) {
+      if (z.thread != lane || z.end < root.begin || z.begin > root.end) {
+        continue;
+      }
+      if (lane == root.thread && z.depth < root.depth) continue;
+      shown.push_back(&z);
+      top = std::min(top, z.depth);
+      bottom = std::max(bottom, z.depth);
+    }
+    if (shown.empty()) continue;
+
+    ImGui::TextUnformatted(names[lane].c_str());
+    const auto origin = ImGui::GetCursorScreenPos();
+    ImGui::Dummy(ImVec2(width, row * (bottom - top + 1)));
+    for (const auto z : shown) {
+      const auto begin = std::max(z->begin, root.begin) - root.begin;
+      const auto end = std::min(z->end, root.end) - root.begin;
+      const ImVec2 a(origin.x + begin * scale,
+                     origin.y + (z->depth - top) * row);
+      const ImVec2 b(std::max(origin.x + end * scale, a.x + 1.f),
+                     a.y + row - 1.f);
+      draw->AddRectFilled(a, b, ZoneColor(z->name));
+      draw->PushClipRect(a, b, true);
+      draw->AddText(ImVec2(a.x + 2.f, a.y), IM_COL32_WHITE, z->name);
+      draw->PopClipRect();
+      if (ImGui::IsMouseHoveringRect(a, b)) {
+        ImGui::SetTooltip("%s\n%.3f ms", z->name,
+                          (z->end - z->begin) * ms_per_tick);
+      }
+    }
+  }
+}
+
+// Average time of the root's children over every root in zones
+void DrawShares(const std::vector<Profiler::Zone>& zones,
+                const Profiler::Zone& latest, double ms_per_tick) {
+  std::vector<const Profiler::Zone*> roots;
+  for (const auto& z : zones) {
+    if (z.thread == latest.thread && z.depth == latest.depth &&
+        !std::strcmp(z.name, latest.name)) {
+      roots.push_back(&z);
+    }
+  }
+
+  double total = 0;
+  for (const auto r : roots) total += r->end - r->begin;
+  std::vector<std::pair<const char*, double>> children;
+  for (const auto& z : zones) {
+    if (z.thread != latest.thread || z.depth != latest.depth + 1) continue;
+    // Roots close in order, so the first closing after z is its parent
+    const auto parent = std::lower_bound(
+        roots.begin(), roots.end(), z.end,
+        [](const Profiler::Zone* r, std::uint64_t end) {
+          return r->end < end;
+        });
+    if (parent == roots.end() || (*parent)->begin > z.begin) continue;
+    auto child = std::find_if(children.begin(), children.end(), [&](auto& c) {
+      return !std::strcmp(c.first, z.name);
+    });
+    if (child == children.end()) {
+      children.emplace_back(z.name, 0.);
+      child = children.end() - 1;
+    }
+    child->second += z.end - z.begin;
+  }
+
+  ImGui::Text("%s: %.3f ms over %zu steps", latest.name,
+              total * ms_per_tick / roots.size(), roots.size());
+  for (const auto& c : children) {
+    ImGui::Text("  %-32s %8.3f ms %5.1f%%", c.first,
+                c.second * ms_per_tick / roots.size(), 100 * c.second / total);
+  }
+}
+}  // namespace
+
+void DrawProfilerPanel(const char* root) {
+  if (!ImGui::CollapsingHeader("Profiler")) return;
+#ifndef PHYSIM_PROFILE
+  ImGui::Text("Built without PHYSIM_PROFILE");
+#else
+  auto recording = Profiler::IsEnabled();
+  if (ImGui::Checkbox("Record", &recording)) Profiler::SetEnabled(recording);
+  ImGui::SameLine();
+  static std::string saved;
+  if (ImGui::Button("Save trace")) {
+    saved = Profiler::WriteChromeTrace("trace.json") ? "Wrote trace.json"
+                                                      : "Cannot write";
+  }
+  ImGui::SameLine();
+  ImGui::TextUnformatted(saved.c_str());
+
+  const auto ticks_per_second = Profiler::TicksPerSecond();
+  const auto ms_per_tick = 1E3 / ticks_per_second;
+  static std::vector<Profiler::Zone> zones;
+  if (recording) {
+    zones = Profiler::Collect(Profiler::Now() -
+                              std::uint64_t(ticks_per_second));
+  }
+
+  const Profiler::Zone* latest = nullptr;
+  for (const auto& z : zones) {
+    if (!std::strcmp(z.name, root) && (!latest || z.end > latest->end)) {
+      latest = &z;
+    }
+  }
+  if (!latest) {
+    ImGui::Text("No %s in the last second", root);
+    return;
+  }
+  DrawShares(zones, *latest, ms_per_tick);
+  DrawLanes(zones, *latest, ms_per_tick);
+#endif
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+/**
+ * Profiler section of an ImGui window, between its Begin() and End()
+ *
+ * root names the zone of one step, like "Grid::Update". The latest one is
+ * drawn as a flame graph with a lane per thread, and the time of its
+ * children is averaged over every root of the last second.
+ */
+void DrawProfilerPanel(const char* root);
@@ -0,0 +1,147 @@
+#include "SimulationDriver.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+#include "Profiler.hpp"
+
+namespace {
+// A step of 0 would never use up the accumulator, NaN would never fill it
+bool IsValidTimeStep(float time_step) {
+  return std::isfinite(time_step) && time_step > 0.f;
+}
+}  // namespace
+
+SimulationDriver::SimulationDriver(StepFunction step, Function publish,
+                                   float time_step)
+    : step_(std::move(step)),
+      publish_(std::move(publish)),
+      time_step_(IsValidTimeStep(time_step) ? time_step : 1.f / 60.f) {
+  if (!IsValidTimeStep(time_step)) {
+    std::cerr << "Not a time step: " << time_step << ", using 1/60 s"
+              << std::endl;
+  }
+  thread_ = std::thread(&SimulationDriver::Loop, this);
+}
+
+SimulationDriver::~SimulationDriver() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  wake_.notify_one();
+  thread_.join();
+}
+
+void SimulationDriver::SetRunning(bool running) {
+  {
+    // Under the lock, or the thread could miss it between its check and
+    // its wait
+    std::lock_guard<std::mutex> lock(mutex_);
+    running_ = running;
+  }
+  wake_.notify_one();
+}
+
+void SimulationDriver::SetTimeStep(float time_step) {
+  if (IsValidTimeStep(time_step)) time_step_ = time_step;
+}
+
+void SimulationDriver::SetTimeScale(float scale) {
+  if (!std::isfinite(scale)) return;
+  scale = std::max(scale, 0.f);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    time_scale_ = scale;
+  }
+  wake_.notify_one();
+}
+
+void SimulationDriver::SetMaxSubsteps(int substeps) {
+  max_substeps_ = std::max(substeps, 1);
+}
+
+void SimulationDriver::Post(Function f) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    posted_.push_back(std::move(f));
+  }
+  wake_.notify_one();
+}
+
+void SimulationDriver::Step() {
+  Post([this] { step_(time_step_); });
+}
+
+void SimulationDriver::Loop() {
+  using Clock = std::chrono::steady_clock;
+  using Seconds = std::chrono::duration<double>;
+  Profiler::SetThreadName("simulation");
+
+  auto last = Clock::now();
+  auto accumulator = 0.;
+
+  // Dilation over windows of about half a second
+  auto window_start = last;
+  auto window_simulated = 0.;
+
+  std::vector<Function> posted;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (stop_) return;
+      posted.swap(posted_);
+    }
+    for (const auto& f : posted) f();
+
+    const auto now = Clock::now();
+    const double elapsed = Seconds(now - last).count();
+    last = now;
+    const auto time_step = time_step_.load();
+    const auto max_substeps = max_substeps_.load();
+
+    auto substeps = 0;
+    if (running_) {
+      accumulator += elapsed * time_scale_;
+      for (; accumulator >= time_step && substeps < max_substeps;
+           ++substeps) {
+        step_(time_step);
+        accumulator -= time_step;
+      }
+      // Behind real time, give up on it rather than catching up
+      if (substeps == max_substeps) {
+        accumulator = std::min(accumulator, double(time_step));
+      }
+    } else {
+      accumulator = 0.;
+    }
+    if (substeps || !posted.empty()) publish_();
+    posted.clear();
+
+    window_simulated += substeps * time_step;
+    const double window = Seconds(now - window_start).count();
+    if (window >= .5) {
+      dilation_ = float(window_simulated / window);
+      window_start = now;
+      window_simulated = 0.;
+    }
+
+    // Sleep until the next step is due, or for good when paused
+    std::unique_lock<std::mutex> lock(mutex_);
+    const auto woken = [this] { return stop_ || !posted_.empty(); };
+    if (!running_) {
+      dilation_ = 0.f;
+      wake_.wait(lock, [&] { return woken() || running_; });
+      last = Clock::now();  // Paused time is not owed either
+    } else if (accumulator < time_step && time_scale_ > 0.f) {
+      const auto due = Seconds((time_step - accumulator) / time_scale_);
+      wake_.wait_for(lock, std::chrono::duration_cast<Clock::duration>(due),
+                     woken);
+    } else if (time_scale_ <= 0.f) {
+      wake_.wait(lock, [&] { return woken() || time_scale_ > 0.f; });
+      last = Clock::now();
+    }
+  }
+}
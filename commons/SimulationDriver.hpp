@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Steps a simulation on a thread of its own, in fixed steps of wall time
+ *
+ * Wall time, scaled by the time scale, fills an accumulator that is spent
+ * in steps of the time step. At most max substeps are taken before the
+ * state is published, and time the simulation could not keep up with is
+ * dropped rather than owed, so a slow step slows the simulation down
+ * instead of making the next round longer. GetDilation() tells how much
+ * of real time the simulation actually covers.
+ *
+ * Only the simulation thread touches the simulation: the step and publish
+ * functions run there, and so does everything handed to Post(). publish
+ * copies what the renderer needs out, typically into a TripleBuffer.
+ */
+class SimulationDriver {
+public:
+  using StepFunction = std::function<void(float dt)>;
+  using Function = std::function<void()>;
+
+  SimulationDriver(StepFunction step, Function publish, float time_step);
+  ~SimulationDriver();
+
+  SimulationDriver(const SimulationDriver&) = delete;
+  SimulationDriver& operator=(const SimulationDriver&) = delete;
+
+  /**
+   * Paused drivers only run posted functions and Step()
+   */
+  void SetRunning(bool running);
+  bool IsRunning() const { return running_; }
+
+  /**
+   * Ignored unless positive and finite, the last good step is kept
+   */
+  void SetTimeStep(float time_step);
+  float GetTimeStep() const { return time_step_; }
+
+  /**
+   * Simulated seconds per wall second asked for, below 1 for slow motion
+   * 0 holds the simulation, below 0 counts as 0 and non-finite is ignored.
+   */
+  void SetTimeScale(float scale);
+  float GetTimeScale() const { return time_scale_; }
+
+  /**
+   * Steps between two publishes at most
+   */
+  void SetMaxSubsteps(int substeps);
+  int GetMaxSubsteps() const { return max_substeps_; }
+
+  /**
+   * Runs f on the simulation thread before its next step, then publishes
+   */
+  void Post(Function f);
+
+  /**
+   * One step, also when paused
+   */
+  void Step();
+
+  /**
+   * Simulated seconds per wall second over the last half second or so,
+   * below the time scale when steps cannot keep up
+   */
+  float GetDilation() const { return dilation_; }
+
+private:
+  void Loop();
+
+  StepFunction step_;
+  Function publish_;
+
+  std::atomic<bool> running_{false};
+  std::atomic<float> time_step_, time_scale_{1.f};
+  std::atomic<int> max_substeps_{8};
+  std::atomic<float> dilation_{0.f};
+
+  // Posted functions, and wakes the thread for them and for settings
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::vector<Function> posted_;
+  bool stop_ = false;
+
+  std::thread thread_;
+};
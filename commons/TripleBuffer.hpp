@@ -0,0 +1,46 @@
+#pragma once
+
+#include <atomic>
+
+/**
+ * Hands the latest value from one writer thread to one reader thread
+ *
+ * Neither side ever waits: the writer fills the back slot and publishes
+ * it, the reader takes whatever was published last and keeps it until it
+ * asks again. Values in between are skipped. Slots are reused, so the
+ * writer must overwrite all of Back() before publishing.
+ */
+template <typename T>
+class TripleBuffer {
+public:
+  /**
+   * Writer side, only seen by the reader after Publish()
+   */
+  T& Back() { return slots_[back_]; }
+
+  void Publish() {
+    back_ = middle_.exchange(back_ | kFresh, std::memory_order_acq_rel) &
+            kIndex;
+  }
+
+  /**
+   * Reader side, moves to the latest published value if there is a new one
+   * Returns whether Front() changed.
+   */
+  bool Update() {
+    if (!(middle_.load(std::memory_order_relaxed) & kFresh)) return false;
+    front_ = middle_.exchange(front_, std::memory_order_acq_rel) & kIndex;
+    return true;
+  }
+
+  const T& Front() const { return slots_[front_]; }
+
+private:
+  // The middle slot's index, plus whether the writer published it since
+  // the reader last took it
+  static constexpr unsigned kIndex = 3, kFresh = 4;
+
+  T slots_[3];
+  unsigned back_ = 0, front_ = 1;
+  std::atomic<unsigned> middle_{2};
+};
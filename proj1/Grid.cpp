@@ -1,13 +1,53 @@
 #include "Grid.hpp"
 
+#include <atomic>
 #include <glm/gtx/compatibility.hpp>
 #include <glm/gtx/component_wise.hpp>
 #include <glm/gtx/euler_angles.hpp>
 #include <glm/gtx/matrix_operation.hpp>
 #include <glm/gtx/transform.hpp>
+#include <iostream>
+
+#include "Checkpoint.hpp"
+#include "Profiler.hpp"
 
 using namespace glm;
 
+namespace {
+// Everything of a grid in a checkpoint that is not an array
+struct GridParameters {
+  uvec3 size, stride;
+  float mu, lambda, eta, density;
+  float friction;  // GridParticle::mu
+  std::uint32_t error;
+};
+
+// Whether every index of the arrays of a checkpoint is in range, as
+// Update() relies on without checking
+bool IsConsistent(size_t particles, size_t tetrahedra,
+                  const std::vector<Grid::Indices>& vertices,
+                  const std::vector<uint>& corner_start,
+                  const std::vector<uint>& corners) {
+  if (vertices.size() != tetrahedra ||
+      corner_start.size() != particles + 1 || corner_start.front() != 0 ||
+      corner_start.back() != corners.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < particles; ++i) {
+    if (corner_start[i] > corner_start[i + 1]) return false;
+  }
+  for (const auto corner : corners) {
+    if (corner >= 4 * vertices.size()) return false;
+  }
+  for (const auto& v : vertices) {
+    for (const auto i : v) {
+      if (i >= particles) return false;
+    }
+  }
+  return true;
+}
+}  // namespace
+
 Grid::Grid(const glm::vec3& translation, const glm::vec3& yaw_pitch_roll,
            const glm::vec3& cell, const glm::uvec3& size, float E, float nu,
            float eta, float density)
@@ -18,6 +58,7 @@ Grid::Grid(const glm::vec3& translation, const glm::vec3& yaw_pitch_roll,
 
   SetupGrid(translation, radians(yaw_pitch_roll), cell);
   LinkTetrahedra();
+  LinkCorners();
 }
 
 void Grid::SetupGrid(const glm::vec3& translation,
@@ -30,7 +71,7 @@ void Grid::SetupGrid(const glm::vec3& translation,
     for (unsigned j = 0; j < size_.y; ++j) {
       for (unsigned k = 0; k < size_.z; ++k) {
         const auto index = uvec3(i, j, k);
-        Particle p;
+        GridParticle p;
         p.pos = transform * vec4(vec3(index), 1.f);
         p.vel = vec3(0.f);
         // Computed later
@@ -66,7 +107,7 @@ void Grid::LinkTetrahedra() {
 
   // Add gravity
   for (auto& p : particles_) {
-    p.force = p.mass * Particle::g;
+    p.force = p.mass * GridParticle::g;
   }
 }
 
@@ -112,40 +153,141 @@ glm::mat3 Grid::GetTetrahedralVelocity(const Grid::Indices& verts) const {
               particles_[verts[2]].vel - particles_[verts[3]].vel);
 }
 
-void Grid::Update(float dt) {
-  // Add gravity
-  for (auto& p : particles_) {
-    p.force = p.mass * Particle::g;
+void Grid::LinkCorners() {
+  corner_start_.assign(particles_.size() + 1, 0);
+  for (const auto& verts : vertices_) {
+    for (auto v : verts) ++corner_start_[v + 1];
+  }
+  for (size_t i = 0; i < particles_.size(); ++i) {
+    corner_start_[i + 1] += corner_start_[i];
   }
+  corners_.resize(4 * vertices_.size());
+  auto fill = corner_start_;
+  for (size_t t = 0; t < vertices_.size(); ++t) {
+    for (int i = 0; i < 4; ++i) corners_[fill[vertices_[t][i]]++] = 4 * t + i;
+  }
+  corner_forces_.resize(4 * vertices_.size());
+}
 
+glm::mat3 Grid::GetTetrahedralStress(size_t t) const {
+  const auto I = mat3(1.f);
+  const auto& tt = tetrahedra_[t];
+  const auto F = GetTetrahedralFrame(vertices_[t]) * tt.R_inv;
+  const auto F_v = GetTetrahedralVelocity(vertices_[t]) * tt.R_inv;
+  const auto epsilon = (transpose(F) * F - I) / 2.f;
+  const auto epsilon_rate = (transpose(F) * F_v + transpose(F_v) * F) / 2.f;
+  const auto sigma =
+      2 * mu_ * epsilon +
+      lambda_ * (epsilon[0][0] + epsilon[1][1] + epsilon[2][2]) * I +
+      epsilon_rate * eta_;
+  return sigma * adjugate(F);  // glm::adjugate is indeed cofactor
+}
+
+void Grid::Update(float dt) {
+  PROFILE_ZONE("Grid::Update");
+  ApplyGravity();
   DeformTetrahedra();
+  Integrate(dt);
+}
 
-  for (auto& p : particles_) {
-    if (all(isfinite(p.force))) {
-      p.Update(dt);
-    } else {
-      error_ = true;
+void Grid::ApplyGravity() {
+  PROFILE_ZONE("Grid::ApplyGravity");
+  jobs_.ParallelFor(particles_.size(), 1024, [&](size_t begin, size_t end) {
+    for (auto i = begin; i < end; ++i) {
+      particles_[i].force = particles_[i].mass * GridParticle::g;
     }
-  }
+  });
 }
 
 void Grid::DeformTetrahedra() {
-  using namespace glm;
-  const auto I = mat3(1.f);
-  for (size_t t = 0; t < tetrahedra_.size(); ++t) {
-    const auto& tt = tetrahedra_[t];
-    const auto F = GetTetrahedralFrame(vertices_[t]) * tt.R_inv;
-    const auto F_v = GetTetrahedralVelocity(vertices_[t]) * tt.R_inv;
-    const auto epsilon = (transpose(F) * F - I) / 2.f;
-    const auto epsilon_rate = (transpose(F) * F_v + transpose(F_v) * F) / 2.f;
-    const auto sigma =
-        2 * mu_ * epsilon +
-        lambda_ * (epsilon[0][0] + epsilon[1][1] + epsilon[2][2]) * I +
-        epsilon_rate * eta_;
-    const auto trans_sigma =
-        sigma * adjugate(F);  // glm::adjugate is indeed cofactor
-    for (int i = 0; i < 4; ++i) {
-      particles_[vertices_[t][i]].force += trans_sigma * tt.rest_n[i];
+  PROFILE_ZONE("Grid::DeformTetrahedra");
+  if (jobs_.GetThreads() == 1) {
+    for (size_t t = 0; t < tetrahedra_.size(); ++t) {
+      const auto stress = GetTetrahedralStress(t);
+      for (int i = 0; i < 4; ++i) {
+        particles_[vertices_[t][i]].force += stress * tetrahedra_[t].rest_n[i];
+      }
+    }
+    return;
+  }
+
+  // Tetrahedra share particles, so each writes its own corners and every
+  // particle then adds up its corners in tetrahedron order, as above
+  jobs_.ParallelFor(tetrahedra_.size(), 256, [&](size_t begin, size_t end) {
+    for (auto t = begin; t < end; ++t) {
+      const auto stress = GetTetrahedralStress(t);
+      for (int i = 0; i < 4; ++i) {
+        corner_forces_[4 * t + i] = stress * tetrahedra_[t].rest_n[i];
+      }
+    }
+  });
+  jobs_.ParallelFor(particles_.size(), 1024, [&](size_t begin, size_t end) {
+    for (auto i = begin; i < end; ++i) {
+      for (auto k = corner_start_[i]; k < corner_start_[i + 1]; ++k) {
+        particles_[i].force += corner_forces_[corners_[k]];
+      }
     }
+  });
+}
+
+void Grid::Integrate(float dt) {
+  PROFILE_ZONE("Grid::Integrate");
+  std::atomic<bool> error{false};
+  jobs_.ParallelFor(particles_.size(), 1024, [&](size_t begin, size_t end) {
+    for (auto i = begin; i < end; ++i) {
+      auto& p = particles_[i];
+      if (all(isfinite(p.force))) {
+        p.Update(dt);
+      } else {
+        error = true;
+      }
+    }
+  });
+  if (error) error_ = true;
+}
+
+void Grid::Save(Checkpoint& checkpoint) const {
+  checkpoint.AddValue("params",
+                      GridParameters{size_, stride_, mu_, lambda_, eta_,
+                                     density_, GridParticle::mu, error_});
+  checkpoint.Add("particle", particles_);
+  checkpoint.Add("tetra", tetrahedra_);
+  checkpoint.Add("vertices", vertices_);
+  checkpoint.Add("cstart", corner_start_);
+  checkpoint.Add("corners", corners_);
+}
+
+bool Grid::Load(const CheckpointFile& file) {
+  GridParameters params;
+  std::vector<GridParticle> particles;
+  std::vector<Tetrahedron> tetrahedra;
+  std::vector<Indices> vertices;
+  std::vector<glm::uint> corner_start, corners;
+  if (!file.ReadValue("params", params) ||
+      !file.Read("particle", particles) || !file.Read("tetra", tetrahedra) ||
+      !file.Read("vertices", vertices) ||
+      !file.Read("cstart", corner_start) || !file.Read("corners", corners)) {
+    return false;
   }
+  if (!IsConsistent(particles.size(), tetrahedra.size(), vertices,
+                    corner_start, corners)) {
+    std::cerr << "Inconsistent grid in checkpoint" << std::endl;
+    return false;
+  }
+
+  size_ = params.size;
+  stride_ = params.stride;
+  mu_ = params.mu;
+  lambda_ = params.lambda;
+  eta_ = params.eta;
+  density_ = params.density;
+  GridParticle::mu = params.friction;
+  error_ = params.error;
+  particles_ = std::move(particles);
+  tetrahedra_ = std::move(tetrahedra);
+  vertices_ = std::move(vertices);
+  corner_start_ = std::move(corner_start);
+  corners_ = std::move(corners);
+  corner_forces_.assign(4 * vertices_.size(), vec3(0.f));
+  return true;
 }
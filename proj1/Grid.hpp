@@ -4,8 +4,12 @@
 #include <memory>
 #include <vector>
 
+#include "JobSystem.hpp"
 #include "Particle.hpp"
 
+class Checkpoint;
+class CheckpointFile;
+
 class Grid {
 public:
   Grid() = default;
@@ -16,7 +20,14 @@ public:
 
   void Update(float dt);
 
-  const std::vector<Particle>& Particles() const { return particles_; }
+  /**
+   * Threads stepping the grid, 0 for the whole pool
+   * Results do not depend on it.
+   */
+  void SetThreads(size_t threads) { jobs_.SetThreads(threads); }
+  size_t GetThreads() const { return jobs_.GetThreads(); }
+
+  const std::vector<GridParticle>& Particles() const { return particles_; }
 
   using Indices = std::array<glm::uint, 4>;  // Tetrahedron 4 indices
 
@@ -31,6 +42,25 @@ public:
 
   bool GetError() const { return error_; }
 
+  /**
+   * Particles, mesh and parameters, including the friction shared by all
+   * grids. Load() takes them back without rebuilding the mesh and keeps
+   * the threads; on failure the grid is left as it was.
+   */
+  void Save(Checkpoint& checkpoint) const;
+  bool Load(const CheckpointFile& file);
+
+  // Passes of Update() in order, public for benchmarks
+  void ApplyGravity();
+
+  /**
+   * Compute strain-stress relationship
+   * Adds each tetrahedron's elastic and damping forces to its particles.
+   */
+  void DeformTetrahedra();
+
+  void Integrate(float dt);
+
 private:
   struct Tetrahedron {
     std::array<glm::vec3, 4> rest_n;
@@ -60,16 +90,27 @@ private:
   glm::mat3 GetTetrahedralVelocity(const Indices& verts) const;
 
   /**
-   * Compute strain-stress relationship
+   * Stress times area, its product with a rest normal is a corner's force
    */
-  void DeformTetrahedra();
+  glm::mat3 GetTetrahedralStress(size_t t) const;
+
+  /**
+   * Corners touching each particle, for gathering forces on many threads
+   */
+  void LinkCorners();
 
   // Grid parameters
   glm::uvec3 size_, stride_;
-  std::vector<Particle> particles_;
+  std::vector<GridParticle> particles_;
   std::vector<Tetrahedron> tetrahedra_;
   std::vector<Indices> vertices_;
 
+  // Corner 4 * t + i is vertex i of tetrahedron t
+  std::vector<glm::vec3> corner_forces_;
+  std::vector<glm::uint> corner_start_, corners_;  // CSR, tetrahedron order
+
+  JobArena jobs_;
+
   // Material parameters
   float mu_, lambda_, eta_;
   float density_;
@@ -17,7 +17,7 @@ namespace {
 std::unique_ptr<Program> vec_program, tetra_program, surf_program;
 }  // namespace
 
-GridRenderer::GridRenderer(const std::vector<Particle>& particles,
+GridRenderer::GridRenderer(const std::vector<GridParticle>& particles,
                            const std::vector<std::array<uint, 4>>& tetra)
     : size_(particles.size()), tetra_size_(tetra.size()) {
   vbo = std::make_unique<Buffer>();
@@ -26,7 +26,7 @@ GridRenderer::GridRenderer(const std::vector<Particle>& particles,
   ebo->CreateStorage(tetra, GL_CLIENT_STORAGE_BIT);
 
   vao = std::make_unique<VertexArray>();
-  vao->BindVertexBuffer(0, *vbo, sizeof(Particle), 0);
+  vao->BindVertexBuffer(0, *vbo, sizeof(GridParticle), 0);
   vao->BindElementBuffer(*ebo);
   vao->EnableAttrib(0, 1, 2, 3);
   vao->AttribBinding(0, 0, 1, 2, 3);
@@ -58,7 +58,7 @@ GridRenderer::GridRenderer(const std::vector<Particle>& particles,
   }
 }
 
-void GridRenderer::Update(const std::vector<Particle>& particles) {
+void GridRenderer::Update(const std::vector<GridParticle>& particles) {
   assert(particles.size() == size_);
   vbo->SetSubData(particles);
 }
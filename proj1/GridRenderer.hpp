@@ -6,16 +6,16 @@
 #include <vector>
 
 class Camera;
-struct Particle;
+struct GridParticle;
 
 class GridRenderer {
 public:
   GridRenderer() = default;
 
-  explicit GridRenderer(const std::vector<Particle>& particles,
+  explicit GridRenderer(const std::vector<GridParticle>& particles,
                         const std::vector<std::array<glm::uint, 4>>& tetra);
 
-  void Update(const std::vector<Particle>& particles);
+  void Update(const std::vector<GridParticle>& particles);
 
   void DrawTetrahedra(const Camera& camera);
 
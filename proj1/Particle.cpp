@@ -1,6 +1,6 @@
 #include "Particle.hpp"
 
-void Particle::Update(float dt) {
+void GridParticle::Update(float dt) {
   using namespace glm;
   if (pos.y <= 0) {
     // Collision with y=0
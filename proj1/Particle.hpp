@@ -1,7 +1,7 @@
 #pragma once
 #include <glm/glm.hpp>
 
-struct Particle {
+struct GridParticle {
   void Update(float dt);
 
   glm::vec3 pos, vel, force;
@@ -0,0 +1,85 @@
+#include <algorithm>
+#include <cstdlib>
+#include <glm/glm.hpp>
+#include <iostream>
+
+#include "Arguments.hpp"
+#include "Grid.hpp"
+#include "HeadlessRunner.hpp"
+
+namespace {
+const auto time_step = 1E-3f;
+}  // namespace
+
+// Steps a grid as fast as possible, without a window
+// proj1_headless [steps] [size x y z]
+// PHYSIM_PERF=1 adds hardware counters of every pass, PHYSIM_METRICS=port
+// serves live metrics, PHYSIM_CHECKPOINT=file writes checkpoints and
+// PHYSIM_RESTORE=file resumes from one.
+int main(int argc, char *argv[]) {
+  unsigned long steps = 10000, size[3] = {4, 4, 4};
+  auto ok = ParseArgument(argc, argv, 1, steps);
+  if (argc > 4) {
+    for (int k = 0; k < 3; ++k) {
+      ok = ok && ParseArgument(argc, argv, 2 + k, size[k]);
+    }
+  }
+  if (!ok) {
+    std::cerr << "Usage: proj1_headless [steps] [size x y z]" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  HeadlessRunner runner("fem");
+  Grid grid;
+  if (const auto restore = HeadlessRunner::RestorePath()) {
+    if (!runner.Restore(restore, [&](const CheckpointFile &file) {
+          return grid.Load(file);
+        })) {
+      return EXIT_FAILURE;
+    }
+  } else {
+    // Same defaults as the GUI
+    grid = Grid(glm::vec3(.5f, 2.f, .5f), glm::vec3(0.f), glm::vec3(.5f),
+                glm::uvec3(size[0], size[1], size[2]), 100.f, .4f, 1.f);
+  }
+  const auto tetrahedra = grid.ParticleIndices().size();
+  std::cout << "Particles: " << grid.Particles().size()
+            << ", tetrahedra: " << tetrahedra << std::endl;
+
+  const double particles = grid.Particles().size();
+  auto &metrics = runner.GetMetrics();
+  metrics.GetGauge("physim_particles", "Particles or bodies").Set(particles);
+  metrics.GetGauge("physim_tetrahedra", "Tetrahedra").Set(tetrahedra);
+  auto &max_velocity =
+      metrics.GetGauge("physim_max_velocity", "Fastest particle or body");
+
+  // Passes of Grid::Update()
+  const auto taken = runner.Run(
+      steps, time_step,
+      [&] {
+        runner.Pass("gravity", "particle", particles,
+                    [&] { grid.ApplyGravity(); });
+        runner.Pass("deform", "tetrahedron", tetrahedra,
+                    [&] { grid.DeformTetrahedra(); });
+        runner.Pass("integrate", "particle", particles,
+                    [&] { grid.Integrate(time_step); });
+
+        auto fastest = 0.f;
+        for (const auto &p : grid.Particles()) {
+          fastest = std::max(fastest, glm::length(p.vel));
+        }
+        max_velocity.Set(fastest);
+        return grid.GetError();
+      },
+      [&](Checkpoint &checkpoint) { grid.Save(checkpoint); });
+  const auto seconds = runner.GetSeconds();
+
+  std::cout << "Steps/s: " << taken / seconds << std::endl
+            << "Tetrahedron steps/s: " << tetrahedra * taken / seconds
+            << std::endl;
+  runner.PrintCounters(std::cout);
+  if (grid.GetError()) {
+    std::cerr << "Blown up after " << taken << " steps" << std::endl;
+    return EXIT_FAILURE;
+  }
+}
@@ -7,11 +7,18 @@
 
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <memory>
+#include <vector>
 
 #include "Axes.hpp"
 #include "Camera.hpp"
+#include "DriverPanel.hpp"
 #include "Grid.hpp"
 #include "GridRenderer.hpp"
+#include "Profiler.hpp"
+#include "ProfilerPanel.hpp"
+#include "SimulationDriver.hpp"
+#include "TripleBuffer.hpp"
 
 namespace {
 Camera camera({-2, 1, -2}, {0, 0, 0}, 640, 480);
@@ -20,15 +27,44 @@ auto translation = glm::vec3(.5f, 2.f, .5f);
 auto yaw_pitch_roll = glm::vec3(0.f, 0.f, 0.f);
 auto cell = glm::vec3(.5f, .5f, .5f);
 auto size = glm::uvec3(4, 4, 4);
-auto E = 100.f, nu = .4f, eta = 1.f, density = 1.f;
+auto E = 100.f, nu = .4f, eta = 1.f, density = 1.f, mu = GridParticle::mu;
 auto time_step = 1E-3f;
 
+// What the renderer needs of a step
+struct Snapshot {
+  std::vector<GridParticle> particles;
+  size_t generation = 0;  // Of the grid, see Restart()
+  bool error = false;
+};
+
+// Touched by the simulation thread only, through the driver
 Grid grid;
+size_t grid_generation = 0;
+
+TripleBuffer<Snapshot> snapshots;
+std::unique_ptr<SimulationDriver> driver;
+
 GridRenderer renderer;
+size_t generation = 0;
+
+void Publish() {
+  auto &snapshot = snapshots.Back();
+  snapshot.particles = grid.Particles();
+  snapshot.generation = grid_generation;
+  snapshot.error = grid.GetError();
+  snapshots.Publish();
+}
 
+// The renderer is made for the new grid right away, and snapshots of the
+// old one are ignored until the simulation thread switched
 void Restart() {
-  grid = Grid(translation, yaw_pitch_roll, cell, size, E, nu, eta, density);
-  renderer = GridRenderer(grid.Particles(), grid.ParticleIndices());
+  const auto next = std::make_shared<Grid>(translation, yaw_pitch_roll, cell,
+                                           size, E, nu, eta, density);
+  renderer = GridRenderer(next->Particles(), next->ParticleIndices());
+  driver->Post([next, g = ++generation] {
+    grid = std::move(*next);
+    grid_generation = g;
+  });
 }
 
 auto wireframe = false;
@@ -83,6 +119,7 @@ void KeyCallback(GLFWwindow *window, int key, int scancode, int action,
   }
   if (key == GLFW_KEY_SPACE && action == GLFW_PRESS) {
     simulating = !simulating;
+    driver->SetRunning(simulating);
   }
   if (key == GLFW_KEY_C && action == GLFW_PRESS) {
     wireframe = !wireframe;
@@ -91,7 +128,7 @@ void KeyCallback(GLFWwindow *window, int key, int scancode, int action,
     Restart();
   }
   if (key == GLFW_KEY_ENTER && action == GLFW_REPEAT) {
-    grid.Update(time_step);
+    driver->Step();
   }
 }
 
@@ -150,7 +187,7 @@ void RenderUI() {
 
   ImGui::Begin("Control", nullptr);
   ImGui::Text("FPS: %.1f", ImGui::GetIO().Framerate);
-  if (grid.GetError()) {
+  if (snapshots.Front().error) {
     ImGui::Text("Grid blown up");
   }
   ImGui::Separator();
@@ -158,9 +195,11 @@ void RenderUI() {
   ImGui::Text("Hold left mouse button to rotate camera");
   ImGui::Checkbox("ImGui Demo", &show_demo_window);
   ImGui::Checkbox("Draw wireframe (C)", &wireframe);
-  ImGui::Checkbox("Simulate (Space)", &simulating);
+  if (ImGui::Checkbox("Simulate (Space)", &simulating)) {
+    driver->SetRunning(simulating);
+  }
   if (ImGui::Button("Step (Enter)")) {
-    grid.Update(time_step);
+    driver->Step();
   }
   ImGui::SameLine();
   if (ImGui::Button("Restart (R)")) {
@@ -178,15 +217,23 @@ void RenderUI() {
     Restart();
   }
   ImGui::Separator();
-  ImGui::SliderFloat("Time step", &time_step, .0001f, .01f, "%.4f");
-  ImGui::SliderFloat("Friction", &Particle::mu, 0.f, 1.f);
+  if (ImGui::SliderFloat("Time step", &time_step, .0001f, .01f, "%.4f")) {
+    driver->SetTimeStep(time_step);
+  }
+  if (ImGui::SliderFloat("Friction", &mu, 0.f, 1.f)) {
+    driver->Post([mu = mu] { GridParticle::mu = mu; });
+  }
   if (ImGui::SliderFloat("Young's modulus", &E, 1.f, 1000.f) |
       ImGui::SliderFloat("Poisson's ratio", &nu, -.9f, .49f)) {
-    grid.SetElasticParams(E, nu);
+    driver->Post([E = E, nu = nu] { grid.SetElasticParams(E, nu); });
   }
   if (ImGui::SliderFloat("Viscosity", &eta, 0.f, 100.f)) {
-    grid.SetDamping(eta);
+    driver->Post([eta = eta] { grid.SetDamping(eta); });
   }
+  ImGui::Separator();
+  DrawDriverPanel(*driver);
+  ImGui::Separator();
+  DrawProfilerPanel("Grid::Update");
   ImGui::End();
 
   ImGui::Render();
@@ -196,9 +243,12 @@ void RenderUI() {
 }  // namespace
 
 int main() {
+  Profiler::SetThreadName("main");
   const auto window = Initialize();
 
   Axes axes;
+  driver = std::make_unique<SimulationDriver>(
+      [](float dt) { grid.Update(dt); }, Publish, time_step);
   Restart();
 
   auto last_time = glfwGetTime();
@@ -213,11 +263,9 @@ int main() {
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     camera.Update(dt);
-    // Do multiple physical simulation in one render loop
-    for (auto ddt = dt; simulating && ddt > 0.f; ddt -= time_step) {
-      grid.Update(time_step);
+    if (snapshots.Update() && snapshots.Front().generation == generation) {
+      renderer.Update(snapshots.Front().particles);
     }
-    renderer.Update(grid.Particles());
 
     axes.Draw(camera);
     if (wireframe) {
@@ -233,6 +281,7 @@ int main() {
   }
 
   // Clean up
+  driver.reset();
   glfwDestroyWindow(window);
   glfwTerminate();
 }
\ No newline at end of file
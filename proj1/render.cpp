@@ -0,0 +1,82 @@
+#include <glad/glad.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <glm/glm.hpp>
+#include <iostream>
+#include <string>
+
+#include "Arguments.hpp"
+#include "Axes.hpp"
+#include "Camera.hpp"
+#include "FrameRecorder.hpp"
+#include "Grid.hpp"
+#include "GridRenderer.hpp"
+#include "OffscreenContext.hpp"
+
+namespace {
+const auto time_step = 1E-3f;
+const auto frame_time = 1.f / 60;
+}  // namespace
+
+// Renders the GUI's grid to frames at 60 per simulated second, without a
+// window or a display
+// proj1_render [output] [frames] [wireframe]
+// output is a pattern like frames/%05d.png or a raw RGBA file, see
+// FrameRecorder. PHYSIM_RENDER_SIZE=WxH sets the frame size.
+int main(int argc, char *argv[]) {
+  const std::string output = argc > 1 ? argv[1] : "proj1_%05d.png";
+  unsigned long frames = 300;
+  if (!ParseArgument(argc, argv, 2, frames)) {
+    std::cerr << "Usage: proj1_render [output] [frames] [wireframe]"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+  const auto wireframe = argc > 3 && std::string(argv[3]) == "wireframe";
+  const auto steps_per_frame = int(std::lround(frame_time / time_step));
+
+  const OffscreenContext context;
+  if (!context) return EXIT_FAILURE;
+  const auto size = FrameRecorder::SizeFromEnvironment();
+
+  // Same defaults as the GUI
+  Grid grid(glm::vec3(.5f, 2.f, .5f), glm::vec3(0.f), glm::vec3(.5f),
+            glm::uvec3(4, 4, 4), 100.f, .4f, 1.f);
+  const Camera camera({-2, 1, -2}, {0, 0, 0}, size.x, size.y);
+
+  // GL objects go before the context
+  Axes axes;
+  GridRenderer renderer(grid.Particles(), grid.ParticleIndices());
+  FrameRecorder recorder(output, size.x, size.y);
+  if (recorder.GetError()) return EXIT_FAILURE;
+
+  glClearColor(0.f, 0.f, 0.f, 1.f);
+  glEnable(GL_DEPTH_TEST);
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t frame = 0; frame < frames; ++frame) {
+    for (auto i = 0; i < steps_per_frame && !grid.GetError(); ++i) {
+      grid.Update(time_step);
+    }
+
+    recorder.Bind();
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    renderer.Update(grid.Particles());
+    axes.Draw(camera);
+    if (wireframe) {
+      renderer.DrawTetrahedra(camera);
+    } else {
+      renderer.DrawSurface(camera);
+    }
+    recorder.Capture();
+  }
+  recorder.Finish();
+  const auto seconds =
+      std::chrono::duration<float>(std::chrono::steady_clock::now() - start)
+          .count();
+
+  std::cout << "Frames written: " << recorder.Written() << " of " << frames
+            << ", frames/s: " << frames / seconds << std::endl;
+  if (grid.GetError()) std::cerr << "Grid blown up" << std::endl;
+  return recorder.GetError() ? EXIT_FAILURE : EXIT_SUCCESS;
+}
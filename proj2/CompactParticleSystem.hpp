@@ -0,0 +1,138 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+#include <type_traits>
+#include <vector>
+
+#include "ParticleSystem.hpp"
+
+/**
+ * Particles in reduced precision to cut memory traffic of the SPH loops
+ *
+ * Velocity and density are stored as half floats, density as its deviation
+ * from rho_0 so the precision goes where the pressure needs it. With
+ * FixedPosition, positions are 21-bit fixed point within the range set by
+ * SetRange(), packed in 8 bytes. Accessors decode to fp32, so all arithmetic
+ * stays in full precision. A value that does not fit is stored clamped or as
+ * infinity and flags GetOverflow().
+ */
+template <bool FixedPosition>
+class CompactParticleSystem {
+public:
+  struct Stored {
+    // Two words instead of one uint64_t keep the struct 4-byte aligned
+    std::conditional_t<FixedPosition, std::array<std::uint32_t, 2>, glm::vec3>
+        p;
+    std::uint16_t v[3], rho;
+    float m;
+  };
+
+  size_t Size() const { return data.size(); }
+
+  void SetRange(const glm::vec3& lo, const glm::vec3& hi, float rho_0) {
+    lo_ = lo;
+    scale_ = (hi - lo) / float(kMaxCoord);
+    rho_0_ = rho_0;
+  }
+
+  void Add(const Particle& p) {
+    data.emplace_back();
+    const auto i = data.size() - 1;
+    SetP(i, p.p);
+    SetV(i, p.v);
+    SetM(i, p.m);
+    SetRho(i, p.rho);
+  }
+
+  glm::vec3 P(size_t i) const {
+    if constexpr (FixedPosition) {
+      const auto bits = std::uint64_t(data[i].p[1]) << 32 | data[i].p[0];
+      const auto q =
+          glm::ivec3(int(bits & kMaxCoord), int(bits >> 21 & kMaxCoord),
+                     int(bits >> 42 & kMaxCoord));
+      return lo_ + glm::vec3(q) * scale_;
+    } else {
+      return data[i].p;
+    }
+  }
+
+  glm::vec3 V(size_t i) const {
+    const auto& v = data[i].v;
+    return {glm::unpackHalf1x16(v[0]), glm::unpackHalf1x16(v[1]),
+            glm::unpackHalf1x16(v[2])};
+  }
+
+  float M(size_t i) const { return data[i].m; }
+
+  float Rho(size_t i) const {
+    return rho_0_ * (1.f + glm::unpackHalf1x16(data[i].rho));
+  }
+
+  void SetP(size_t i, const glm::vec3& p) {
+    if constexpr (FixedPosition) {
+      // Out of range positions are clamped to the boundary, NaN to lo
+      glm::uvec3 q;
+      for (int a = 0; a < 3; ++a) {
+        const auto x = (p[a] - lo_[a]) / scale_[a];
+        if (!(x >= 0.f && x <= float(kMaxCoord))) overflow_ = true;
+        q[a] = std::uint32_t(x > 0.f ? std::min(x + .5f, float(kMaxCoord))
+                                     : 0.f);
+      }
+      const auto bits = std::uint64_t(q.x) | std::uint64_t(q.y) << 21 |
+                        std::uint64_t(q.z) << 42;
+      data[i].p = {std::uint32_t(bits), std::uint32_t(bits >> 32)};
+    } else {
+      data[i].p = p;
+    }
+  }
+
+  void SetV(size_t i, const glm::vec3& v) {
+    data[i].v[0] = PackHalf(v.x);
+    data[i].v[1] = PackHalf(v.y);
+    data[i].v[2] = PackHalf(v.z);
+  }
+
+  void SetM(size_t i, float m) { data[i].m = m; }
+
+  void SetRho(size_t i, float rho) {
+    data[i].rho = PackHalf(rho / rho_0_ - 1.f);
+  }
+
+  /**
+   * Some packed value set so far was not finite or out of its range
+   * Setters run on one thread at a time, so this is a plain flag.
+   */
+  bool GetOverflow() const { return overflow_; }
+
+  /**
+   * Decode into full precision, e.g. for rendering or comparison
+   */
+  void Decode(ParticleSystem& system) const {
+    system.data.resize(Size());
+    for (size_t i = 0; i < Size(); ++i) {
+      system.data[i] = {P(i), V(i), M(i), Rho(i)};
+    }
+  }
+
+  static constexpr size_t kBytesPerParticle = sizeof(Stored);
+
+  std::vector<Stored> data;
+
+private:
+  static constexpr std::uint64_t kMaxCoord = (std::uint64_t(1) << 21) - 1;
+  static constexpr float kMaxHalf = 65504.f;  // Largest finite half float
+
+  std::uint16_t PackHalf(float x) {
+    if (!(std::abs(x) <= kMaxHalf)) overflow_ = true;
+    return glm::packHalf1x16(x);
+  }
+
+  glm::vec3 lo_{0.f}, scale_{1.f};
+  float rho_0_ = 1E3f;
+  bool overflow_ = false;
+};
@@ -0,0 +1,293 @@
+#include "FrameCache.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cassert>
+#include <cstring>
+#include <glm/gtc/packing.hpp>
+#include <iostream>
+
+using namespace glm;
+using namespace frame_cache;
+
+namespace {
+const char kFileMagic[4] = {'P', 'S', 'P', 'H'};
+const char kIndexMagic[4] = {'P', 'I', 'D', 'X'};
+
+void PutVarint(std::vector<std::uint8_t>& out, std::uint32_t x) {
+  while (x >= 0x80) {
+    out.push_back(std::uint8_t(x | 0x80));
+    x >>= 7;
+  }
+  out.push_back(std::uint8_t(x));
+}
+
+// False if it would read at or past end, or is longer than 5 bytes
+bool GetVarint(const std::uint8_t*& in, const std::uint8_t* end,
+               std::uint32_t& x) {
+  x = 0;
+  for (int shift = 0; shift < 35 && in < end; shift += 7) {
+    const auto b = *in++;
+    x |= std::uint32_t(b & 0x7f) << shift;
+    if (!(b & 0x80)) return true;
+  }
+  return false;
+}
+
+std::uint32_t ZigZag(std::int32_t x) {
+  return (std::uint32_t(x) << 1) ^ std::uint32_t(x >> 31);
+}
+
+std::int32_t UnZigZag(std::uint32_t x) {
+  return std::int32_t(x >> 1) ^ -std::int32_t(x & 1);
+}
+}  // namespace
+
+FrameCacheWriter::FrameCacheWriter(const std::string& path,
+                                   const glm::vec3& box, size_t every_n,
+                                   bool velocity, size_t capacity)
+    : file_(path, std::ios::binary | std::ios::trunc),
+      every_n_(max(every_n, size_t(1))),
+      velocity_(velocity),
+      capacity_(max(capacity, size_t(1))) {
+  // Box spans [-x, x] * [0, y] * [-z, z], particles may penetrate it slightly
+  const auto margin = .05f * max(box.x, max(box.y, box.z));
+  lo_ = vec3{-box.x, 0.f, -box.z} - margin;
+  hi_ = box + margin;
+
+  if (!file_) {
+    std::cerr << "Cannot open frame cache " << path << std::endl;
+    return;
+  }
+
+  FileHeader header{};
+  std::memcpy(header.magic, kFileMagic, 4);
+  header.version = kVersion;
+  header.flags = velocity_ ? kVelocityFlag : 0;
+  header.lo = lo_;
+  header.hi = hi_;
+  file_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+  worker_ = std::thread(&FrameCacheWriter::Run, this);
+}
+
+FrameCacheWriter::~FrameCacheWriter() {
+  if (!worker_.joinable()) return;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  cv_.notify_one();
+  worker_.join();
+
+  // Footer
+  IndexTrailer trailer{};
+  trailer.index_offset = std::uint64_t(file_.tellp());
+  trailer.frames = index_.size();
+  std::memcpy(trailer.magic, kIndexMagic, 4);
+  trailer.version = kVersion;
+  file_.write(reinterpret_cast<const char*>(index_.data()),
+              index_.size() * sizeof(IndexEntry));
+  file_.write(reinterpret_cast<const char*>(&trailer), sizeof(trailer));
+}
+
+void FrameCacheWriter::Write(const ParticleSystem& system) {
+  const auto step = step_++;
+  if (!worker_.joinable() || step % every_n_) return;
+
+  Frame frame;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (queue_.size() >= capacity_) {
+      ++dropped_;
+      return;
+    }
+    if (!free_.empty()) {
+      frame = std::move(free_.back());
+      free_.pop_back();
+    }
+  }
+
+  frame.step = step;
+  frame.p.resize(3 * system.Size());
+  frame.v.resize(velocity_ ? 3 * system.Size() : 0);
+  const auto scale = 65535.f / (hi_ - lo_);
+  for (size_t i = 0; i < system.Size(); ++i) {
+    const auto q = clamp((system[i].p - lo_) * scale, 0.f, 65535.f) + .5f;
+    for (int a = 0; a < 3; ++a) {
+      frame.p[3 * i + a] = std::uint16_t(q[a]);
+    }
+    if (velocity_) {
+      for (int a = 0; a < 3; ++a) {
+        frame.v[3 * i + a] = packHalf1x16(system[i].v[a]);
+      }
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    queue_.push_back(std::move(frame));
+  }
+  cv_.notify_one();
+}
+
+size_t FrameCacheWriter::Written() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return written_;
+}
+
+size_t FrameCacheWriter::Dropped() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return dropped_;
+}
+
+void FrameCacheWriter::Run() {
+  for (;;) {
+    Frame frame;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+      if (queue_.empty()) return;  // Drained and stopped
+      frame = std::move(queue_.front());
+      queue_.pop_front();
+    }
+
+    Encode(frame);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++written_;
+    free_.push_back(std::move(frame));
+  }
+}
+
+void FrameCacheWriter::Encode(const Frame& frame) {
+  // Positions: per axis delta against previous particle, zigzag + varint
+  // Particles are seeded in scan order so neighbors in memory stay close
+  payload_.clear();
+  const auto n = frame.p.size() / 3;
+  for (int a = 0; a < 3; ++a) {
+    std::int32_t prev = 0;
+    for (size_t i = 0; i < n; ++i) {
+      const std::int32_t x = frame.p[3 * i + a];
+      PutVarint(payload_, ZigZag(x - prev));
+      prev = x;
+    }
+  }
+  // Velocities: raw half floats
+  for (const auto v : frame.v) {
+    payload_.push_back(std::uint8_t(v));
+    payload_.push_back(std::uint8_t(v >> 8));
+  }
+  // Keep chunks 8-byte aligned for the mapped reader
+  payload_.resize((payload_.size() + 7) / 8 * 8, 0);
+
+  FrameHeader header{};
+  header.step = frame.step;
+  header.count = std::uint32_t(n);
+  header.bytes = std::uint32_t(payload_.size());
+
+  index_.push_back({std::uint64_t(file_.tellp()), frame.step});
+  file_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file_.write(reinterpret_cast<const char*>(payload_.data()), payload_.size());
+}
+
+FrameCacheReader::FrameCacheReader(const std::string& path) {
+  const auto fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    std::cerr << "Cannot open frame cache " << path << std::endl;
+    return;
+  }
+  struct stat st {};
+  fstat(fd, &st);
+  size_ = size_t(st.st_size);
+  if (size_ < sizeof(FileHeader) + sizeof(IndexTrailer)) {
+    std::cerr << "Truncated frame cache " << path << std::endl;
+    close(fd);
+    return;
+  }
+  auto data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    std::cerr << "Cannot map frame cache " << path << std::endl;
+    return;
+  }
+  data_ = static_cast<const std::uint8_t*>(data);
+
+  header_ = reinterpret_cast<const FileHeader*>(data_);
+  const auto trailer = reinterpret_cast<const IndexTrailer*>(
+      data_ + size_ - sizeof(IndexTrailer));
+  if (std::memcmp(header_->magic, kFileMagic, 4) ||
+      std::memcmp(trailer->magic, kIndexMagic, 4) ||
+      header_->version != kVersion || trailer->version != kVersion ||
+      trailer->index_offset < sizeof(FileHeader) ||
+      trailer->index_offset > size_ - sizeof(IndexTrailer) ||
+      trailer->frames > (size_ - sizeof(IndexTrailer) - trailer->index_offset) /
+                            sizeof(IndexEntry)) {
+    std::cerr << "Invalid frame cache " << path << std::endl;
+    munmap(data, size_);
+    data_ = nullptr;
+    return;
+  }
+  index_ = reinterpret_cast<const IndexEntry*>(data_ + trailer->index_offset);
+  frames_ = trailer->frames;
+
+  // Every frame within the frames area, so Read() only checks its payload
+  for (size_t i = 0; i < frames_; ++i) {
+    const auto offset = index_[i].offset;
+    const auto end = trailer->index_offset;
+    const auto header = reinterpret_cast<const FrameHeader*>(data_ + offset);
+    if (offset < sizeof(FileHeader) || offset % 8 ||
+        offset > end - sizeof(FrameHeader) ||
+        header->bytes > end - offset - sizeof(FrameHeader)) {
+      std::cerr << "Invalid frame " << i << " in frame cache " << path
+                << std::endl;
+      munmap(data, size_);
+      data_ = nullptr;
+      frames_ = 0;
+      return;
+    }
+  }
+}
+
+FrameCacheReader::~FrameCacheReader() {
+  if (data_) munmap(const_cast<std::uint8_t*>(data_), size_);
+}
+
+bool FrameCacheReader::Read(size_t i, ParticleSystem& system) const {
+  assert(i < frames_);
+  const auto header =
+      reinterpret_cast<const FrameHeader*>(data_ + index_[i].offset);
+  const auto n = size_t(header->count);
+  auto in = reinterpret_cast<const std::uint8_t*>(header + 1);
+  const auto end = in + header->bytes;
+
+  // At least a byte per coordinate, and the velocities behind them
+  const auto velocity_bytes = HasVelocity() ? 6 * n : 0;
+  if (3 * n + velocity_bytes > header->bytes) return false;
+
+  system.data.resize(n);
+  const auto scale = (header_->hi - header_->lo) / 65535.f;
+  for (int a = 0; a < 3; ++a) {
+    std::int32_t x = 0;
+    for (size_t j = 0; j < n; ++j) {
+      std::uint32_t delta;
+      if (!GetVarint(in, end - velocity_bytes, delta)) return false;
+      x += UnZigZag(delta);
+      system[j].p[a] = header_->lo[a] + float(x) * scale[a];
+    }
+  }
+  for (size_t j = 0; j < n; ++j) {
+    for (int a = 0; a < 3; ++a) {
+      if (HasVelocity()) {
+        system[j].v[a] = unpackHalf1x16(std::uint16_t(in[0] | in[1] << 8));
+        in += 2;
+      } else {
+        system[j].v[a] = 0.f;
+      }
+    }
+  }
+  return true;
+}
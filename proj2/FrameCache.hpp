@@ -0,0 +1,141 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <glm/glm.hpp>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ParticleSystem.hpp"
+
+/**
+ * Chunked particle cache file
+ *
+ * Layout: FileHeader, frame chunks (FrameHeader + payload), frame index,
+ * IndexTrailer. Every frame is coded on its own so it can be decoded straight
+ * from the mapped file without touching other frames.
+ */
+namespace frame_cache {
+constexpr std::uint32_t kVersion = 1;
+constexpr std::uint32_t kVelocityFlag = 1;
+
+struct FileHeader {
+  char magic[4];
+  std::uint32_t version;
+  std::uint32_t flags;
+  std::uint32_t reserved;
+  glm::vec3 lo, hi;  // Quantization bounds of positions
+};
+
+struct FrameHeader {
+  std::uint64_t step;
+  std::uint32_t count;  // Number of particles
+  std::uint32_t bytes;  // Payload size
+};
+
+struct IndexEntry {
+  std::uint64_t offset;  // Offset of FrameHeader
+  std::uint64_t step;
+};
+
+struct IndexTrailer {
+  std::uint64_t index_offset;
+  std::uint64_t frames;
+  char magic[4];
+  std::uint32_t version;
+};
+}  // namespace frame_cache
+
+class FrameCacheWriter {
+public:
+  /**
+   * Positions are quantized to 16 bits per axis within the box returned by
+   * SPHSimulator::GetBox(), padded by a margin
+   * At most capacity frames are queued, further frames are dropped
+   */
+  FrameCacheWriter(const std::string& path, const glm::vec3& box,
+                   size_t every_n = 1, bool velocity = true,
+                   size_t capacity = 8);
+
+  FrameCacheWriter(const FrameCacheWriter&) = delete;
+  FrameCacheWriter& operator=(const FrameCacheWriter&) = delete;
+
+  ~FrameCacheWriter();
+
+  /**
+   * Called after each step, only every Nth step is queued
+   * Never waits for the disk
+   */
+  void Write(const ParticleSystem& system);
+
+  size_t Written() const;
+
+  size_t Dropped() const;
+
+private:
+  struct Frame {
+    std::uint64_t step;
+    std::vector<std::uint16_t> p, v;  // Quantized, interleaved xyz
+  };
+
+  void Run();
+
+  void Encode(const Frame& frame);
+
+  std::ofstream file_;
+  glm::vec3 lo_, hi_;
+  size_t every_n_;
+  bool velocity_;
+  size_t capacity_;
+
+  std::uint64_t step_ = 0;
+
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<Frame> queue_;
+  std::vector<Frame> free_;  // Recycled frame buffers
+  bool stop_ = false;
+  size_t written_ = 0, dropped_ = 0;
+
+  // Only touched by the worker
+  std::vector<frame_cache::IndexEntry> index_;
+  std::vector<std::uint8_t> payload_;
+
+  std::thread worker_;
+};
+
+class FrameCacheReader {
+public:
+  explicit FrameCacheReader(const std::string& path);
+
+  FrameCacheReader(const FrameCacheReader&) = delete;
+  FrameCacheReader& operator=(const FrameCacheReader&) = delete;
+
+  ~FrameCacheReader();
+
+  explicit operator bool() const { return data_ != nullptr; }
+
+  size_t Frames() const { return frames_; }
+
+  std::uint64_t Step(size_t i) const { return index_[i].step; }
+
+  bool HasVelocity() const { return header_->flags & frame_cache::kVelocityFlag; }
+
+  /**
+   * Decode frame i into system, only p and v are filled
+   * False if the frame's payload is corrupt
+   */
+  bool Read(size_t i, ParticleSystem& system) const;
+
+private:
+  const std::uint8_t* data_ = nullptr;
+  size_t size_ = 0;
+
+  const frame_cache::FileHeader* header_ = nullptr;
+  const frame_cache::IndexEntry* index_ = nullptr;
+  size_t frames_ = 0;
+};
@@ -1,11 +1,23 @@
 #include "Integrator.hpp"
 
+#include "CompactParticleSystem.hpp"
+
 using namespace glm;
 
-void Integrator::Integrate(ParticleSystem& system, float dt) {
+template <typename System>
+void Integrator::Integrate(System& system, const std::vector<vec3>& forces,
+                           float dt) {
   for (size_t i = 0; i < system.Size(); ++i) {
-    const auto a = system[i].f / system[i].m;
-    system[i].v += a * dt;
-    system[i].p += system[i].v * dt;
+    const auto a = forces[i] / system.M(i);
+    const auto v = system.V(i) + a * dt;
+    system.SetV(i, v);
+    system.SetP(i, system.P(i) + v * dt);
   }
 }
+
+template void Integrator::Integrate(ParticleSystem&, const std::vector<vec3>&,
+                                    float);
+template void Integrator::Integrate(CompactParticleSystem<false>&,
+                                    const std::vector<vec3>&, float);
+template void Integrator::Integrate(CompactParticleSystem<true>&,
+                                    const std::vector<vec3>&, float);
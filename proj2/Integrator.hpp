@@ -1,8 +1,16 @@
 #pragma once
 
+#include <glm/glm.hpp>
+#include <vector>
+
 #include "ParticleSystem.hpp"
 
 class Integrator {
 public:
-  void Integrate(ParticleSystem& system, float dt);
+  /**
+   * Forces are per-step scratch owned by the caller, not particle state
+   */
+  template <typename System>
+  void Integrate(System& system, const std::vector<glm::vec3>& forces,
+                 float dt);
 };
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+
 #include "ParticleSystem.hpp"
 
 class NeighborSearch {
@@ -9,11 +12,98 @@ public:
   NeighborSearch(size_t m, size_t n, float d)
       : neighbors(n), d_(d), buckets_(m) {}
 
-  void Update(const ParticleSystem& system);
+  // System is ParticleSystem or CompactParticleSystem
+  template <typename System>
+  void Update(const System& system);
+
+  /**
+   * Only rebuild the hash table, without neighbor lists
+   */
+  template <typename System>
+  void Rehash(const System& system);
+
+  /**
+   * Call fn(j) for every particle j within d of x, after Rehash()/Update()
+   */
+  template <typename System, typename F>
+  void Query(const System& system, const glm::vec3& x, F fn) const;
+
+  /**
+   * Call fn(j) for every particle j inside the box [lo, hi]
+   */
+  template <typename System, typename F>
+  void QueryBox(const System& system, const glm::vec3& lo,
+                const glm::vec3& hi, F fn) const;
 
   std::vector<std::vector<size_t>> neighbors;
 
 private:
+  static size_t Hash(const glm::vec3& x, float d, size_t m,
+                     const glm::ivec3& disp = glm::ivec3{0, 0, 0}) {
+    const auto c = (glm::ivec3(glm::floor(x / d)) + disp) *
+                   glm::ivec3{73856093, 19349663, 83492791};
+    return size_t(c.x ^ c.y ^ c.z) % m;
+  }
+
   float d_;
   std::vector<std::vector<size_t>> buckets_;
 };
+
+template <typename System, typename F>
+void NeighborSearch::Query(const System& system, const glm::vec3& x,
+                           F fn) const {
+  std::array<size_t, 27> seen;
+  size_t n_seen = 0;
+  // Loop over 3*3*3 neighboring cells
+  for (int dx = -1; dx < 2; ++dx) {
+    for (int dy = -1; dy < 2; ++dy) {
+      for (int dz = -1; dz < 2; ++dz) {
+        const auto hash =
+            Hash(x, d_, buckets_.size(), glm::ivec3{dx, dy, dz});
+
+        // Hash of neighors may be the same, deduplicate
+        if (std::find(seen.begin(), seen.begin() + n_seen, hash) !=
+            seen.begin() + n_seen) {
+          continue;
+        }
+        seen[n_seen++] = hash;
+
+        for (const auto j : buckets_[hash]) {
+          if (glm::length(x - system.P(j)) < d_) {
+            fn(j);
+          }
+        }
+      }
+    }
+  }
+}
+
+template <typename System, typename F>
+void NeighborSearch::QueryBox(const System& system, const glm::vec3& lo,
+                              const glm::vec3& hi, F fn) const {
+  const auto cells = glm::ivec3(glm::floor(hi / d_)) -
+                     glm::ivec3(glm::floor(lo / d_)) + 1;
+  std::vector<size_t> hashes;
+  hashes.reserve(cells.x * cells.y * cells.z);
+  for (int dx = 0; dx < cells.x; ++dx) {
+    for (int dy = 0; dy < cells.y; ++dy) {
+      for (int dz = 0; dz < cells.z; ++dz) {
+        hashes.push_back(
+            Hash(lo, d_, buckets_.size(), glm::ivec3{dx, dy, dz}));
+      }
+    }
+  }
+  // Hash of cells may be the same, deduplicate
+  std::sort(hashes.begin(), hashes.end());
+  hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+
+  for (const auto hash : hashes) {
+    for (const auto j : buckets_[hash]) {
+      const auto p = system.P(j);
+      if (glm::all(glm::lessThanEqual(lo, p)) &&
+          glm::all(glm::lessThanEqual(p, hi))) {
+        fn(j);
+      }
+    }
+  }
+}
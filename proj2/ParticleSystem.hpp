@@ -4,10 +4,26 @@
 #include <vector>
 
 struct Particle {
-  glm::vec3 p, v, f;
+  glm::vec3 p, v;
   float m, rho;
 };
 
+/**
+ * Non-owning view of contiguous particles, e.g. in a mapped region
+ */
+struct ParticleView {
+  using value_type = Particle;
+
+  const Particle* data() const { return ptr; }
+  size_t size() const { return n; }
+  const Particle* begin() const { return ptr; }
+  const Particle* end() const { return ptr + n; }
+  const Particle& operator[](size_t i) const { return ptr[i]; }
+
+  const Particle* ptr;
+  size_t n;
+};
+
 class ParticleSystem {
 public:
   size_t Size() const { return data.size(); }
@@ -17,6 +33,31 @@ public:
 
   void Add(const Particle& p) { data.push_back(p); }
 
+  ParticleView View() const { return {data.data(), data.size()}; }
+
+  // Accessors shared with CompactParticleSystem
+  glm::vec3 P(size_t i) const { return data[i].p; }
+  glm::vec3 V(size_t i) const { return data[i].v; }
+  float M(size_t i) const { return data[i].m; }
+  float Rho(size_t i) const { return data[i].rho; }
+
+  void SetP(size_t i, const glm::vec3& p) { data[i].p = p; }
+  void SetV(size_t i, const glm::vec3& v) { data[i].v = v; }
+  void SetM(size_t i, float m) { data[i].m = m; }
+  void SetRho(size_t i, float rho) { data[i].rho = rho; }
+
+  /**
+   * Range of positions and reference density, unused at full precision
+   */
+  void SetRange(const glm::vec3&, const glm::vec3&, float) {}
+
+  /**
+   * Nothing is packed at full precision, the simulator checks for NaN itself
+   */
+  bool GetOverflow() const { return false; }
+
+  static constexpr size_t kBytesPerParticle = sizeof(Particle);
+
   std::vector<Particle> data;
   static inline const glm::vec3 g{0.f, -9.8f, 0.f};
 };
@@ -3,16 +3,18 @@
 #include <glad/glad.h>
 
 #include <array>
+#include <cstddef>
 #include <glpp/program.hpp>
 
 #include "Camera.hpp"
+#include "SurfaceReconstructor.hpp"
 #include "proj2_shaders.hpp"
 
 using namespace glm;
 using namespace glpp;
 
 namespace {
-std::unique_ptr<Program> program;
+std::unique_ptr<Program> program, surface_program;
 std::unique_ptr<Buffer> box_ebo;
 
 void Initialize() {
@@ -20,6 +22,11 @@ void Initialize() {
     program = std::make_unique<Program>(
         Shader(VERTEX_SHADER, std::string(sph_vert.begin(), sph_vert.end())),
         Shader(FRAGMENT_SHADER, std::string(sph_frag.begin(), sph_frag.end())));
+    surface_program = std::make_unique<Program>(
+        Shader(VERTEX_SHADER,
+               std::string(surface_vert.begin(), surface_vert.end())),
+        Shader(FRAGMENT_SHADER,
+               std::string(surface_frag.begin(), surface_frag.end())));
   }
   if (!box_ebo) {
     std::array<uint, 24> indices = {0, 1, 1, 2, 2, 3, 3, 0, 4, 5, 5, 6,
@@ -30,26 +37,25 @@ void Initialize() {
 }
 }  // namespace
 
-SPHRenderer::SPHRenderer(const ParticleSystem& system, const glm::vec3& box)
-    : size_(system.Size()) {
+SPHRenderer::SPHRenderer(const ParticleView& particles, const glm::vec3& box)
+    : size_(particles.size()) {
   Initialize();
-  InitializeParticleVAO(system);
+  InitializeParticleVAO(particles);
   InitializeBoxVAO(box);
 }
 
-void SPHRenderer::InitializeParticleVAO(const ParticleSystem& system) {
+void SPHRenderer::InitializeParticleVAO(const ParticleView& particles) {
   vbo_ = std::make_unique<Buffer>();
-  vbo_->CreateStorage(system.data, GL_DYNAMIC_STORAGE_BIT);
+  vbo_->CreateStorage(particles, GL_DYNAMIC_STORAGE_BIT);
 
   vao_ = std::make_unique<VertexArray>();
   vao_->BindVertexBuffer(0, *vbo_, sizeof(Particle), 0);
-  vao_->EnableAttrib(0, 1, 2, 3, 4);
-  vao_->AttribBinding(0, 0, 1, 2, 3, 4);
-  vao_->AttribFormat<vec3>(0, 0);
-  vao_->AttribFormat<vec3>(1, sizeof(vec3));
-  vao_->AttribFormat<vec3>(2, 2 * sizeof(vec3));
-  vao_->AttribFormat<float>(3, 3 * sizeof(vec3));
-  vao_->AttribFormat<float>(4, 4 * sizeof(vec3) + sizeof(float));
+  vao_->EnableAttrib(0, 1, 2, 3);
+  vao_->AttribBinding(0, 0, 1, 2, 3);
+  vao_->AttribFormat<vec3>(0, offsetof(Particle, p));
+  vao_->AttribFormat<vec3>(1, offsetof(Particle, v));
+  vao_->AttribFormat<float>(2, offsetof(Particle, m));
+  vao_->AttribFormat<float>(3, offsetof(Particle, rho));
 }
 
 void SPHRenderer::InitializeBoxVAO(const glm::vec3& box) {
@@ -68,9 +74,9 @@ void SPHRenderer::InitializeBoxVAO(const glm::vec3& box) {
   box_vao_->AttribFormat<vec3>(0, 0);
 }
 
-void SPHRenderer::Update(const ParticleSystem& system) {
-  assert(system.Size() == size_);
-  vbo_->SetSubData(system.data);
+void SPHRenderer::Update(const ParticleView& particles) {
+  assert(particles.size() == size_);
+  vbo_->SetSubData(particles);
 }
 
 void SPHRenderer::Draw(const Camera& camera) {
@@ -84,3 +90,50 @@ void SPHRenderer::Draw(const Camera& camera) {
   box_vao_->Bind();
   glDrawElements(GL_LINES, 24, GL_UNSIGNED_INT, nullptr);
 }
+
+void SPHRenderer::UpdateSurface(const SurfaceMesh& mesh) {
+  surface_size_ = mesh.indices.size();
+  if (mesh.vertices.empty()) return;
+
+  // Grow storage only when the mesh outgrows it
+  if (mesh.vertices.size() > surface_capacity_ ||
+      mesh.indices.size() > surface_index_capacity_) {
+    surface_capacity_ = mesh.vertices.size() * 3 / 2;
+    surface_index_capacity_ = mesh.indices.size() * 3 / 2;
+    std::vector<SurfaceMesh::Vertex> vertices(surface_capacity_);
+    std::vector<uint> indices(surface_index_capacity_);
+
+    surface_vbo_ = std::make_unique<Buffer>();
+    surface_vbo_->CreateStorage(vertices, GL_DYNAMIC_STORAGE_BIT);
+    surface_ebo_ = std::make_unique<Buffer>();
+    surface_ebo_->CreateStorage(indices, GL_DYNAMIC_STORAGE_BIT);
+
+    surface_vao_ = std::make_unique<VertexArray>();
+    surface_vao_->BindVertexBuffer(0, *surface_vbo_,
+                                   sizeof(SurfaceMesh::Vertex), 0);
+    surface_vao_->BindElementBuffer(*surface_ebo_);
+    surface_vao_->EnableAttrib(0, 1);
+    surface_vao_->AttribBinding(0, 0, 1);
+    surface_vao_->AttribFormat<vec3>(0, 0);
+    surface_vao_->AttribFormat<vec3>(1, sizeof(vec3));
+  }
+  surface_vbo_->SetSubData(mesh.vertices);
+  surface_ebo_->SetSubData(mesh.indices);
+}
+
+void SPHRenderer::DrawSurface(const Camera& camera) {
+  if (surface_size_) {
+    surface_program->Use();
+    surface_program->Uniform("projection", camera.Projection());
+    surface_program->Uniform("view", camera.View());
+
+    surface_vao_->Bind();
+    glDrawElements(GL_TRIANGLES, surface_size_, GL_UNSIGNED_INT, nullptr);
+  }
+
+  program->Use();
+  program->Uniform("projection", camera.Projection());
+  program->Uniform("view", camera.View());
+  box_vao_->Bind();
+  glDrawElements(GL_LINES, 24, GL_UNSIGNED_INT, nullptr);
+}
@@ -8,19 +8,37 @@
 #include "ParticleSystem.hpp"
 
 class Camera;
+struct SurfaceMesh;
 
 class SPHRenderer {
 public:
   SPHRenderer() = default;
 
-  SPHRenderer(const ParticleSystem& system, const glm::vec3& box);
+  SPHRenderer(const ParticleSystem& system, const glm::vec3& box)
+      : SPHRenderer(system.View(), box) {}
 
-  void Update(const ParticleSystem& system);
+  SPHRenderer(const ParticleView& particles, const glm::vec3& box);
+
+  void Update(const ParticleSystem& system) { Update(system.View()); }
+
+  /**
+   * Upload straight from particles, which may live in a mapped region
+   */
+  void Update(const ParticleView& particles);
+
+  size_t Size() const { return size_; }
 
   void Draw(const Camera& camera);
 
+  void UpdateSurface(const SurfaceMesh& mesh);
+
+  /**
+   * Draw reconstructed surface instead of particles
+   */
+  void DrawSurface(const Camera& camera);
+
 private:
-  void InitializeParticleVAO(const ParticleSystem& system);
+  void InitializeParticleVAO(const ParticleView& particles);
   void InitializeBoxVAO(const glm::vec3& box);
 
   size_t size_;
@@ -28,4 +46,8 @@ private:
   std::unique_ptr<glpp::Buffer> vbo_;
   std::unique_ptr<glpp::VertexArray> vao_;
   std::unique_ptr<glpp::VertexArray> box_vao_;
+
+  size_t surface_size_ = 0, surface_capacity_ = 0, surface_index_capacity_ = 0;
+  std::unique_ptr<glpp::Buffer> surface_vbo_, surface_ebo_;
+  std::unique_ptr<glpp::VertexArray> surface_vao_;
 };
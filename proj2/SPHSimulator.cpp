@@ -1,12 +1,31 @@
 #include "SPHSimulator.hpp"
 
+#include <glm/gtx/compatibility.hpp>
 #include <iostream>
+#include <type_traits>
+
+#include "Checkpoint.hpp"
+#include "Profiler.hpp"
 
 using namespace glm;
 
-SPHSimulator::SPHSimulator(const glm::vec3& min_bound,
-                           const glm::vec3& max_bound,
-                           const ShapeIndicator& indicator) {
+template <typename System>
+BasicSPHSimulator<System>::BasicSPHSimulator(const glm::vec3& min_bound,
+                                             const glm::vec3& max_bound,
+                                             const ShapeIndicator& indicator,
+                                             const Parameters& params)
+    : h(params.h),
+      k(params.k),
+      rho_0(params.rho_0),
+      nu(params.nu),
+      box_x_(params.box_x),
+      box_z_(params.box_z),
+      box_stiffness_(params.box_stiffness) {
+  // Everything the particles can reach, with a margin for box penetration
+  const auto box = GetBox();
+  system_.SetRange(min(min_bound, vec3{-box.x, 0.f, -box.z}) - 1.f,
+                   max(max_bound, box) + 1.f, rho_0);
+
   auto sample = min_bound;
   for (sample.x = min_bound.x; sample.x < max_bound.x; sample.x += h) {
     for (sample.y = min_bound.y; sample.y < max_bound.y; sample.y += h) {
@@ -14,7 +33,7 @@ SPHSimulator::SPHSimulator(const glm::vec3& min_bound,
         if (indicator(sample)) {
           Particle p;
           p.p = sample;
-          p.v = p.f = vec3(0.f);
+          p.v = vec3(0.f);
           p.rho = rho_0;
           p.m = pow(h, 3) * rho_0;  // Initial mass
           system_.Add(p);
@@ -26,20 +45,23 @@ SPHSimulator::SPHSimulator(const glm::vec3& min_bound,
 
   search_ = NeighborSearch(500, system_.Size(), 2 * h);
   pressure_.resize(system_.Size());
+  force_.resize(system_.Size());
 
   InitializeMass();
 }
 
-void SPHSimulator::InitializeMass() {
+template <typename System>
+void BasicSPHSimulator<System>::InitializeMass() {
   // Iteratively solve mass to correct initial density
   search_.Update(system_);
-  for (;;) {
+  // Give up on slow convergence instead of hanging
+  for (size_t iteration = 0; iteration < 100; ++iteration) {
     {
       auto error = -FLT_MAX;
       for (size_t i = 0; i < system_.Size(); ++i) {
         error = max(
             error,
-            abs(Value(i, [this](const size_t j) { return system_[j].rho; }) -
+            abs(Value(i, [this](const size_t j) { return system_.Rho(j); }) -
                 rho_0));
       }
       std::cout << "Density error: " << error / rho_0 << std::endl;
@@ -51,46 +73,158 @@ void SPHSimulator::InitializeMass() {
       auto rho = 0.f;
       for (const auto j : search_.neighbors[i]) {
         if (j == i) continue;
-        rho += system_[j].m * W(i, j);
+        rho += system_.M(j) * W(i, j);
       }
-      system_[i].m = (rho_0 - rho) / W(i, i);
+      system_.SetM(i, (rho_0 - rho) / W(i, i));
     }
   }
 }
 
-void SPHSimulator::Update(float dt) {
+template <typename System>
+void BasicSPHSimulator<System>::Update(float dt) {
+  PROFILE_ZONE("SPHSimulator::Update");
+  UpdateNeighbors();
+  UpdateDensity();
+  UpdateForces();
+  ApplyBoxPenalty();
+  Integrate(dt);
+}
+
+template <typename System>
+void BasicSPHSimulator<System>::UpdateNeighbors() {
+  PROFILE_ZONE("SPHSimulator::UpdateNeighbors");
   search_.Update(system_);
+}
+
+template <typename System>
+void BasicSPHSimulator<System>::Integrate(float dt) {
+  PROFILE_ZONE("SPHSimulator::Integrate");
+  integrator_.Integrate(system_, force_, dt);
+
+  // Compact storage would hide NaN and runaway values by clamping them
+  if (system_.GetOverflow()) error_ = true;
+  for (size_t i = 0; i < system_.Size(); ++i) {
+    if (!all(isfinite(system_.P(i)))) {
+      error_ = true;
+      break;
+    }
+  }
+}
 
+template <typename System>
+void BasicSPHSimulator<System>::UpdateDensity() {
+  PROFILE_ZONE("SPHSimulator::UpdateDensity");
   for (size_t i = 0; i < system_.Size(); ++i) {
-    system_[i].rho =
-        Value(i, [this](const size_t j) { return system_[j].rho; });
-    pressure_[i] = k * (pow(system_[i].rho / rho_0, 7) - 1);
+    system_.SetRho(i,
+                   Value(i, [this](const size_t j) { return system_.Rho(j); }));
+    pressure_[i] = k * (pow(system_.Rho(i) / rho_0, 7) - 1);
   }
+}
+
+template <typename System>
+void BasicSPHSimulator<System>::UpdateForces() {
+  PROFILE_ZONE("SPHSimulator::UpdateForces");
+  // Densities are updated in place, so only forces, which just gather, are
+  // split over threads
+  jobs_.ParallelFor(system_.Size(), 256, [&](size_t begin, size_t end) {
+    for (auto i = begin; i < end; ++i) Force(i);
+  });
+}
 
+template <typename System>
+void BasicSPHSimulator<System>::Force(size_t i) {
+  const auto m = system_.M(i);
+  const auto f_pressure = -m / system_.Rho(i) *
+                          Grad(i, [this](size_t j) { return pressure_[j]; });
+  const auto f_viscosity =
+      m * nu * Laplace(i, [this](size_t j) { return system_.V(j); });
+  const auto f_gravity = m * ParticleSystem::g;
+  force_[i] = f_pressure + f_viscosity + f_gravity;
+}
+
+template <typename System>
+void BasicSPHSimulator<System>::ApplyBoxPenalty() {
+  PROFILE_ZONE("SPHSimulator::ApplyBoxPenalty");
+  jobs_.ParallelFor(system_.Size(), 1024, [&](size_t begin, size_t end) {
+    for (auto i = begin; i < end; ++i) {
+      const auto m = system_.M(i);
+      const auto p = system_.P(i);
+      force_[i] +=
+          box_stiffness_ * m * max(0.f, -p.y) * vec3{0.f, 1.f, 0.f} +
+          box_stiffness_ * m * max(0.f, p.x - box_x_) * vec3{-1.f, 0.f, 0.f} +
+          box_stiffness_ * m * max(0.f, p.z - box_z_) * vec3{0.f, 0.f, -1.f} +
+          box_stiffness_ * m * max(0.f, -p.x - box_x_) * vec3{1.f, 0.f, 0.f} +
+          box_stiffness_ * m * max(0.f, -p.z - box_z_) * vec3{0.f, 0.f, 1.f};
+    }
+  });
+}
+
+template <typename System>
+float BasicSPHSimulator<System>::GetDensityError() const {
+  auto error = 0.f;
   for (size_t i = 0; i < system_.Size(); ++i) {
-    const auto f_pressure = -system_[i].m / system_[i].rho *
-                            Grad(i, [this](size_t j) { return pressure_[j]; });
-    const auto f_viscosity = system_[i].m * nu * Laplace(i, [this](size_t j) {
-                               return system_[j].v;
-                             });
-    const auto f_gravity = system_[i].m * ParticleSystem::g;
-    system_[i].f = f_pressure + f_viscosity + f_gravity;
+    error = max(error, abs(system_.Rho(i) - rho_0) / rho_0);
   }
+  return error;
+}
 
-  // Box interaction
+template <typename System>
+float BasicSPHSimulator<System>::GetKineticEnergy() const {
+  auto energy = 0.f;
   for (size_t i = 0; i < system_.Size(); ++i) {
-    system_[i].f +=
-        box_stiffness_ * system_[i].m * max(0.f, -system_[i].p.y) *
-            vec3{0.f, 1.f, 0.f} +
-        box_stiffness_ * system_[i].m * max(0.f, system_[i].p.x - box_x_) *
-            vec3{-1.f, 0.f, 0.f} +
-        box_stiffness_ * system_[i].m * max(0.f, system_[i].p.z - box_z_) *
-            vec3{0.f, 0.f, -1.f} +
-        box_stiffness_ * system_[i].m * max(0.f, -system_[i].p.x - box_x_) *
-            vec3{1.f, 0.f, 0.f} +
-        box_stiffness_ * system_[i].m * max(0.f, -system_[i].p.z - box_z_) *
-            vec3{0.f, 0.f, 1.f};
+    const auto v = system_.V(i);
+    energy += system_.M(i) * dot(v, v) / 2;
+  }
+  return energy;
+}
+
+template <typename System>
+void BasicSPHSimulator<System>::Save(Checkpoint& checkpoint) const {
+  if constexpr (std::is_same<System, ParticleSystem>::value) {
+    checkpoint.AddValue("params", Parameters{h, k, rho_0, nu, box_x_, box_z_,
+                                             box_stiffness_});
+    checkpoint.AddValue("error", std::uint32_t(error_));
+    checkpoint.Add("particle", system_.data);
+    checkpoint.Add("pressure", pressure_);
+  } else {
+    std::cerr << "Checkpoints hold full precision particles only"
+              << std::endl;
   }
+}
 
-  integrator_.Integrate(system_, dt);
+template <typename System>
+bool BasicSPHSimulator<System>::Load(const CheckpointFile& file) {
+  if constexpr (std::is_same<System, ParticleSystem>::value) {
+    Parameters params;
+    std::uint32_t error;
+    std::vector<Particle> particles;
+    std::vector<float> pressure;
+    if (!file.ReadValue("params", params) || !file.ReadValue("error", error) ||
+        !file.Read("particle", particles) || !file.Read("pressure", pressure) ||
+        pressure.size() != particles.size()) {
+      return false;
+    }
+
+    h = params.h;
+    k = params.k;
+    rho_0 = params.rho_0;
+    nu = params.nu;
+    box_x_ = params.box_x;
+    box_z_ = params.box_z;
+    box_stiffness_ = params.box_stiffness;
+    error_ = error;
+    system_.data = std::move(particles);
+    pressure_ = std::move(pressure);
+    force_.assign(system_.Size(), vec3(0.f));
+    search_ = NeighborSearch(500, system_.Size(), 2 * h);
+    return true;
+  } else {
+    std::cerr << "Checkpoints hold full precision particles only"
+              << std::endl;
+    return false;
+  }
 }
+
+template class BasicSPHSimulator<ParticleSystem>;
+template class BasicSPHSimulator<CompactParticleSystem<false>>;
+template class BasicSPHSimulator<CompactParticleSystem<true>>;
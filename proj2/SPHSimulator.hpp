@@ -5,29 +5,87 @@
 #include <glm/gtc/constants.hpp>
 #include <cmath>
 
+#include "CompactParticleSystem.hpp"
 #include "Integrator.hpp"
+#include "JobSystem.hpp"
 #include "NeighborSearch.hpp"
 #include "ParticleSystem.hpp"
 
-class SPHSimulator {
+class Checkpoint;
+class CheckpointFile;
+
+struct SPHParameters {
+  float h = 0.1f, k = 1119E3f, rho_0 = 1E3f, nu = 1E-2f;
+  float box_x = 1.f, box_z = 1.f, box_stiffness = 1E5f;
+};
+
+/**
+ * System stores the particles: ParticleSystem in full precision, or
+ * CompactParticleSystem to trade accuracy for memory bandwidth
+ */
+template <typename System>
+class BasicSPHSimulator {
 public:
-  SPHSimulator() = default;
+  BasicSPHSimulator() = default;
 
   using ShapeIndicator = std::function<bool(const glm::vec3&)>;
 
-  SPHSimulator(const glm::vec3& min_bound, const glm::vec3& max_bound,
-               const ShapeIndicator& indicator);
+  using Parameters = SPHParameters;
+
+  BasicSPHSimulator(const glm::vec3& min_bound, const glm::vec3& max_bound,
+                    const ShapeIndicator& indicator,
+                    const Parameters& params = Parameters{});
 
   void Update(float dt);
 
-  const ParticleSystem& GetParticles() const { return system_; }
+  // Passes of Update() in order, public for benchmarks
+  void UpdateNeighbors();
+  void UpdateDensity();
+  void UpdateForces();
+  void ApplyBoxPenalty();
+  void Integrate(float dt);
+
+  /**
+   * Threads computing forces, 0 for the whole pool
+   * Results do not depend on it.
+   */
+  void SetThreads(size_t threads) { jobs_.SetThreads(threads); }
+  size_t GetThreads() const { return jobs_.GetThreads(); }
+
+  const System& GetParticles() const { return system_; }
 
   glm::vec3 GetBox() const { return {box_x_, 10.f, box_z_}; }
 
-private:
-  void InitializeMass();
+  float GetH() const { return h; }
+
+  /**
+   * Neighbor pairs found by the last UpdateNeighbors()
+   */
+  size_t GetNeighborCount() const {
+    size_t count = 0;
+    for (const auto& n : search_.neighbors) count += n.size();
+    return count;
+  }
+
+  /**
+   * Max relative deviation of density from rho_0
+   */
+  float GetDensityError() const;
 
-  float f(float q) const {
+  float GetKineticEnergy() const;
+
+  bool GetError() const { return error_; }
+
+  /**
+   * Particles, pressure and parameters, full precision only. Load() skips
+   * seeding and the mass solve and keeps the threads; on failure the
+   * simulator is left as it was.
+   */
+  void Save(Checkpoint& checkpoint) const;
+  bool Load(const CheckpointFile& file);
+
+  // Cubic spline kernel and its derivative, q = distance / h
+  static float f(float q) {
     const auto c = 3.f / 2 / glm::pi<float>();
     if (q < 1) {
       return c * (2.f / 3 - pow(q, 2) + pow(q, 3) / 2);
@@ -38,7 +96,7 @@ private:
     }
   }
 
-  float Df(float q) const {
+  static float Df(float q) {
     const auto c = 3.f / 2 / glm::pi<float>();
     if (q < 1) {
       return c * (-2 * q + pow(q, 2) * 3 / 2);
@@ -49,13 +107,19 @@ private:
     }
   }
 
+private:
+  void InitializeMass();
+
+  // force_[i] from pressure, viscosity and gravity
+  void Force(size_t i);
+
   float W(size_t i, size_t j) const {
-    const auto q = glm::length(system_[i].p - system_[j].p) / h;
+    const auto q = glm::length(system_.P(i) - system_.P(j)) / h;
     return f(q) / pow(h, 3);
   }
 
   glm::vec3 DelW(size_t i, size_t j) const {
-    const auto d = system_[i].p - system_[j].p;
+    const auto d = system_.P(i) - system_.P(j);
     const auto dd = glm::length(d);
     if (dd) {
       return Df(dd / h) * d / dd / float(std::pow(h, 4));
@@ -68,7 +132,7 @@ private:
   auto Value(size_t i, T a) const {
     decltype(a(0)) ret{0.f};
     for (const auto j : search_.neighbors[i]) {
-      ret += system_[j].m / system_[j].rho * a(j) * W(i, j);
+      ret += system_.M(j) / system_.Rho(j) * a(j) * W(i, j);
     }
     return ret;
   }
@@ -77,32 +141,46 @@ private:
   glm::vec3 Grad(size_t i, T a) const {
     glm::vec3 ret{0.f};
     for (const auto j : search_.neighbors[i]) {
-      ret += system_[j].m *
-             (a(i) / float(std::pow(system_[i].rho, 2)) + a(j) / float(std::pow(system_[j].rho, 2))) *
+      ret += system_.M(j) *
+             (a(i) / float(std::pow(system_.Rho(i), 2)) + a(j) / float(std::pow(system_.Rho(j), 2))) *
              DelW(i, j);
     }
-    return system_[i].rho * ret;
+    return system_.Rho(i) * ret;
   }
 
   template <typename T>
   auto Laplace(size_t i, T a) const {
     decltype(a(0)) ret{0.f};
     for (const auto j : search_.neighbors[i]) {
-      const auto x_ij = system_[i].p - system_[j].p;
-      ret += system_[j].m / system_[j].rho * (a(i) - a(j)) *
+      const auto x_ij = system_.P(i) - system_.P(j);
+      ret += system_.M(j) / system_.Rho(j) * (a(i) - a(j)) *
              glm::dot(x_ij, DelW(i, j)) /
              (glm::dot(x_ij, x_ij) + .01f * float(std::pow(h, 2)));
     }
     return 2.f * ret;
   }
 
-  ParticleSystem system_;
+  System system_;
   NeighborSearch search_;
   Integrator integrator_;
+  JobArena jobs_;
 
+  // Per-step scratch, not part of the particle state
   std::vector<float> pressure_;
+  std::vector<glm::vec3> force_;
 
   float h = 0.1f, k = 1119E3f, rho_0 = 1E3f, nu = 1E-2f;
 
   float box_x_ = 1.f, box_z_ = 1.f, box_stiffness_ = 1E5f;
+
+  // Error
+  bool error_ = false;
 };
+
+using SPHSimulator = BasicSPHSimulator<ParticleSystem>;
+
+// fp16 velocity and density
+using CompactSPHSimulator = BasicSPHSimulator<CompactParticleSystem<false>>;
+
+// fp16 velocity and density, fixed-point position
+using FixedSPHSimulator = BasicSPHSimulator<CompactParticleSystem<true>>;
@@ -0,0 +1,29 @@
+#include "Scenes.hpp"
+
+using namespace glm;
+
+bool GetScene(const std::string& name, SPHScene& scene) {
+  scene.min_bound = vec3{-3.f, -3.f, -3.f};
+  scene.max_bound = vec3{5.f, 5.f, 5.f};
+  if (name == "sphere") {
+    // Drops into the box
+    scene.indicator = [](const vec3& x) {
+      return distance(x, vec3(0.f, 1.5f, 0.f)) <= .8f;
+    };
+  } else if (name == "cube") {
+    scene.indicator = [](const vec3& x) {
+      return all(lessThanEqual(abs(x - vec3(0.f, 1.f, 0.f)), vec3(.4f)));
+    };
+  } else if (name == "dam") {
+    // Column against one wall
+    scene.indicator = [](const vec3& x) {
+      return x.x >= -1.f && x.x <= -.4f && x.y >= 0.f && x.y <= 1.f &&
+             abs(x.z) <= 1.f;
+    };
+  } else {
+    return false;
+  }
+  return true;
+}
+
+std::vector<std::string> GetSceneNames() { return {"sphere", "cube", "dam"}; }
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "SPHSimulator.hpp"
+
+struct SPHScene {
+  glm::vec3 min_bound, max_bound;
+  SPHSimulator::ShapeIndicator indicator;
+};
+
+/**
+ * Named initial shapes: sphere, cube, dam
+ * Returns false for unknown names
+ */
+bool GetScene(const std::string& name, SPHScene& scene);
+
+std::vector<std::string> GetSceneNames();
@@ -0,0 +1,149 @@
+#include "SharedFrame.hpp"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <new>
+
+using namespace shared_frame;
+
+namespace {
+size_t HeaderBytes() { return (sizeof(Header) + 63) / 64 * 64; }
+
+std::string ShmName(const std::string& name) {
+  return name.empty() || name[0] == '/' ? name : "/" + name;
+}
+}  // namespace
+
+size_t shared_frame::SlotBytes(size_t capacity) {
+  return (sizeof(Slot) + capacity * sizeof(Particle) + 63) / 64 * 64;
+}
+
+SharedFramePublisher::SharedFramePublisher(const std::string& name,
+                                           size_t capacity,
+                                           const glm::vec3& box)
+    : name_(ShmName(name)) {
+  // A fresh object, never the one a crashed publisher left behind: viewers
+  // still attached to that keep it mapped, resizing it would pull their
+  // pages away
+  shm_unlink(name_.c_str());
+  const auto fd = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+  if (fd < 0) {
+    std::cerr << "Cannot create shared memory " << name_ << std::endl;
+    return;
+  }
+  size_ = HeaderBytes() + kSlots * SlotBytes(capacity);
+  if (ftruncate(fd, off_t(size_)) != 0) {
+    std::cerr << "Cannot resize shared memory " << name_ << std::endl;
+    close(fd);
+    shm_unlink(name_.c_str());
+    return;
+  }
+  data_ = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (data_ == MAP_FAILED) {
+    std::cerr << "Cannot map shared memory " << name_ << std::endl;
+    data_ = nullptr;
+    shm_unlink(name_.c_str());
+    return;
+  }
+
+  auto bytes = static_cast<std::uint8_t*>(data_);
+  for (std::uint32_t i = 0; i < kSlots; ++i) {
+    const auto slot = new (bytes + HeaderBytes() + i * SlotBytes(capacity))
+        Slot{};
+    slot->seq.store(0, std::memory_order_relaxed);
+  }
+  header_ = new (bytes) Header{};
+  header_->slots = kSlots;
+  header_->capacity = std::uint32_t(capacity);
+  header_->box = box;
+  header_->pid = std::int32_t(getpid());
+  header_->latest.store(0, std::memory_order_relaxed);
+  header_->closed.store(false, std::memory_order_relaxed);
+  header_->version = kVersion;
+  // Viewers check magic first, everything above is visible once it matches
+  header_->magic.store(kMagic, std::memory_order_release);
+}
+
+SharedFramePublisher::~SharedFramePublisher() {
+  if (!header_) return;
+  header_->closed.store(true, std::memory_order_release);
+  munmap(data_, size_);
+  // Attached viewers keep their mapping until they detach
+  shm_unlink(name_.c_str());
+}
+
+void SharedFramePublisher::Publish(const ParticleSystem& system) {
+  if (!header_) return;
+  assert(system.Size() <= header_->capacity);
+
+  const auto slot = reinterpret_cast<Slot*>(
+      static_cast<std::uint8_t*>(data_) + HeaderBytes() +
+      (frame_ % header_->slots) * SlotBytes(header_->capacity));
+
+  const auto seq = slot->seq.load(std::memory_order_relaxed);
+  slot->seq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  slot->frame = frame_;
+  slot->count = system.Size();
+  std::memcpy(reinterpret_cast<Particle*>(slot + 1), system.data.data(),
+              system.Size() * sizeof(Particle));
+
+  slot->seq.store(seq + 2, std::memory_order_release);
+  header_->latest.store(frame_ + 1, std::memory_order_release);
+  ++frame_;
+}
+
+SharedFrameViewer::SharedFrameViewer(const std::string& name) {
+  const auto fd = shm_open(ShmName(name).c_str(), O_RDONLY, 0);
+  if (fd < 0) return;  // Not published yet
+  struct stat st {};
+  fstat(fd, &st);
+  size_ = size_t(st.st_size);
+  if (size_ < HeaderBytes()) {
+    close(fd);
+    return;
+  }
+  const auto data = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) return;
+
+  // Nothing else in the header is meaningful before magic matches, a
+  // publisher may still be filling it in
+  const auto header = static_cast<const Header*>(data);
+  if (header->magic.load(std::memory_order_acquire) != kMagic ||
+      header->version != kVersion || header->slots == 0 ||
+      size_ < HeaderBytes() + size_t(header->slots) *
+                                  SlotBytes(header->capacity)) {
+    munmap(data, size_);
+    return;
+  }
+  slots_ = header->slots;
+  capacity_ = header->capacity;
+  data_ = data;
+  header_ = header;
+}
+
+SharedFrameViewer::~SharedFrameViewer() {
+  if (header_) munmap(const_cast<void*>(data_), size_);
+}
+
+bool SharedFrameViewer::Closed() const {
+  if (header_->closed.load(std::memory_order_acquire)) return true;
+  // EPERM still means it runs, as another user
+  return kill(pid_t(header_->pid), 0) != 0 && errno == ESRCH;
+}
+
+const Slot* SharedFrameViewer::GetSlot(size_t i) const {
+  return reinterpret_cast<const Slot*>(static_cast<const std::uint8_t*>(data_) +
+                                       HeaderBytes() +
+                                       i * SlotBytes(capacity_));
+}
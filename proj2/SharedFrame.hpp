@@ -0,0 +1,128 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <string>
+
+#include "ParticleSystem.hpp"
+
+/**
+ * Particle snapshots shared between processes through POSIX shared memory
+ *
+ * The producer cycles through a ring of slots, each guarded by a seqlock, and
+ * never waits for readers. Readers pick the latest complete slot and validate
+ * the sequence number after consuming it, so any number of viewers can attach
+ * or detach at any time.
+ */
+namespace shared_frame {
+constexpr std::uint32_t kMagic = 0x50485346;  // "PHSF"
+constexpr std::uint32_t kVersion = 3;  // Header and particle layout
+constexpr std::uint32_t kSlots = 4;
+
+struct Header {
+  std::atomic<std::uint32_t> magic;  // Stored last, the rest is set once it is
+  std::uint32_t version;
+  std::uint32_t slots, capacity;  // Max particles per slot
+  glm::vec3 box;
+  std::int32_t pid;                   // Publisher, tells a crashed one
+  std::atomic<std::uint64_t> latest;  // Frame number + 1, 0 if none yet
+  std::atomic<bool> closed;           // Publisher has gone away
+};
+
+struct Slot {
+  std::atomic<std::uint64_t> seq;  // Odd while being written
+  std::uint64_t frame;
+  std::uint64_t count;
+  // Followed by capacity particles
+};
+
+size_t SlotBytes(size_t capacity);
+}  // namespace shared_frame
+
+class SharedFramePublisher {
+public:
+  SharedFramePublisher(const std::string& name, size_t capacity,
+                       const glm::vec3& box);
+
+  SharedFramePublisher(const SharedFramePublisher&) = delete;
+  SharedFramePublisher& operator=(const SharedFramePublisher&) = delete;
+
+  ~SharedFramePublisher();
+
+  explicit operator bool() const { return header_ != nullptr; }
+
+  /**
+   * Copy the particles into the next slot, never blocks
+   */
+  void Publish(const ParticleSystem& system);
+
+private:
+  std::string name_;
+  void* data_ = nullptr;
+  size_t size_ = 0;
+  shared_frame::Header* header_ = nullptr;
+  std::uint64_t frame_ = 0;
+};
+
+class SharedFrameViewer {
+public:
+  explicit SharedFrameViewer(const std::string& name);
+
+  SharedFrameViewer(const SharedFrameViewer&) = delete;
+  SharedFrameViewer& operator=(const SharedFrameViewer&) = delete;
+
+  ~SharedFrameViewer();
+
+  explicit operator bool() const { return header_ != nullptr; }
+
+  glm::vec3 GetBox() const { return header_->box; }
+
+  /**
+   * Publisher has gone away, cleanly or by crashing
+   * A new publisher always makes a new segment, reattach to see it.
+   */
+  bool Closed() const;
+
+  /**
+   * Pass the latest complete frame to consume() straight from the mapped
+   * region, retried if the producer overwrote the slot meanwhile
+   * Returns false if there is nothing newer than last_frame (start with -1)
+   */
+  template <typename F>
+  bool ReadLatest(std::uint64_t& last_frame, F consume) const;
+
+private:
+  const shared_frame::Slot* GetSlot(size_t i) const;
+
+  const void* data_ = nullptr;
+  size_t size_ = 0;
+  const shared_frame::Header* header_ = nullptr;
+  // As validated against size_ when attaching, not read from the header again.
+  // slots_ is never 0 once attached.
+  std::uint32_t slots_ = 0, capacity_ = 0;
+};
+
+template <typename F>
+bool SharedFrameViewer::ReadLatest(std::uint64_t& last_frame,
+                                   F consume) const {
+  for (;;) {
+    const auto latest = header_->latest.load(std::memory_order_acquire);
+    if (latest == 0 || latest - 1 == last_frame) return false;
+
+    const auto slot = GetSlot((latest - 1) % slots_);
+    const auto seq = slot->seq.load(std::memory_order_acquire);
+    if (seq & 1 || slot->frame != latest - 1) continue;  // Being rewritten
+    const auto count = slot->count;
+    if (count > capacity_) return false;  // Not written by a publisher
+
+    consume(ParticleView{reinterpret_cast<const Particle*>(slot + 1),
+                         size_t(count)});
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot->seq.load(std::memory_order_relaxed) == seq) {
+      last_frame = latest - 1;
+      return true;
+    }
+  }
+}
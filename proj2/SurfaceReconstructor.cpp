@@ -0,0 +1,303 @@
+#include "SurfaceReconstructor.hpp"
+
+#include <algorithm>
+#include <fstream>
+
+#include "JobSystem.hpp"
+#include "SPHSimulator.hpp"
+
+using namespace glm;
+
+namespace {
+// Freudenthal split of a cube into 6 tetrahedra along the 0-7 diagonal
+// Corner bits: 1 = +x, 2 = +y, 4 = +z
+// Neighboring cubes agree on face diagonals, so the surface is watertight
+const int kTetrahedra[6][4] = {{0, 1, 3, 7}, {0, 1, 5, 7}, {0, 2, 3, 7},
+                               {0, 2, 6, 7}, {0, 4, 5, 7}, {0, 4, 6, 7}};
+
+ivec3 Corner(int c) { return {c & 1, (c >> 1) & 1, (c >> 2) & 1}; }
+
+// 20 bits per coordinate
+std::uint64_t PackCoords(const ivec3& c) {
+  const auto mask = (std::uint64_t(1) << 20) - 1;
+  return (std::uint64_t(c.x + (1 << 19)) & mask) |
+         (std::uint64_t(c.y + (1 << 19)) & mask) << 20 |
+         (std::uint64_t(c.z + (1 << 19)) & mask) << 40;
+}
+
+ivec3 UnpackCoords(std::uint64_t key) {
+  const auto mask = (std::uint64_t(1) << 20) - 1;
+  return ivec3{int(key & mask), int(key >> 20 & mask), int(key >> 40 & mask)} -
+         (1 << 19);
+}
+
+// Edge from node along a direction made of corner bits
+std::uint64_t EdgeKey(const ivec3& node, int dir) {
+  return PackCoords(node) << 3 | std::uint64_t(dir);
+}
+}  // namespace
+
+bool SurfaceMesh::SaveOBJ(const std::string& path) const {
+  std::ofstream file(path);
+  if (!file) return false;
+  for (const auto& v : vertices) {
+    file << "v " << v.p.x << ' ' << v.p.y << ' ' << v.p.z << '\n';
+  }
+  for (const auto& v : vertices) {
+    file << "vn " << v.n.x << ' ' << v.n.y << ' ' << v.n.z << '\n';
+  }
+  for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+    file << "f";
+    for (size_t k = 0; k < 3; ++k) {
+      file << ' ' << indices[i + k] + 1 << "//" << indices[i + k] + 1;
+    }
+    file << '\n';
+  }
+  return bool(file);
+}
+
+const SurfaceMesh& SurfaceReconstructor::Update(const ParticleSystem& system) {
+  if (system.Size() != particles_) {
+    particles_ = system.Size();
+    search_ = NeighborSearch(std::max<size_t>(particles_, 1), 0, 2 * h_);
+  }
+  search_.Rehash(system);
+
+  ActivateBlocks(system);
+
+  auto& jobs = JobSystem::Global();
+  jobs.ParallelFor(active_, 1, [&](size_t begin, size_t end) {
+    for (auto i = begin; i < end; ++i) Sample(blocks_[i], system);
+  });
+  jobs.ParallelFor(active_, 1, [&](size_t begin, size_t end) {
+    for (auto i = begin; i < end; ++i) {
+      ShareBorders(blocks_[i]);
+      Polygonize(blocks_[i]);
+    }
+  });
+
+  Weld();
+  return mesh_;
+}
+
+void SurfaceReconstructor::ActivateBlocks(const ParticleSystem& system) {
+  // Blocks reached by each range of particles, found in parallel. Nearby
+  // particles mostly reach the same blocks, so few keys are left to merge.
+  // One extra cell so every cube crossing the surface has its block active
+  const auto reach = 2 * h_ + cell_;
+  const auto block_size = cell_ * kBlock;
+  reached_.resize((system.Size() + kRange - 1) / kRange);
+  JobSystem::Global().ParallelFor(
+      reached_.size(), 1, [&](size_t begin, size_t end) {
+        for (auto r = begin; r < end; ++r) {
+          auto& keys = reached_[r];
+          keys.clear();
+          const auto last = std::min((r + 1) * kRange, system.Size());
+          for (auto i = r * kRange; i < last; ++i) {
+            const auto lo = ivec3(floor((system[i].p - reach) / block_size));
+            const auto hi = ivec3(floor((system[i].p + reach) / block_size));
+            for (auto b = lo; b.x <= hi.x; ++b.x) {
+              for (b.y = lo.y; b.y <= hi.y; ++b.y) {
+                for (b.z = lo.z; b.z <= hi.z; ++b.z) {
+                  keys.push_back(PackCoords(b));
+                }
+              }
+            }
+          }
+          std::sort(keys.begin(), keys.end());
+          keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+        }
+      });
+
+  // In range order, so blocks come in the same order every run
+  block_index_.clear();
+  active_ = 0;
+  for (const auto& keys : reached_) {
+    for (const auto key : keys) {
+      if (block_index_.emplace(key, active_).second) {
+        if (active_ == blocks_.size()) blocks_.emplace_back();
+        blocks_[active_++].origin = UnpackCoords(key) * kBlock;
+      }
+    }
+  }
+}
+
+void SurfaceReconstructor::Sample(Block& block,
+                                  const ParticleSystem& system) const {
+  block.values.fill(0.f);
+
+  // Gather particles reaching the block, then splat them onto its nodes
+  const auto lo = vec3(block.origin) * cell_;
+  const auto hi = vec3(block.origin + kBlock) * cell_;
+  const auto h3 = h_ * h_ * h_;
+  search_.QueryBox(system, lo - 2 * h_, hi + 2 * h_, [&](size_t n) {
+    const auto& p = system[n].p;
+    const auto first =
+        max(ivec3(ceil((p - 2 * h_) / cell_)) - block.origin, ivec3(0));
+    const auto last = min(ivec3(floor((p + 2 * h_) / cell_)) - block.origin,
+                          ivec3(kBlock - 1));
+    const auto c = system[n].m / system[n].rho / h3;
+    for (auto l = first; l.x <= last.x; ++l.x) {
+      for (l.y = first.y; l.y <= last.y; ++l.y) {
+        for (l.z = first.z; l.z <= last.z; ++l.z) {
+          const auto d = vec3(block.origin + l) * cell_ - p;
+          if (dot(d, d) >= 4 * h_ * h_) continue;  // Outside support
+          block.values[(l.x * kNodes + l.y) * kNodes + l.z] +=
+              c * SPHSimulator::f(length(d) / h_);
+        }
+      }
+    }
+  });
+}
+
+void SurfaceReconstructor::ShareBorders(Block& block) const {
+  // The block above along the axes of each corner bit owns the nodes at
+  // kBlock on those axes. If it is not active no particle reaches them and
+  // they stay 0.
+  const auto coords = block.origin / kBlock;
+  for (int c = 1; c < 8; ++c) {
+    const auto offset = Corner(c);
+    const auto found = block_index_.find(PackCoords(coords + offset));
+    if (found == block_index_.end()) continue;
+    const auto& owner = blocks_[found->second];
+
+    const auto first = offset * kBlock, last = ivec3(kBlock - 1) + offset;
+    for (auto l = first; l.x <= last.x; ++l.x) {
+      for (l.y = first.y; l.y <= last.y; ++l.y) {
+        for (l.z = first.z; l.z <= last.z; ++l.z) {
+          const auto o = l - offset * kBlock;
+          block.values[(l.x * kNodes + l.y) * kNodes + l.z] =
+              owner.values[(o.x * kNodes + o.y) * kNodes + o.z];
+        }
+      }
+    }
+  }
+}
+
+void SurfaceReconstructor::Polygonize(Block& block) const {
+  block.vertices.clear();
+  block.keys.clear();
+  block.triangles.clear();
+  block.edges.clear();
+
+  const auto value = [&](const ivec3& l) {
+    return block.values[(l.x * kNodes + l.y) * kNodes + l.z];
+  };
+
+  // Vertex on the edge between local nodes a and b, a's corner bits inside b's
+  const auto vertex = [&](const ivec3& a, const ivec3& b) {
+    const auto dir = (b.x - a.x) | (b.y - a.y) << 1 | (b.z - a.z) << 2;
+    const auto key = EdgeKey(block.origin + a, dir);
+    const auto found = block.edges.find(key);
+    if (found != block.edges.end()) return found->second;
+
+    const auto va = value(a), vb = value(b);
+    const auto t = clamp((iso_ - va) / (vb - va), 0.f, 1.f);
+    const auto p = (vec3(block.origin + a) + t * vec3(b - a)) * cell_;
+    const auto index = glm::uint(block.vertices.size());
+    block.vertices.push_back(p);
+    block.keys.push_back(key);
+    block.edges.emplace(key, index);
+    return index;
+  };
+
+  // Wind the triangle so its normal points away from the inside point
+  const auto triangle = [&](glm::uint a, glm::uint b, glm::uint c,
+                            const vec3& inside) {
+    const auto& pa = block.vertices[a];
+    const auto n = cross(block.vertices[b] - pa, block.vertices[c] - pa);
+    if (dot(n, pa - inside) < 0) std::swap(b, c);
+    block.triangles.insert(block.triangles.end(), {a, b, c});
+  };
+
+  for (int i = 0; i < kBlock; ++i) {
+    for (int j = 0; j < kBlock; ++j) {
+      for (int k = 0; k < kBlock; ++k) {
+        const auto base = ivec3{i, j, k};
+
+        // Skip cubes entirely inside or outside
+        auto n_inside = 0;
+        for (int c = 0; c < 8; ++c) {
+          n_inside += value(base + Corner(c)) > iso_;
+        }
+        if (n_inside == 0 || n_inside == 8) continue;
+
+        for (const auto& tet : kTetrahedra) {
+          int in[4], out[4], n_in = 0, n_out = 0;
+          for (const auto c : tet) {
+            (value(base + Corner(c)) > iso_ ? in[n_in++] : out[n_out++]) = c;
+          }
+          if (n_in == 0 || n_out == 0) continue;
+
+          // Tetrahedron corners are ordered so lower index is a subset
+          const auto edge = [&](int u, int v) {
+            return u < v ? vertex(base + Corner(u), base + Corner(v))
+                         : vertex(base + Corner(v), base + Corner(u));
+          };
+          const auto position = [&](int c) {
+            return vec3(block.origin + base + Corner(c)) * cell_;
+          };
+
+          if (n_in == 1 || n_out == 1) {
+            // One corner cut off
+            const auto lone = n_in == 1 ? in[0] : out[0];
+            const auto others = n_in == 1 ? out : in;
+            const auto a = edge(lone, others[0]), b = edge(lone, others[1]),
+                       c = edge(lone, others[2]);
+            if (n_in == 1) {
+              triangle(a, b, c, position(lone));
+            } else {
+              triangle(a, b, c,
+                       (position(in[0]) + position(in[1]) + position(in[2])) /
+                           3.f);
+            }
+          } else {
+            // Quad separating two corners from the other two
+            const auto a = edge(in[0], out[0]), b = edge(in[0], out[1]),
+                       c = edge(in[1], out[1]), d = edge(in[1], out[0]);
+            const auto inside = (position(in[0]) + position(in[1])) / 2.f;
+            triangle(a, b, c, inside);
+            triangle(a, c, d, inside);
+          }
+        }
+      }
+    }
+  }
+}
+
+void SurfaceReconstructor::Weld() {
+  mesh_.vertices.clear();
+  mesh_.indices.clear();
+  welded_.clear();
+
+  std::vector<glm::uint> remap;
+  for (size_t b = 0; b < active_; ++b) {
+    const auto& block = blocks_[b];
+    remap.resize(block.vertices.size());
+    for (size_t v = 0; v < block.vertices.size(); ++v) {
+      const auto inserted = welded_.emplace(
+          block.keys[v], glm::uint(mesh_.vertices.size()));
+      if (inserted.second) {
+        mesh_.vertices.push_back({block.vertices[v], vec3{0.f}});
+      }
+      remap[v] = inserted.first->second;
+    }
+    for (const auto t : block.triangles) {
+      mesh_.indices.push_back(remap[t]);
+    }
+  }
+
+  // Area weighted vertex normals
+  for (size_t i = 0; i + 2 < mesh_.indices.size(); i += 3) {
+    auto& a = mesh_.vertices[mesh_.indices[i]];
+    auto& b = mesh_.vertices[mesh_.indices[i + 1]];
+    auto& c = mesh_.vertices[mesh_.indices[i + 2]];
+    const auto n = cross(b.p - a.p, c.p - a.p);
+    a.n += n;
+    b.n += n;
+    c.n += n;
+  }
+  for (auto& v : mesh_.vertices) {
+    if (const auto l = length(v.n); l > 0.f) v.n /= l;
+  }
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "NeighborSearch.hpp"
+#include "ParticleSystem.hpp"
+
+struct SurfaceMesh {
+  struct Vertex {
+    glm::vec3 p, n;
+  };
+
+  bool SaveOBJ(const std::string& path) const;
+
+  std::vector<Vertex> vertices;
+  std::vector<glm::uint> indices;  // Triangles
+};
+
+/**
+ * Fluid surface as the iso-surface of the SPH color field
+ *
+ * The field is sampled only on blocks of cells around particles. Blocks are
+ * sampled and polygonized in parallel, vertices on shared edges are welded
+ * afterwards. A node on the faces between blocks is sampled once, by the
+ * block above it, so neighbors agree on it and the surface does not crack.
+ * Block storage is reused from frame to frame.
+ */
+class SurfaceReconstructor {
+public:
+  SurfaceReconstructor() = default;
+
+  /**
+   * h: smoothing length, cell: grid spacing, iso: level of the color field
+   */
+  SurfaceReconstructor(float h, float cell, float iso = .5f)
+      : h_(h), cell_(cell), iso_(iso) {}
+
+  const SurfaceMesh& Update(const ParticleSystem& system);
+
+  const SurfaceMesh& GetMesh() const { return mesh_; }
+
+  size_t ActiveBlocks() const { return active_; }
+
+private:
+  static constexpr int kBlock = 8;  // Cells per block side
+  static constexpr int kNodes = kBlock + 1;
+  static constexpr size_t kRange = 1024;  // Particles per activation job
+
+  struct Block {
+    glm::ivec3 origin;  // In cells
+    std::array<float, kNodes * kNodes * kNodes> values;
+
+    // Polygonization, vertices indexed locally
+    std::vector<glm::vec3> vertices;
+    std::vector<std::uint64_t> keys;  // Edge of each vertex
+    std::vector<glm::uint> triangles;
+    std::unordered_map<std::uint64_t, glm::uint> edges;
+  };
+
+  /**
+   * Find blocks within the kernel support of any particle
+   */
+  void ActivateBlocks(const ParticleSystem& system);
+
+  /**
+   * Nodes the block owns, all but those on its upper faces
+   */
+  void Sample(Block& block, const ParticleSystem& system) const;
+
+  /**
+   * Copy the upper face nodes from the blocks owning them, once all are
+   * sampled
+   */
+  void ShareBorders(Block& block) const;
+
+  void Polygonize(Block& block) const;
+
+  /**
+   * Merge block outputs into mesh_, sharing vertices on the same edge
+   */
+  void Weld();
+
+  float h_ = .1f, cell_ = .05f, iso_ = .5f;
+
+  NeighborSearch search_;
+  size_t particles_ = 0;
+
+  std::vector<Block> blocks_;  // Pool, the first active_ are in use
+  size_t active_ = 0;
+  std::unordered_map<std::uint64_t, size_t> block_index_;
+  std::vector<std::vector<std::uint64_t>> reached_;  // Blocks per range
+  std::unordered_map<std::uint64_t, glm::uint> welded_;
+
+  SurfaceMesh mesh_;
+};
@@ -0,0 +1,123 @@
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <glm/glm.hpp>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Arguments.hpp"
+#include "FrameCache.hpp"
+#include "SPHSimulator.hpp"
+#include "Scenes.hpp"
+
+using namespace glm;
+
+namespace {
+const auto time_step = 1E-3f;
+
+// Half floats keep 11 significant bits, twice their rounding error passes
+const auto kHalfPrecision = 1.f / 1024.f;
+
+struct Reference {
+  std::vector<vec3> p, v;
+};
+}  // namespace
+
+// Round trip of the frame cache: writes a scene's steps, reads them back
+// and compares them with what was written
+// proj2_cache_check [scene] [steps] [every N steps] [file]
+int main(int argc, char* argv[]) {
+  SPHScene scene;
+  if (!GetScene(argc > 1 ? argv[1] : "sphere", scene)) {
+    std::cerr << "Unknown scene" << std::endl;
+    return EXIT_FAILURE;
+  }
+  unsigned long steps = 200, every = 10;
+  if (!ParseArgument(argc, argv, 2, steps) ||
+      !ParseArgument(argc, argv, 3, every) || every == 0) {
+    std::cerr << "Usage: proj2_cache_check [scene] [steps] [N > 0] [file]"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+  const std::string path = argc > 4 ? argv[4] : "cache_check.bin";
+
+  SPHSimulator simulator(scene.min_bound, scene.max_bound, scene.indicator);
+  const auto box = simulator.GetBox();
+
+  // Every frame handed to the writer, by step; it may drop some
+  std::map<std::uint64_t, Reference> written;
+  size_t dropped;
+  {
+    FrameCacheWriter writer(path, box, every);
+    for (size_t step = 0; step < steps; ++step) {
+      const auto& particles = simulator.GetParticles();
+      writer.Write(particles);
+      if (step % every == 0) {
+        auto& reference = written[step];
+        for (size_t i = 0; i < particles.Size(); ++i) {
+          reference.p.push_back(particles[i].p);
+          reference.v.push_back(particles[i].v);
+        }
+      }
+      simulator.Update(time_step);
+    }
+    dropped = writer.Dropped();
+  }  // Flushes the queue and writes the index
+
+  const FrameCacheReader reader(path);
+  if (!reader) return EXIT_FAILURE;
+  if (reader.Frames() + dropped != written.size()) {
+    std::cerr << "Cache holds " << reader.Frames() << " frames, expected "
+              << written.size() - dropped << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Half a quantum per axis of the writer's padded box
+  const auto margin = .05f * max(box.x, max(box.y, box.z));
+  const auto quantum = (box + vec3{box.x, 0.f, box.z} + 2 * margin) / 65535.f;
+  const auto start = std::chrono::steady_clock::now();
+  auto worst_p = 0.f, worst_v = 0.f;
+  size_t particles = 0;
+  ParticleSystem decoded;
+  for (size_t f = 0; f < reader.Frames(); ++f) {
+    const auto found = written.find(reader.Step(f));
+    if (found == written.end() || !reader.Read(f, decoded) ||
+        decoded.Size() != found->second.p.size()) {
+      std::cerr << "Frame " << f << " of step " << reader.Step(f)
+                << " does not match what was written" << std::endl;
+      return EXIT_FAILURE;
+    }
+    const auto& reference = found->second;
+    for (size_t i = 0; i < decoded.Size(); ++i) {
+      const auto dp = abs(decoded[i].p - reference.p[i]) / (quantum / 2.f);
+      const auto dv = abs(decoded[i].v - reference.v[i]) /
+                      max(abs(reference.v[i]), vec3(1E-4f));
+      worst_p = max(worst_p, max(dp.x, max(dp.y, dp.z)));
+      worst_v = max(worst_v, max(dv.x, max(dv.y, dv.z)));
+    }
+    particles += decoded.Size();
+  }
+  const auto seconds = std::chrono::duration<float>(
+                           std::chrono::steady_clock::now() - start)
+                           .count();
+
+  const auto bytes =
+      std::ifstream(path, std::ios::binary | std::ios::ate).tellg();
+
+  std::cout << reader.Frames() << " frames, " << dropped << " dropped, "
+            << float(bytes) / float(std::max<size_t>(particles, 1))
+            << " bytes/particle, " << particles / seconds / 1E6f
+            << " M particles/s decoded" << std::endl;
+  std::cout << "Worst position error: " << worst_p
+            << " half quanta, worst relative velocity error: " << worst_v
+            << std::endl;
+
+  // A little over half a quantum for the float arithmetic either side
+  if (worst_p > 1.05f || worst_v > kHalfPrecision) {
+    std::cerr << "Decoded frames are off by more than the quantization"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+}
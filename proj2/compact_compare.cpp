@@ -0,0 +1,99 @@
+#include <chrono>
+#include <cmath>
+#include <glm/glm.hpp>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "Arguments.hpp"
+#include "SPHSimulator.hpp"
+#include "Scenes.hpp"
+
+using namespace glm;
+
+namespace {
+const auto time_step = 1E-3f;
+
+struct Timed {
+  template <typename Simulator>
+  void Step(Simulator& simulator) {
+    const auto start = std::chrono::steady_clock::now();
+    simulator.Update(time_step);
+    seconds += std::chrono::duration<float>(std::chrono::steady_clock::now() -
+                                            start)
+                   .count();
+  }
+
+  float seconds = 0.f;
+};
+
+template <typename Simulator>
+void Report(const std::string& name, const Simulator& simulator,
+            const ParticleSystem& reference, float reference_energy,
+            const Timed& timed, size_t steps) {
+  ParticleSystem decoded;
+  simulator.GetParticles().Decode(decoded);
+
+  // Deviation from the full precision run, particles correspond one to one
+  auto sum = 0.f, worst = 0.f;
+  for (size_t i = 0; i < decoded.Size(); ++i) {
+    const auto d = length(decoded[i].p - reference[i].p);
+    sum += d * d;
+    worst = max(worst, d);
+  }
+  const auto energy = simulator.GetKineticEnergy();
+  std::cout << std::setw(8) << name << std::setw(8)
+            << simulator.GetParticles().kBytesPerParticle << std::setw(14)
+            << std::sqrt(sum / float(decoded.Size())) << std::setw(14) << worst
+            << std::setw(14) << simulator.GetDensityError() << std::setw(14)
+            << std::abs(energy - reference_energy) /
+                   std::max(reference_energy, 1E-12f)
+            << std::setw(14) << timed.seconds / float(steps) * 1E3f
+            << std::endl;
+}
+}  // namespace
+
+// Accuracy of the compact particle storage against full precision
+// proj2_compact_compare [scene] [steps] [report every N steps]
+int main(int argc, char* argv[]) {
+  SPHScene scene;
+  if (!GetScene(argc > 1 ? argv[1] : "dam", scene)) {
+    std::cerr << "Unknown scene" << std::endl;
+    return EXIT_FAILURE;
+  }
+  unsigned long steps = 2000, every = 500;
+  if (!ParseArgument(argc, argv, 2, steps) ||
+      !ParseArgument(argc, argv, 3, every) || every == 0) {
+    std::cerr << "Usage: proj2_compact_compare [scene] [steps] [N > 0]"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  SPHSimulator full(scene.min_bound, scene.max_bound, scene.indicator);
+  CompactSPHSimulator compact(scene.min_bound, scene.max_bound,
+                              scene.indicator);
+  FixedSPHSimulator fixed(scene.min_bound, scene.max_bound, scene.indicator);
+  Timed full_time, compact_time, fixed_time;
+
+  for (size_t step = 1; step <= steps; ++step) {
+    full_time.Step(full);
+    compact_time.Step(compact);
+    fixed_time.Step(fixed);
+    if (step % every && step != steps) continue;
+
+    std::cout << "Step " << step << ", full: " << full_time.seconds / step * 1E3f
+              << " ms/step, density error " << full.GetDensityError() << '\n'
+              << std::setw(8) << "storage" << std::setw(8) << "bytes"
+              << std::setw(14) << "rms dx" << std::setw(14) << "max dx"
+              << std::setw(14) << "density err" << std::setw(14) << "energy err"
+              << std::setw(14) << "ms/step" << std::endl;
+    const auto energy = full.GetKineticEnergy();
+    Report("fp16", compact, full.GetParticles(), energy, compact_time, step);
+    Report("fixed", fixed, full.GetParticles(), energy, fixed_time, step);
+  }
+
+  if (compact.GetError() || fixed.GetError()) {
+    std::cerr << "Compact storage blew up" << std::endl;
+    return EXIT_FAILURE;
+  }
+}
@@ -0,0 +1,250 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Arguments.hpp"
+#include "JobSystem.hpp"
+#include "SPHSimulator.hpp"
+#include "Scenes.hpp"
+
+namespace {
+// Swept values of every key, in command line order
+using Sweep = std::vector<std::pair<std::string, std::vector<std::string>>>;
+
+struct Run {
+  std::string shape;
+  SPHSimulator::Parameters params;
+  size_t steps;
+  float dt;
+};
+
+struct Result {
+  size_t particles = 0, steps = 0;
+  float seconds = 0.f;
+  float max_density_error = 0.f, density_error = 0.f;
+  float kinetic_energy = 0.f;
+  bool blown_up = false;
+};
+
+const auto blow_up_density_error = 10.f;
+
+std::vector<std::string> Split(const std::string &s, char delimiter) {
+  std::vector<std::string> tokens;
+  std::stringstream ss(s);
+  for (std::string token; std::getline(ss, token, delimiter);) {
+    if (!token.empty()) tokens.push_back(token);
+  }
+  return tokens;
+}
+
+bool SetValue(Run &run, const std::string &key, const std::string &value) {
+  auto &p = run.params;
+  const std::map<std::string, float *> floats = {
+      {"h", &p.h},         {"k", &p.k},         {"rho_0", &p.rho_0},
+      {"nu", &p.nu},       {"box_x", &p.box_x}, {"box_z", &p.box_z},
+      {"box_stiffness", &p.box_stiffness},      {"dt", &run.dt}};
+  if (const auto found = floats.find(key); found != floats.end()) {
+    float x;
+    if (!ParseNumber(value.c_str(), x)) return false;
+    // Seeding spaces particles by h, and the cost estimate divides by h^3
+    if ((key == "h" || key == "rho_0" || key == "dt") && x <= 0.f) {
+      return false;
+    }
+    *found->second = x;
+  } else if (key == "steps") {
+    unsigned long steps;
+    if (!ParseNumber(value.c_str(), steps) || steps == 0) return false;
+    run.steps = size_t(steps);
+  } else if (key == "shape") {
+    SPHScene scene;
+    if (!GetScene(value, scene)) return false;
+    run.shape = value;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Cartesian product of all swept values
+ */
+bool Expand(const Sweep &sweep, std::vector<Run> &runs) {
+  runs = {Run{"sphere", {}, 1000, 1E-3f}};
+  for (const auto &[key, values] : sweep) {
+    std::vector<Run> expanded;
+    for (const auto &run : runs) {
+      for (const auto &value : values) {
+        auto r = run;
+        if (!SetValue(r, key, value)) {
+          std::cerr << "Invalid " << key << "=" << value << std::endl;
+          return false;
+        }
+        expanded.push_back(r);
+      }
+    }
+    runs = std::move(expanded);
+  }
+  return true;
+}
+
+Result Simulate(const Run &run) {
+  SPHScene scene;
+  GetScene(run.shape, scene);
+  SPHSimulator simulator(scene.min_bound, scene.max_bound, scene.indicator,
+                         run.params);
+  simulator.SetThreads(1);  // Runs are already spread over the pool
+
+  Result result;
+  result.particles = simulator.GetParticles().Size();
+  const auto start = std::chrono::steady_clock::now();
+  for (; result.steps < run.steps; ++result.steps) {
+    simulator.Update(run.dt);
+
+    result.density_error = simulator.GetDensityError();
+    result.max_density_error =
+        std::max(result.max_density_error, result.density_error);
+    if (simulator.GetError() || !std::isfinite(result.density_error) ||
+        result.density_error > blow_up_density_error) {
+      result.blown_up = true;
+      ++result.steps;
+      break;
+    }
+  }
+  result.seconds = std::chrono::duration<float>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+  result.kinetic_energy = simulator.GetKineticEnergy();
+  result.blown_up |= !std::isfinite(result.kinetic_energy);
+  return result;
+}
+
+void WriteCSV(const std::string &path, const std::vector<Run> &runs,
+              const std::vector<Result> &results) {
+  std::ofstream file(path);
+  file << "run,shape,h,k,rho_0,nu,box_x,box_z,box_stiffness,dt,particles,"
+          "steps,seconds,steps_per_s,max_density_error,density_error,"
+          "kinetic_energy,blown_up\n";
+  for (size_t i = 0; i < runs.size(); ++i) {
+    const auto &r = runs[i];
+    const auto &p = r.params;
+    const auto &m = results[i];
+    file << i << ',' << r.shape << ',' << p.h << ',' << p.k << ',' << p.rho_0
+         << ',' << p.nu << ',' << p.box_x << ',' << p.box_z << ','
+         << p.box_stiffness << ',' << r.dt << ',' << m.particles << ','
+         << m.steps << ',' << m.seconds << ',' << m.steps / m.seconds << ','
+         << m.max_density_error << ',' << m.density_error << ','
+         << m.kinetic_energy << ',' << m.blown_up << '\n';
+  }
+}
+
+// Non-finite numbers are not valid JSON
+std::string JSONNumber(float x) {
+  if (!std::isfinite(x)) return "null";
+  std::ostringstream ss;
+  ss << x;
+  return ss.str();
+}
+
+void WriteJSON(const std::string &path, const std::vector<Run> &runs,
+               const std::vector<Result> &results) {
+  std::ofstream file(path);
+  file << "[\n";
+  for (size_t i = 0; i < runs.size(); ++i) {
+    const auto &r = runs[i];
+    const auto &p = r.params;
+    const auto &m = results[i];
+    file << "  {\"run\": " << i << ", \"shape\": \"" << r.shape
+         << "\", \"h\": " << p.h << ", \"k\": " << p.k
+         << ", \"rho_0\": " << p.rho_0 << ", \"nu\": " << p.nu
+         << ", \"box_x\": " << p.box_x << ", \"box_z\": " << p.box_z
+         << ", \"box_stiffness\": " << p.box_stiffness << ", \"dt\": " << r.dt
+         << ", \"particles\": " << m.particles << ", \"steps\": " << m.steps
+         << ", \"seconds\": " << m.seconds
+         << ", \"steps_per_s\": " << JSONNumber(m.steps / m.seconds)
+         << ", \"max_density_error\": " << JSONNumber(m.max_density_error)
+         << ", \"density_error\": " << JSONNumber(m.density_error)
+         << ", \"kinetic_energy\": " << JSONNumber(m.kinetic_energy)
+         << ", \"blown_up\": " << (m.blown_up ? "true" : "false") << "}"
+         << (i + 1 < runs.size() ? "," : "") << "\n";
+  }
+  file << "]\n";
+}
+}  // namespace
+
+// Headless parameter sweep
+// proj2_ensemble [key=v1,v2,...]... [--spec file] [--threads n]
+//                [--csv file] [--json file]
+// Keys: shape, h, k, rho_0, nu, box_x, box_z, box_stiffness, dt, steps
+int main(int argc, char *argv[]) {
+  std::vector<std::string> args(argv + 1, argv + argc);
+  std::string csv = "ensemble.csv", json = "ensemble.json";
+  size_t threads = 0;
+
+  Sweep sweep;
+  for (size_t i = 0; i < args.size(); ++i) {
+    if (args[i] == "--spec" && i + 1 < args.size()) {
+      // Same key=values tokens, separated by whitespace
+      std::ifstream file(args[++i]);
+      if (!file) {
+        std::cerr << "Cannot read " << args[i] << std::endl;
+        return EXIT_FAILURE;
+      }
+      for (std::string token; file >> token;) args.push_back(token);
+    } else if (args[i] == "--threads" && i + 1 < args.size()) {
+      unsigned long n;
+      if (!ParseNumber(args[++i].c_str(), n)) {
+        std::cerr << "Not a number: " << args[i] << std::endl;
+        return EXIT_FAILURE;
+      }
+      threads = size_t(n);
+    } else if (args[i] == "--csv" && i + 1 < args.size()) {
+      csv = args[++i];
+    } else if (args[i] == "--json" && i + 1 < args.size()) {
+      json = args[++i];
+    } else if (const auto eq = args[i].find('='); eq != std::string::npos) {
+      sweep.emplace_back(args[i].substr(0, eq),
+                         Split(args[i].substr(eq + 1), ','));
+    } else {
+      std::cerr << "Unknown argument " << args[i] << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  std::vector<Run> runs;
+  if (!Expand(sweep, runs)) return EXIT_FAILURE;
+  std::cout << "Runs: " << runs.size() << std::endl;
+
+  // Every run is single threaded, one per pool thread
+  // Start the most expensive ones first so the tail stays short
+  std::vector<size_t> order(runs.size());
+  for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+  const auto cost = [&](size_t i) {
+    return runs[i].steps / std::pow(runs[i].params.h, 3.f);
+  };
+  std::stable_sort(order.begin(), order.end(),
+                   [&](size_t a, size_t b) { return cost(a) > cost(b); });
+
+  std::vector<Result> results(runs.size());
+  std::mutex mutex;
+  JobArena(threads).ParallelFor(order.size(), 1, [&](size_t begin, size_t end) {
+    for (auto k = begin; k < end; ++k) {
+      const auto i = order[k];
+      results[i] = Simulate(runs[i]);
+      std::lock_guard<std::mutex> lock(mutex);
+      std::cout << "Run " << i << ": " << results[i].steps << " steps, "
+                << results[i].steps / results[i].seconds << " steps/s"
+                << (results[i].blown_up ? ", blown up" : "") << std::endl;
+    }
+  });
+
+  WriteCSV(csv, runs, results);
+  WriteJSON(json, runs, results);
+}
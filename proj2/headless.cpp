@@ -0,0 +1,103 @@
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <string>
+
+#include "Arguments.hpp"
+#include "HeadlessRunner.hpp"
+#include "SPHSimulator.hpp"
+#include "Scenes.hpp"
+
+namespace {
+const auto time_step = 1E-3f;
+}  // namespace
+
+// Steps a scene as fast as possible, without a window
+// proj2_headless [scene] [steps] [threads]
+// PHYSIM_PERF=1 adds hardware counters of every pass, PHYSIM_METRICS=port
+// serves live metrics, PHYSIM_CHECKPOINT=file writes checkpoints and
+// PHYSIM_RESTORE=file resumes from one.
+int main(int argc, char *argv[]) {
+  std::string name = argc > 1 ? argv[1] : "sphere";
+  unsigned long steps = 1000, threads = 0;
+  if (!ParseArgument(argc, argv, 2, steps) ||
+      !ParseArgument(argc, argv, 3, threads)) {
+    std::cerr << "Usage: proj2_headless [scene] [steps] [threads]"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  HeadlessRunner runner("sph");
+  SPHSimulator simulator;
+  if (const auto restore = HeadlessRunner::RestorePath()) {
+    // Skips seeding and the mass solve
+    if (!runner.Restore(restore, [&](const CheckpointFile &file) {
+          return simulator.Load(file);
+        })) {
+      return EXIT_FAILURE;
+    }
+    name = restore;
+  } else {
+    SPHScene scene;
+    if (!GetScene(name, scene)) {
+      std::cerr << "Unknown scene, one of:";
+      for (const auto &s : GetSceneNames()) std::cerr << ' ' << s;
+      std::cerr << std::endl;
+      return EXIT_FAILURE;
+    }
+    simulator =
+        SPHSimulator(scene.min_bound, scene.max_bound, scene.indicator);
+  }
+  simulator.SetThreads(threads);
+  const auto particles = simulator.GetParticles().Size();
+  std::cout << "Scene: " << name << ", particles: " << particles
+            << ", threads: " << simulator.GetThreads() << std::endl;
+
+  const double items = particles;
+  auto &metrics = runner.GetMetrics();
+  metrics.GetGauge("physim_particles", "Particles or bodies").Set(items);
+  auto &neighbors = metrics.GetGauge("physim_neighbor_pairs", "Neighbor pairs");
+  auto &max_velocity =
+      metrics.GetGauge("physim_max_velocity", "Fastest particle or body");
+  auto &density_error = metrics.GetGauge(
+      "physim_density_error", "Largest relative deviation from rest density");
+
+  // Passes of SPHSimulator::Update()
+  const auto pass = [&](const char *name, const std::function<void()> &f) {
+    runner.Pass(name, "particle", items, f);
+  };
+  const auto taken = runner.Run(
+      steps, time_step,
+      [&] {
+        pass("neighbors", [&] { simulator.UpdateNeighbors(); });
+        pass("density", [&] { simulator.UpdateDensity(); });
+        pass("forces", [&] { simulator.UpdateForces(); });
+        pass("box", [&] { simulator.ApplyBoxPenalty(); });
+        pass("integrate", [&] { simulator.Integrate(time_step); });
+
+        const auto &system = simulator.GetParticles();
+        auto fastest = 0.f;
+        for (size_t i = 0; i < system.Size(); ++i) {
+          fastest = std::max(fastest, glm::length(system.V(i)));
+        }
+        max_velocity.Set(fastest);
+        neighbors.Set(double(simulator.GetNeighborCount()));
+        density_error.Set(simulator.GetDensityError());
+        return simulator.GetError();
+      },
+      [&](Checkpoint &checkpoint) { simulator.Save(checkpoint); });
+  const auto seconds = runner.GetSeconds();
+
+  std::cout << "Steps/s: " << taken / seconds << std::endl
+            << "Particle steps/s: " << particles * taken / seconds
+            << std::endl
+            << "Density error: " << simulator.GetDensityError()
+            << ", kinetic energy: " << simulator.GetKineticEnergy()
+            << std::endl;
+  runner.PrintCounters(std::cout);
+  if (simulator.GetError()) {
+    std::cerr << "Blown up after " << taken << " steps" << std::endl;
+    return EXIT_FAILURE;
+  }
+}
@@ -3,22 +3,50 @@
 #define GLFW_INCLUDE_NONE
 #include <GLFW/glfw3.h>
 
+#include <cstdlib>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <iostream>
+#include <memory>
+#include <string>
 
+#include "Arguments.hpp"
 #include "Axes.hpp"
 #include "Camera.hpp"
+#include "FrameCache.hpp"
 #include "SPHRenderer.hpp"
 #include "SPHSimulator.hpp"
+#include "Scenes.hpp"
+#include "SimulationDriver.hpp"
+#include "SurfaceReconstructor.hpp"
+#include "TripleBuffer.hpp"
 
 namespace {
 Camera camera({2, 2, 2}, {0, 0, 0}, 640, 480);
 SPHRenderer renderer;
+SurfaceReconstructor reconstructor;
+
+// Touched by the simulation thread only, through the driver
 SPHSimulator simulator;
+std::unique_ptr<FrameCacheWriter> cache;
+
+TripleBuffer<ParticleSystem> snapshots;
+std::unique_ptr<SimulationDriver> driver;
 
 const auto time_step = 1E-3f;
 
 auto simulating = false;
+auto surface = false;
+
+void Step(float dt) {
+  simulator.Update(dt);
+  if (cache) cache->Write(simulator.GetParticles());
+}
+
+void Publish() {
+  snapshots.Back() = simulator.GetParticles();
+  snapshots.Publish();
+}
 
 void FramebufferSizeCallback(GLFWwindow *, int width, int height) {
   if (width && height) {
@@ -62,9 +90,16 @@ void KeyCallback(GLFWwindow *window, int key, int scancode, int action,
 
   if (key == GLFW_KEY_SPACE && action == GLFW_PRESS) {
     simulating = !simulating;
+    driver->SetRunning(simulating);
+  }
+  if (key == GLFW_KEY_M && action == GLFW_PRESS) {
+    surface = !surface;
+  }
+  if (key == GLFW_KEY_O && action == GLFW_PRESS) {
+    reconstructor.Update(snapshots.Front()).SaveOBJ("surface.obj");
   }
   if (key == GLFW_KEY_ENTER && action == GLFW_REPEAT) {
-    simulator.Update(time_step);
+    driver->Step();
   }
 }
 
@@ -101,15 +136,29 @@ GLFWwindow *Initialize() {
 
 }  // namespace
 
-int main() {
+int main(int argc, char *argv[]) {
+  // proj2 [cache file] [every N steps]
+  unsigned long every = 1;
+  if (!ParseArgument(argc, argv, 2, every) || every == 0) {
+    std::cerr << "Usage: proj2 [cache file] [every N > 0 steps]" << std::endl;
+    return EXIT_FAILURE;
+  }
+
   const auto window = Initialize();
 
   Axes axes;
-  simulator =
-      SPHSimulator({-3.f, -3.f, -3.f}, {5.f, 5.f, 5.f}, [](const glm::vec3 &x) {
-        return glm::distance(x, glm::vec3(0.f, 1.5f, 0.f)) <= .8f;
-      });
+  SPHScene scene;
+  GetScene("sphere", scene);
+  simulator = SPHSimulator(scene.min_bound, scene.max_bound, scene.indicator);
   renderer = SPHRenderer(simulator.GetParticles(), simulator.GetBox());
+  reconstructor = SurfaceReconstructor(simulator.GetH(), simulator.GetH() / 2);
+  Publish();  // Before the driver starts, which then owns the simulator
+
+  if (argc > 1) {
+    cache =
+        std::make_unique<FrameCacheWriter>(argv[1], simulator.GetBox(), every);
+  }
+  driver = std::make_unique<SimulationDriver>(Step, Publish, time_step);
 
   auto last_time = glfwGetTime();
 
@@ -124,17 +173,23 @@ int main() {
     glPointSize(5.f);
 
     camera.Update(dt);
-    if (simulating) simulator.Update(time_step);
-    renderer.Update(simulator.GetParticles());
+    if (snapshots.Update()) renderer.Update(snapshots.Front());
 
     axes.Draw(camera);
-    renderer.Draw(camera);
+    if (surface) {
+      renderer.UpdateSurface(reconstructor.Update(snapshots.Front()));
+      renderer.DrawSurface(camera);
+    } else {
+      renderer.Draw(camera);
+    }
 
     glfwSwapBuffers(window);
     glfwPollEvents();
   }
 
   // Clean up
+  driver.reset();
+  cache.reset();  // Flush frame index
   glfwDestroyWindow(window);
   glfwTerminate();
 }
\ No newline at end of file
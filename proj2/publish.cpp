@@ -0,0 +1,57 @@
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <glm/glm.hpp>
+#include <iostream>
+#include <string>
+
+#include "SPHSimulator.hpp"
+#include "Scenes.hpp"
+#include "SharedFrame.hpp"
+
+namespace {
+const auto time_step = 1E-3f;
+
+std::atomic<bool> running{true};
+
+void SignalHandler(int) { running = false; }
+}  // namespace
+
+// Headless simulator publishing every step for proj2_view
+// proj2_publish [shared memory name] [scene]
+int main(int argc, char *argv[]) {
+  const std::string name = argc > 1 ? argv[1] : "physim_sph";
+  SPHScene scene;
+  if (!GetScene(argc > 2 ? argv[2] : "sphere", scene)) {
+    std::cerr << "Unknown scene" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  SPHSimulator simulator(scene.min_bound, scene.max_bound, scene.indicator);
+
+  SharedFramePublisher publisher(name, simulator.GetParticles().Size(),
+                                 simulator.GetBox());
+  if (!publisher) {
+    return EXIT_FAILURE;
+  }
+  publisher.Publish(simulator.GetParticles());
+
+  std::signal(SIGINT, SignalHandler);
+  std::signal(SIGTERM, SignalHandler);
+
+  size_t steps = 0;
+  auto last_report = std::chrono::steady_clock::now();
+  while (running) {
+    simulator.Update(time_step);
+    publisher.Publish(simulator.GetParticles());
+    ++steps;
+
+    const auto now = std::chrono::steady_clock::now();
+    const auto elapsed = std::chrono::duration<float>(now - last_report);
+    if (elapsed.count() >= 1.f) {
+      std::cout << "Steps/s: " << steps / elapsed.count() << std::endl;
+      steps = 0;
+      last_report = now;
+    }
+  }
+}
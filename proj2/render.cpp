@@ -0,0 +1,93 @@
+#include <glad/glad.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "Arguments.hpp"
+#include "Axes.hpp"
+#include "Camera.hpp"
+#include "FrameRecorder.hpp"
+#include "OffscreenContext.hpp"
+#include "SPHRenderer.hpp"
+#include "SPHSimulator.hpp"
+#include "Scenes.hpp"
+#include "SurfaceReconstructor.hpp"
+
+namespace {
+const auto time_step = 1E-3f;
+const auto frame_time = 1.f / 60;
+}  // namespace
+
+// Renders a scene to frames at 60 per simulated second, without a window or
+// a display
+// proj2_render [scene] [output] [frames] [surface]
+// output is a pattern like frames/%05d.png or a raw RGBA file, see
+// FrameRecorder. PHYSIM_RENDER_SIZE=WxH sets the frame size.
+int main(int argc, char *argv[]) {
+  const std::string name = argc > 1 ? argv[1] : "sphere";
+  const std::string output = argc > 2 ? argv[2] : "proj2_%05d.png";
+  unsigned long frames = 300;
+  if (!ParseArgument(argc, argv, 3, frames)) {
+    std::cerr << "Usage: proj2_render [scene] [output] [frames] [surface]"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+  const auto surface = argc > 4 && std::string(argv[4]) == "surface";
+  const auto steps_per_frame = int(std::lround(frame_time / time_step));
+
+  SPHScene scene;
+  if (!GetScene(name, scene)) {
+    std::cerr << "Unknown scene, one of:";
+    for (const auto &s : GetSceneNames()) std::cerr << ' ' << s;
+    std::cerr << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  const OffscreenContext context;
+  if (!context) return EXIT_FAILURE;
+  const auto size = FrameRecorder::SizeFromEnvironment();
+
+  SPHSimulator simulator(scene.min_bound, scene.max_bound, scene.indicator);
+  SurfaceReconstructor reconstructor(simulator.GetH(), simulator.GetH() / 2);
+  const Camera camera({2, 2, 2}, {0, 0, 0}, size.x, size.y);
+
+  // GL objects go before the context
+  Axes axes;
+  SPHRenderer renderer(simulator.GetParticles(), simulator.GetBox());
+  FrameRecorder recorder(output, size.x, size.y);
+  if (recorder.GetError()) return EXIT_FAILURE;
+
+  glClearColor(0.f, 0.f, 0.f, 1.f);
+  glEnable(GL_DEPTH_TEST);
+  glPointSize(5.f);
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t frame = 0; frame < frames; ++frame) {
+    for (auto i = 0; i < steps_per_frame && !simulator.GetError(); ++i) {
+      simulator.Update(time_step);
+    }
+
+    recorder.Bind();
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    axes.Draw(camera);
+    if (surface) {
+      renderer.UpdateSurface(reconstructor.Update(simulator.GetParticles()));
+      renderer.DrawSurface(camera);
+    } else {
+      renderer.Update(simulator.GetParticles());
+      renderer.Draw(camera);
+    }
+    recorder.Capture();
+  }
+  recorder.Finish();
+  const auto seconds =
+      std::chrono::duration<float>(std::chrono::steady_clock::now() - start)
+          .count();
+
+  std::cout << "Frames written: " << recorder.Written() << " of " << frames
+            << ", frames/s: " << frames / seconds << std::endl;
+  if (simulator.GetError()) std::cerr << "Blown up" << std::endl;
+  return recorder.GetError() ? EXIT_FAILURE : EXIT_SUCCESS;
+}
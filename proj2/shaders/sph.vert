@@ -2,9 +2,8 @@
 
 layout (location = 0) in vec3 pos;
 layout (location = 1) in vec3 vel;
-layout (location = 2) in vec3 force;
-layout (location = 3) in float mass;
-layout (location = 4) in float density;
+layout (location = 2) in float mass;
+layout (location = 3) in float density;
 
 uniform mat4 projection;
 uniform mat4 view;
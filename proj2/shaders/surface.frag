@@ -0,0 +1,13 @@
+#version 450
+
+in vec3 vPos;
+in vec3 vNormal;
+
+out vec4 fragColor;
+
+void main() {
+    vec3 norm = normalize(vNormal);
+    vec3 light = normalize(vec3(5, 5, 5) - vPos);
+    vec3 color = vec3(0.2, 0.5, 1.0);
+    fragColor = vec4(color * (max(0, dot(light, norm)) + 0.1), 1.0);
+}
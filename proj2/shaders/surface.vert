@@ -0,0 +1,16 @@
+#version 450
+
+layout (location = 0) in vec3 pos;
+layout (location = 1) in vec3 normal;
+
+uniform mat4 projection;
+uniform mat4 view;
+
+out vec3 vPos;
+out vec3 vNormal;
+
+void main() {
+    gl_Position = projection * view * vec4(pos, 1.0);
+    vPos = pos;
+    vNormal = normal;
+}
@@ -0,0 +1,145 @@
+#include <glad/glad.h>
+
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+
+#include <glm/glm.hpp>
+#include <memory>
+#include <string>
+
+#include "Axes.hpp"
+#include "Camera.hpp"
+#include "SPHRenderer.hpp"
+#include "SharedFrame.hpp"
+
+namespace {
+Camera camera({2, 2, 2}, {0, 0, 0}, 640, 480);
+
+void FramebufferSizeCallback(GLFWwindow *, int width, int height) {
+  if (width && height) {
+    glViewport(0, 0, width, height);
+    camera.Resize(width, height);
+  }
+}
+
+void CursorPosCallback(GLFWwindow *, double x, double y) {
+  camera.OnMouseMove(x, y);
+}
+
+void MouseButtonCallback(GLFWwindow *window, int button, int action, int mods) {
+  if (button == GLFW_MOUSE_BUTTON_LEFT) {
+    double x, y;
+    glfwGetCursorPos(window, &x, &y);
+    if (action == GLFW_PRESS) {
+      camera.OnMouseButtonPress(x, y);
+    } else {
+      camera.OnMouseButtonRelease();
+    }
+  }
+}
+
+void KeyCallback(GLFWwindow *window, int key, int scancode, int action,
+                 int mods) {
+  switch (key) {
+  case GLFW_KEY_W:
+    camera.forward_ = action != GLFW_RELEASE;
+    break;
+  case GLFW_KEY_A:
+    camera.left_ = action != GLFW_RELEASE;
+    break;
+  case GLFW_KEY_S:
+    camera.backward_ = action != GLFW_RELEASE;
+    break;
+  case GLFW_KEY_D:
+    camera.right_ = action != GLFW_RELEASE;
+    break;
+  }
+}
+
+GLFWwindow *Initialize() {
+  // GLFW setup
+  if (!glfwInit()) {
+    exit(EXIT_FAILURE);
+  }
+
+  // GLFW window
+  const auto window =
+      glfwCreateWindow(640, 480, "Fluid Dynamics Viewer", nullptr, nullptr);
+  if (!window) {
+    glfwTerminate();
+    exit(EXIT_FAILURE);
+  }
+  glfwSetFramebufferSizeCallback(window, FramebufferSizeCallback);
+  glfwSetCursorPosCallback(window, CursorPosCallback);
+  glfwSetMouseButtonCallback(window, MouseButtonCallback);
+  glfwSetKeyCallback(window, KeyCallback);
+
+  // GL context
+  glfwMakeContextCurrent(window);
+  glfwSwapInterval(1);
+
+  // glad setup
+  if (gladLoadGL() == 0) {
+    glfwTerminate();
+    exit(EXIT_FAILURE);
+  }
+
+  return window;
+}
+
+}  // namespace
+
+// Render the latest frame published by proj2_publish
+// proj2_view [shared memory name]
+int main(int argc, char *argv[]) {
+  const std::string name = argc > 1 ? argv[1] : "physim_sph";
+
+  const auto window = Initialize();
+
+  Axes axes;
+  std::unique_ptr<SharedFrameViewer> viewer;
+  std::unique_ptr<SPHRenderer> renderer;
+  auto frame = std::uint64_t(-1);
+
+  auto last_time = glfwGetTime();
+
+  // Rendering
+  glClearColor(0.f, 0.f, 0.f, 0.f);
+  glEnable(GL_DEPTH_TEST);
+  while (!glfwWindowShouldClose(window)) {
+    const auto dt = glfwGetTime() - last_time;
+    last_time = glfwGetTime();
+
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glPointSize(5.f);
+
+    camera.Update(dt);
+
+    // (Re)attach until the publisher is up, and after it exits or crashes
+    if (!viewer || !*viewer || viewer->Closed()) {
+      viewer = std::make_unique<SharedFrameViewer>(name);
+      renderer.reset();
+      frame = std::uint64_t(-1);
+    }
+    if (*viewer) {
+      viewer->ReadLatest(frame, [&](const ParticleView &particles) {
+        if (!renderer || renderer->Size() != particles.size()) {
+          renderer = std::make_unique<SPHRenderer>(particles, viewer->GetBox());
+        } else {
+          renderer->Update(particles);
+        }
+      });
+    }
+
+    axes.Draw(camera);
+    if (renderer) renderer->Draw(camera);
+
+    glfwSwapBuffers(window);
+    glfwPollEvents();
+  }
+
+  // Clean up
+  renderer.reset();
+  glfwDestroyWindow(window);
+  glfwTerminate();
+}
@@ -0,0 +1,121 @@
+#include "Broadphase.hpp"
+
+#include <algorithm>
+#include <cfloat>
+
+using namespace glm;
+
+namespace {
+const int kMaxSlabs = 64;
+}
+
+const std::vector<Broadphase::Pair>& Broadphase::Update(
+    const std::vector<AABB>& boxes) {
+  if (entries_.size() != boxes.size()) {
+    Rebuild(boxes);
+  } else {
+    for (auto& e : entries_) e.box = boxes[e.id];
+  }
+
+  // Order from last step is nearly sorted
+  for (size_t i = 1; i < entries_.size(); ++i) {
+    const auto e = entries_[i];
+    auto j = i;
+    for (; j > 0 && entries_[j - 1].box.lo[axis_] > e.box.lo[axis_]; --j) {
+      entries_[j] = entries_[j - 1];
+    }
+    entries_[j] = e;
+  }
+
+  // Slabs across a second axis, so a box is only swept against boxes near it
+  // in both. Each slab is a subsequence of the sorted order.
+  const auto u = (axis_ + 1) % 3, v = (axis_ + 2) % 3;
+  auto v_min = FLT_MAX, v_max = -FLT_MAX, v_size = 0.f;
+  for (const auto& e : entries_) {
+    v_min = std::min(v_min, e.box.lo[v]);
+    v_max = std::max(v_max, e.box.hi[v]);
+    v_size += e.box.hi[v] - e.box.lo[v];
+  }
+  v_size /= float(std::max<size_t>(entries_.size(), 1));
+  const auto slabs =
+      v_size > 0.f
+          ? std::clamp(int((v_max - v_min) / (4.f * v_size)), 1, kMaxSlabs)
+          : 1;
+  const auto width = (v_max - v_min) / float(slabs);
+  const auto slab = [&](float x) {
+    return width > 0.f ? std::clamp(int((x - v_min) / width), 0, slabs - 1)
+                       : 0;
+  };
+
+  slab_start_.assign(slabs + 1, 0);
+  for (const auto& e : entries_) {
+    for (auto s = slab(e.box.lo[v]); s <= slab(e.box.hi[v]); ++s) {
+      ++slab_start_[s + 1];
+    }
+  }
+  for (int s = 0; s < slabs; ++s) slab_start_[s + 1] += slab_start_[s];
+
+  // Bounds per slab, one array per axis and side for the inner loop
+  const auto total = slab_start_[slabs];
+  for (int a = 0; a < 3; ++a) {
+    lo_[a].resize(total);
+    hi_[a].resize(total);
+  }
+  ids_.resize(total);
+  fill_ = slab_start_;
+  for (const auto& e : entries_) {
+    for (auto s = slab(e.box.lo[v]); s <= slab(e.box.hi[v]); ++s) {
+      const auto k = fill_[s]++;
+      for (int a = 0; a < 3; ++a) {
+        lo_[a][k] = e.box.lo[a];
+        hi_[a][k] = e.box.hi[a];
+      }
+      ids_[k] = e.id;
+    }
+  }
+
+  const auto &lo = lo_[axis_], &lo_u = lo_[u], &hi_u = hi_[u], &lo_v = lo_[v],
+             &hi_v = hi_[v];
+  pairs_.clear();
+  for (int s = 0; s < slabs; ++s) {
+    const auto end = slab_start_[s + 1];
+    for (auto i = slab_start_[s]; i < end; ++i) {
+      const auto hi = hi_[axis_][i];
+      for (auto j = i + 1; j < end && lo[j] <= hi; ++j) {
+        // Non-short-circuit, overlaps are rare among the candidates
+        if ((lo_u[j] <= hi_u[i]) & (lo_u[i] <= hi_u[j]) &
+            (lo_v[j] <= hi_v[i]) & (lo_v[i] <= hi_v[j]) &&
+            slab(std::max(lo_v[i], lo_v[j])) == s) {  // Report once
+          const auto a = ids_[i], b = ids_[j];
+          pairs_.emplace_back(std::min(a, b), std::max(a, b));
+        }
+      }
+    }
+  }
+  // Independent of the sort order, so the solver sees pairs deterministically
+  std::sort(pairs_.begin(), pairs_.end());
+  return pairs_;
+}
+
+void Broadphase::Rebuild(const std::vector<AABB>& boxes) {
+  vec3 sum{0.f}, sum2{0.f};
+  for (const auto& b : boxes) {
+    const auto c = (b.lo + b.hi) / 2.f;
+    sum += c;
+    sum2 += c * c;
+  }
+  const auto n = float(std::max<size_t>(boxes.size(), 1));
+  const auto variance = sum2 / n - sum * sum / (n * n);
+  axis_ = variance.x >= variance.y && variance.x >= variance.z
+              ? 0
+              : (variance.y >= variance.z ? 1 : 2);
+
+  entries_.resize(boxes.size());
+  for (size_t i = 0; i < boxes.size(); ++i) {
+    entries_[i] = {boxes[i], std::uint32_t(i)};
+  }
+  std::sort(entries_.begin(), entries_.end(),
+            [this](const Entry& a, const Entry& b) {
+              return a.box.lo[axis_] < b.box.lo[axis_];
+            });
+}
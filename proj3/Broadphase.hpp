@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <utility>
+#include <vector>
+
+struct AABB {
+  glm::vec3 lo, hi;
+
+  bool Overlaps(const AABB& o) const {
+    return glm::all(glm::lessThanEqual(lo, o.hi)) &&
+           glm::all(glm::lessThanEqual(o.lo, hi));
+  }
+};
+
+/**
+ * Sweep and prune over AABBs sorted along one axis
+ *
+ * The sorted order is kept between steps and repaired with insertion sort,
+ * which is close to linear since bodies move little per step. Boxes are then
+ * split into slabs along a second axis and each slab is swept on its own, so
+ * the candidates of a box are only those near it on both axes.
+ */
+class Broadphase {
+public:
+  using Pair = std::pair<std::uint32_t, std::uint32_t>;
+
+  /**
+   * Pairs (i, j), i < j, of overlapping boxes, in ascending order
+   */
+  const std::vector<Pair>& Update(const std::vector<AABB>& boxes);
+
+  const std::vector<Pair>& GetPairs() const { return pairs_; }
+
+  int GetAxis() const { return axis_; }
+
+private:
+  struct Entry {
+    AABB box;
+    std::uint32_t id;
+  };
+
+  /**
+   * Sort along the axis where boxes are most spread out
+   */
+  void Rebuild(const std::vector<AABB>& boxes);
+
+  int axis_ = 0;
+  std::vector<Entry> entries_;  // Sorted by box.lo[axis_]
+
+  // Per slab copies of the bounds, slab s in [slab_start_[s], slab_start_[s+1])
+  std::vector<size_t> slab_start_, fill_;
+  std::vector<float> lo_[3], hi_[3];
+  std::vector<std::uint32_t> ids_;
+  std::vector<Pair> pairs_;
+};
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <limits>
+
+struct Contact {
+  glm::vec3 p;        // Midway between the surfaces
+  float depth;        // Penetration, negative while still separated
+  std::uint64_t id;   // Pair of features, stable across steps
+
+  // Accumulated impulses, carried over to warm start the next step
+  float j_n = 0.f;
+  glm::vec2 j_t{0.f};
+};
+
+/**
+ * Up to 4 contacts sharing one normal
+ */
+struct Manifold {
+  static constexpr std::uint32_t kGround =
+      std::numeric_limits<std::uint32_t>::max();
+
+  std::uint64_t Key() const { return std::uint64_t(a) << 32 | b; }
+
+  std::uint32_t a, b;  // Bodies, b is kGround for the y = 0 plane
+  glm::vec3 n;         // Unit normal from a to b
+  int count = 0;
+  std::array<Contact, 4> contacts;
+};
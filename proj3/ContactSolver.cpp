@@ -0,0 +1,272 @@
+#include "ContactSolver.hpp"
+
+#include <algorithm>
+
+using namespace glm;
+
+namespace {
+const auto kColors = 64;  // Manifolds left over are solved serially last
+
+// Work per task, bodies plus constraint updates
+const size_t kBatchWork = 512;
+const size_t kColorGrain = 64;  // Manifolds
+
+// Orthonormal tangents depending only on the normal, so accumulated friction
+// stays meaningful from step to step
+void Tangents(const vec3& n, vec3 (&t)[2]) {
+  t[0] = std::abs(n.x) >= .57735f ? normalize(vec3{n.y, -n.x, 0.f})
+                                  : normalize(vec3{0.f, n.z, -n.y});
+  t[1] = cross(n, t[0]);
+}
+
+int LowestClear(std::uint64_t bits) {
+  for (int i = 0; i < kColors; ++i) {
+    if (!(bits >> i & 1)) return i;
+  }
+  return kColors;
+}
+}  // namespace
+
+void ContactSolver::Solve(std::vector<RigidBody>& bodies,
+                          std::vector<Manifold>& manifolds,
+                          const Islands& islands, float dt, const JobArena& jobs) {
+  Group(bodies, manifolds, islands);
+
+  // Small islands are prepared and solved in batches of neighbors, large
+  // ones are only prepared here
+  const auto large = [&](size_t k) {
+    return first_[island_start_[k + 1]] - first_[island_start_[k]] >
+           color_threshold_;
+  };
+  jobs.ParallelFor(batches_.size() - 1, 1, [&](size_t first, size_t last) {
+    for (auto k = batches_[first]; k < batches_[last]; ++k) {
+      if (!bodies[*islands.begin(k)].IsAwake()) continue;
+      Prepare(bodies, manifolds, islands, k, dt);
+      if (large(k)) continue;
+      SolveIsland(k);
+      Store(bodies, islands, k);
+    }
+  });
+
+  for (size_t k = 0; k < islands.Count(); ++k) {
+    if (!bodies[*islands.begin(k)].IsAwake() || !large(k)) continue;
+    Color(manifolds, islands, k);
+    SolveColored(k, jobs);
+    Store(bodies, islands, k);
+  }
+}
+
+void ContactSolver::Group(const std::vector<RigidBody>& bodies,
+                          const std::vector<Manifold>& manifolds,
+                          const Islands& islands) {
+  // Counting sort, manifolds stay in key order within an island
+  island_start_.assign(islands.Count() + 1, 0);
+  for (const auto& m : manifolds) {
+    // After waking, a asleep means b is too or is the ground
+    if (bodies[m.a].IsAwake()) ++island_start_[islands.GetIsland(m.a) + 1];
+  }
+  for (size_t k = 0; k < islands.Count(); ++k) {
+    island_start_[k + 1] += island_start_[k];
+  }
+  order_.resize(island_start_.back());
+  auto fill = island_start_;
+  for (std::uint32_t i = 0; i < manifolds.size(); ++i) {
+    const auto a = manifolds[i].a;
+    if (bodies[a].IsAwake()) order_[fill[islands.GetIsland(a)]++] = i;
+  }
+
+  first_.resize(order_.size() + 1);
+  first_[0] = 0;
+  for (size_t k = 0; k < order_.size(); ++k) {
+    first_[k + 1] = first_[k] + manifolds[order_[k]].count;
+  }
+  constraints_.resize(first_.back());
+  velocities_.resize(bodies.size() + 1);
+  velocities_.back() = {vec3{0.f}, vec3{0.f}, mat3{0.f}, 0.f};
+
+  // Consecutive islands until there is enough work for a task
+  batches_.assign(1, 0);
+  size_t work = 0;
+  for (std::uint32_t k = 0; k < islands.Count(); ++k) {
+    work += size_t(islands.end(k) - islands.begin(k)) +
+            iterations_ * (first_[island_start_[k + 1]] -
+                           first_[island_start_[k]]);
+    if (work >= kBatchWork) {
+      batches_.push_back(k + 1);
+      work = 0;
+    }
+  }
+  if (batches_.back() != islands.Count()) {
+    batches_.push_back(std::uint32_t(islands.Count()));
+  }
+}
+
+void ContactSolver::Prepare(const std::vector<RigidBody>& bodies,
+                            std::vector<Manifold>& manifolds,
+                            const Islands& islands, size_t island, float dt) {
+  for (auto i = islands.begin(island); i != islands.end(island); ++i) {
+    const auto& rb = bodies[*i];
+    velocities_[*i] = {rb.GetLinearVelocity(), rb.GetAngularVelocity(),
+                       rb.GetInverseInertia(), rb.GetInverseMass()};
+  }
+  const auto ground = std::uint32_t(bodies.size());
+
+  for (auto k = island_start_[island]; k < island_start_[island + 1]; ++k) {
+    auto& m = manifolds[order_[k]];
+    const auto b = m.b == Manifold::kGround ? ground : m.b;
+    const auto& va = velocities_[m.a];
+    const auto& vb = velocities_[b];
+    const auto c_a = bodies[m.a].GetCenter();
+    const auto c_b = b == ground ? vec3{0.f} : bodies[b].GetCenter();
+
+    for (int i = 0; i < m.count; ++i) {
+      auto& contact = m.contacts[i];
+      auto& c = constraints_[first_[k] + i];
+      c.contact = &contact;
+      c.a = m.a;
+      c.b = b;
+      c.r_a = contact.p - c_a;
+      c.r_b = contact.p - c_b;
+      c.n = m.n;
+      Tangents(c.n, c.t);
+
+      // Inverse effective mass along a direction
+      const auto k = [&](const vec3& d) {
+        return va.inv_m + vb.inv_m +
+               dot(cross(va.inv_I * cross(c.r_a, d), c.r_a) +
+                       cross(vb.inv_I * cross(c.r_b, d), c.r_b),
+                   d);
+      };
+      c.mass_n = 1 / k(c.n);
+      c.mass_t[0] = 1 / k(c.t[0]);
+      c.mass_t[1] = 1 / k(c.t[1]);
+
+      // Speculative contacts may close their gap within the step, penetration
+      // beyond the slop is pushed out
+      c.bias = contact.depth < 0
+                   ? contact.depth / dt
+                   : baumgarte_ / dt * std::max(contact.depth - slop_, 0.f);
+      // Bounce off with the approaching velocity before any impulse
+      const auto v_n = dot(RelativeVelocity(c), c.n);
+      if (v_n < -bounce_threshold_) c.bias = std::max(c.bias, -eps_ * v_n);
+    }
+  }
+
+  // After all biases, which need the velocities before any impulse
+  const auto begin = first_[island_start_[island]],
+             end = first_[island_start_[island + 1]];
+  for (auto i = begin; i < end; ++i) {
+    const auto& c = constraints_[i];
+    auto& contact = *c.contact;
+    if (warm_start_) {
+      Apply(c, contact.j_n * c.n + contact.j_t[0] * c.t[0] +
+                   contact.j_t[1] * c.t[1]);
+    } else {
+      contact.j_n = 0.f;
+      contact.j_t = vec2{0.f};
+    }
+  }
+}
+
+void ContactSolver::Color(const std::vector<Manifold>& manifolds,
+                          const Islands& islands, size_t island) {
+  used_.resize(velocities_.size());
+  for (auto i = islands.begin(island); i != islands.end(island); ++i) {
+    used_[*i] = 0;
+  }
+
+  // The ground never changes velocity, so it doesn't take colors
+  const auto begin = island_start_[island], end = island_start_[island + 1];
+  std::vector<std::uint8_t> color(end - begin);
+  color_start_.assign(kColors + 2, 0);
+  for (auto k = begin; k < end; ++k) {
+    const auto& m = manifolds[order_[k]];
+    auto taken = used_[m.a];
+    if (m.b != Manifold::kGround) taken |= used_[m.b];
+    const auto c = LowestClear(taken);
+    if (c < kColors) {
+      used_[m.a] |= std::uint64_t(1) << c;
+      if (m.b != Manifold::kGround) used_[m.b] |= std::uint64_t(1) << c;
+    }
+    color[k - begin] = std::uint8_t(c);
+    ++color_start_[c + 1];
+  }
+  for (int c = 0; c <= kColors; ++c) color_start_[c + 1] += color_start_[c];
+
+  colored_.resize(end - begin);
+  auto fill = color_start_;
+  for (auto k = begin; k < end; ++k) colored_[fill[color[k - begin]]++] = k;
+}
+
+void ContactSolver::SolveIsland(size_t island) {
+  for (int iteration = 0; iteration < iterations_; ++iteration) {
+    SolveManifolds(island_start_[island], island_start_[island + 1]);
+  }
+}
+
+void ContactSolver::SolveColored(size_t island, const JobArena& jobs) {
+  for (int iteration = 0; iteration < iterations_; ++iteration) {
+    for (int c = 0; c <= kColors; ++c) {
+      const auto begin = color_start_[c], end = color_start_[c + 1];
+      if (begin == end) continue;
+      // Left over manifolds may share bodies
+      const auto grain = c < kColors ? kColorGrain : end - begin;
+      jobs.ParallelFor(end - begin, grain, [&](size_t first, size_t last) {
+        for (auto i = begin + first; i < begin + last; ++i) {
+          SolveManifolds(colored_[i], colored_[i] + 1);
+        }
+      });
+    }
+  }
+}
+
+void ContactSolver::SolveManifolds(size_t begin, size_t end) {
+  for (auto i = first_[begin]; i < first_[end]; ++i) {
+    SolveConstraint(constraints_[i]);
+  }
+}
+
+void ContactSolver::SolveConstraint(const Constraint& c) {
+  auto& contact = *c.contact;
+
+  // Friction first, bounded by the current normal impulse
+  for (int k = 0; k < 2; ++k) {
+    const auto v_t = dot(RelativeVelocity(c), c.t[k]);
+    const auto max_friction = mu_ * contact.j_n;
+    const auto j_t = clamp(contact.j_t[k] - c.mass_t[k] * v_t, -max_friction,
+                           max_friction);
+    Apply(c, (j_t - contact.j_t[k]) * c.t[k]);
+    contact.j_t[k] = j_t;
+  }
+
+  const auto v_n = dot(RelativeVelocity(c), c.n);
+  const auto j_n = max(contact.j_n + c.mass_n * (c.bias - v_n), 0.f);
+  Apply(c, (j_n - contact.j_n) * c.n);
+  contact.j_n = j_n;
+}
+
+void ContactSolver::Store(std::vector<RigidBody>& bodies, const Islands& islands,
+                          size_t island) const {
+  for (auto i = islands.begin(island); i != islands.end(island); ++i) {
+    bodies[*i].SetVelocity(velocities_[*i].v, velocities_[*i].w);
+  }
+}
+
+void ContactSolver::Apply(const Constraint& c, const vec3& j) {
+  // b gets j, a the opposite
+  auto& a = velocities_[c.a];
+  a.v -= a.inv_m * j;
+  a.w -= a.inv_I * cross(c.r_a, j);
+  // The ground is shared by all islands, so it is never written
+  if (c.b + 1 == velocities_.size()) return;
+  auto& b = velocities_[c.b];
+  b.v += b.inv_m * j;
+  b.w += b.inv_I * cross(c.r_b, j);
+}
+
+vec3 ContactSolver::RelativeVelocity(const Constraint& c) const {
+  // Of b relative to a, positive along n when separating
+  const auto& a = velocities_[c.a];
+  const auto& b = velocities_[c.b];
+  return b.v + cross(b.w, c.r_b) - a.v - cross(a.w, c.r_a);
+}
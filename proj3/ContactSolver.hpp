@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "Contact.hpp"
+#include "Islands.hpp"
+#include "RigidBody.hpp"
+#include "JobSystem.hpp"
+
+/**
+ * Sequential impulses (projected Gauss-Seidel) over all contacts of a step
+ *
+ * Impulses are accumulated per contact and clamped as a whole, normal to be
+ * non-negative and friction to the friction pyramid. They start from the
+ * previous step's values carried by the manifolds. Penetration is corrected
+ * with a Baumgarte bias beyond a small slop.
+ *
+ * Islands share no body, so each is solved as a task of its own. Islands
+ * with more than color_threshold_ contacts are further split by coloring
+ * their manifolds so no two of one color share a body, and the colors are
+ * solved one after another, each in parallel. The order of updates depends
+ * only on the contacts and never on the pool, so results are identical for
+ * any number of threads.
+ */
+class ContactSolver {
+public:
+  /**
+   * Velocities of the bodies after forces, impulses are written back into
+   * the manifolds. Contacts of asleep bodies are skipped.
+   */
+  void Solve(std::vector<RigidBody>& bodies, std::vector<Manifold>& manifolds,
+             const Islands& islands, float dt, const JobArena& jobs);
+
+  int iterations_ = 10;
+  bool warm_start_ = true;
+  float eps_{.5f}, mu_{.5f};  // Restitution and friction
+
+  float baumgarte_ = .2f, slop_ = .005f;
+  float bounce_threshold_ = .5f;  // No restitution below this speed
+
+  size_t color_threshold_ = 1024;
+
+private:
+  struct Velocity {
+    glm::vec3 v, w;
+    glm::mat3 inv_I;
+    float inv_m;
+  };
+
+  struct Constraint {
+    Contact* contact;
+    std::uint32_t a, b;
+    glm::vec3 r_a, r_b;
+    glm::vec3 n, t[2];
+    float mass_n, mass_t[2];
+    float bias;  // Target separating velocity
+  };
+
+  /**
+   * Awake manifolds by island, and where their constraints go
+   */
+  void Group(const std::vector<RigidBody>& bodies,
+             const std::vector<Manifold>& manifolds, const Islands& islands);
+
+  void Prepare(const std::vector<RigidBody>& bodies,
+               std::vector<Manifold>& manifolds, const Islands& islands,
+               size_t island, float dt);
+
+  /**
+   * Greedy coloring of the island's manifolds, into colored_
+   */
+  void Color(const std::vector<Manifold>& manifolds, const Islands& islands,
+             size_t island);
+
+  void SolveIsland(size_t island);
+
+  void SolveColored(size_t island, const JobArena& jobs);
+
+  /**
+   * One pass over the constraints of order_[begin, end)
+   */
+  void SolveManifolds(size_t begin, size_t end);
+
+  void SolveConstraint(const Constraint& c);
+
+  void Store(std::vector<RigidBody>& bodies, const Islands& islands,
+             size_t island) const;
+
+  void Apply(const Constraint& c, const glm::vec3& j);
+
+  glm::vec3 RelativeVelocity(const Constraint& c) const;
+
+  std::vector<Velocity> velocities_;  // Last one is the ground
+  std::vector<Constraint> constraints_;
+
+  std::vector<std::uint32_t> order_;       // Manifolds grouped by island
+  std::vector<std::uint32_t> island_start_;  // Of each island in order_
+  std::vector<std::uint32_t> first_;       // Constraint of each in order_
+  std::vector<std::uint32_t> batches_;     // Of small islands, by island
+
+  // Of the large island being solved, indices into order_ by color
+  std::vector<std::uint32_t> colored_, color_start_;
+  std::vector<std::uint64_t> used_;  // Colors taken, per body
+};
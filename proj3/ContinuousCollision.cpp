@@ -0,0 +1,68 @@
+#include "ContinuousCollision.hpp"
+
+#include <glm/gtc/quaternion.hpp>
+
+using namespace glm;
+
+namespace {
+const auto kMaxIterations = 32;
+
+float Radius(const OBB& box) { return length(box.e); }
+
+float GroundDistance(const OBB& box) {
+  return box.c.y - dot(abs(vec3(box.R[0].y, box.R[1].y, box.R[2].y)), box.e);
+}
+
+/**
+ * Advance while distance(t) > target, distance(t) decreasing at most speed
+ */
+template <typename Distance>
+float Advance(Distance distance, float speed, float dt, float target) {
+  // Close enough to count as contact, must stay within the contact margin
+  const auto tolerance = target / 2;
+  auto d = distance(0.f);
+  if (d <= target + tolerance) return dt;
+  if (speed * dt <= d - target) return dt;
+
+  auto t = 0.f;
+  for (int i = 0; i < kMaxIterations; ++i) {
+    t += (d - target) / speed;
+    if (t >= dt) return dt;
+    d = distance(t);
+    if (d <= target + tolerance) return t;
+  }
+  // Not converged, the pose at t is still known to be separated
+  return t;
+}
+}  // namespace
+
+OBB Sweep::At(float t) const {
+  auto moved = box;
+  moved.c += v * t;
+  const auto angle = length(w) * t;
+  if (angle != 0.f) moved.R = mat3_cast(angleAxis(angle, normalize(w))) * box.R;
+  return moved;
+}
+
+float Sweep::Speed() const { return length(v) + length(w) * Radius(box); }
+
+AABB Sweep::Bounds(float dt) const {
+  // Rotation moves a point by at most the arc |w| dt r, or the diameter
+  const auto start = box.Bounds();
+  const auto arc = vec3(min(length(w) * dt, 2.f) * Radius(box));
+  return {start.lo + min(v * dt, 0.f) - arc, start.hi + max(v * dt, 0.f) + arc};
+}
+
+float TimeOfImpact(const Sweep& a, const Sweep& b, float dt, float target) {
+  const auto speed = length(a.v - b.v) + length(a.w) * Radius(a.box) +
+                     length(b.w) * Radius(b.box);
+  return Advance([&](float t) { return Separation(a.At(t), b.At(t)); }, speed,
+                 dt, target);
+}
+
+float TimeOfImpactGround(const Sweep& a, float dt, float target) {
+  const auto speed = max(-a.v.y, 0.f) + length(a.w) * Radius(a.box);
+  if (speed == 0.f) return dt;
+  return Advance([&](float t) { return GroundDistance(a.At(t)); }, speed, dt,
+                 target);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "Broadphase.hpp"
+#include "Narrowphase.hpp"
+
+/**
+ * Box moving over one step with constant linear and angular velocity
+ */
+struct Sweep {
+  OBB At(float t) const;
+
+  /**
+   * Bound on the speed of any point of the box
+   */
+  float Speed() const;
+
+  /**
+   * Bounds of the box over [0, dt]
+   */
+  AABB Bounds(float dt) const;
+
+  OBB box;  // At t = 0
+  glm::vec3 v, w;
+};
+
+/**
+ * First time in [0, dt] at which the boxes come within target by
+ * conservative advancement, dt if they don't
+ * Each iteration advances by the SAT separation, a lower bound on the
+ * distance, over the bound on the closing speed, so contact is never
+ * skipped. Boxes already within target at t = 0 are left to the solver.
+ */
+float TimeOfImpact(const Sweep& a, const Sweep& b, float dt, float target);
+
+/**
+ * Same against the y = 0 ground
+ */
+float TimeOfImpactGround(const Sweep& a, float dt, float target);
@@ -0,0 +1,560 @@
+#include "ConvexCollision.hpp"
+
+#include <algorithm>
+#include <cfloat>
+
+#include "Narrowphase.hpp"
+
+using namespace glm;
+
+namespace {
+const auto kMaxIterations = 32;
+// GJK stops once a step gains less than this fraction of the distance
+const auto kRelativeTolerance = 1E-4f;
+// Closer than this counts as touching, EPA takes over
+const auto kOverlap = 1E-5f;
+
+// EPA polytope limits, it stops with the best face so far when full
+const auto kMaxPolytopeVertices = 64, kMaxPolytopeFaces = 128;
+const auto kEpaTolerance = 1E-4f;
+
+// Faces are clipped only when this aligned with the normal, as for boxes
+const auto kFaceAlignment = .95f;
+const auto kMaxPolygon = 64;  // Vertices of a face, the rest are dropped
+
+struct SimplexVertex {
+  vec3 a, b, w;  // w = a - b
+  std::uint32_t ia, ib;
+};
+
+SimplexVertex MakeVertex(const ConvexShape& a, const ConvexShape& b,
+                         std::uint32_t ia, std::uint32_t ib) {
+  const auto pa = a.Vertex(ia), pb = b.Vertex(ib);
+  return {pa, pb, pa - pb, ia, ib};
+}
+
+struct Simplex {
+  SimplexVertex v[4];
+  float lambda[4];  // Barycentric coordinates of the closest point
+  int count = 0;
+
+  void Keep(std::initializer_list<std::pair<int, float>> kept) {
+    SimplexVertex v_kept[4];
+    auto n = 0;
+    for (const auto& [i, l] : kept) {
+      v_kept[n] = v[i];
+      lambda[n++] = l;
+    }
+    std::copy(v_kept, v_kept + n, v);
+    count = n;
+  }
+
+  vec3 Closest() const {
+    vec3 p{0.f};
+    for (int i = 0; i < count; ++i) p += lambda[i] * v[i].w;
+    return p;
+  }
+};
+
+/**
+ * Reduce a triangle to the feature closest to the origin (Ericson 5.1.5)
+ */
+void SolveTriangle(Simplex& s) {
+  const auto &a = s.v[0].w, &b = s.v[1].w, &c = s.v[2].w;
+  const auto ab = b - a, ac = c - a;
+  const auto d1 = -dot(ab, a), d2 = -dot(ac, a);
+  if (d1 <= 0 && d2 <= 0) return s.Keep({{0, 1.f}});
+  const auto d3 = -dot(ab, b), d4 = -dot(ac, b);
+  if (d3 >= 0 && d4 <= d3) return s.Keep({{1, 1.f}});
+  const auto vc = d1 * d4 - d3 * d2;
+  if (vc <= 0 && d1 >= 0 && d3 <= 0) {
+    const auto t = d1 / (d1 - d3);
+    return s.Keep({{0, 1 - t}, {1, t}});
+  }
+  const auto d5 = -dot(ab, c), d6 = -dot(ac, c);
+  if (d6 >= 0 && d5 <= d6) return s.Keep({{2, 1.f}});
+  const auto vb = d5 * d2 - d1 * d6;
+  if (vb <= 0 && d2 >= 0 && d6 <= 0) {
+    const auto t = d2 / (d2 - d6);
+    return s.Keep({{0, 1 - t}, {2, t}});
+  }
+  const auto va = d3 * d6 - d5 * d4;
+  if (va <= 0 && d4 - d3 >= 0 && d5 - d6 >= 0) {
+    const auto t = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+    return s.Keep({{1, 1 - t}, {2, t}});
+  }
+  const auto denominator = 1 / (va + vb + vc);
+  const auto v = vb * denominator, w = vc * denominator;
+  s.Keep({{0, 1 - v - w}, {1, v}, {2, w}});
+}
+
+/**
+ * Reduce the simplex to the smallest one holding its closest point to the
+ * origin, with its barycentric coordinates
+ */
+void Solve(Simplex& s) {
+  switch (s.count) {
+    case 1:
+      s.lambda[0] = 1.f;
+      return;
+    case 2: {
+      const auto ab = s.v[1].w - s.v[0].w;
+      const auto length2 = dot(ab, ab);
+      const auto t = length2 > 0 ? -dot(s.v[0].w, ab) / length2 : 0.f;
+      if (t <= 0) return s.Keep({{0, 1.f}});
+      if (t >= 1) return s.Keep({{1, 1.f}});
+      return s.Keep({{0, 1 - t}, {1, t}});
+    }
+    case 3:
+      return SolveTriangle(s);
+    default:
+      break;
+  }
+
+  // Closest over the faces with the origin outside them, if any. A flat
+  // simplex has no inside to hold the origin, every face counts then.
+  const int faces[4][4] = {{0, 1, 2, 3}, {0, 3, 1, 2}, {0, 2, 3, 1},
+                           {1, 3, 2, 0}};
+  auto flat = false;
+  for (const auto& f : faces) {
+    const auto& a = s.v[f[0]].w;
+    const auto n = cross(s.v[f[1]].w - a, s.v[f[2]].w - a);
+    const auto side_d = dot(n, s.v[f[3]].w - a);
+    flat = flat || side_d * side_d <= kOverlap * kOverlap * dot(n, n);
+  }
+  auto best = FLT_MAX;
+  Simplex closest;
+  for (const auto& f : faces) {
+    const auto &a = s.v[f[0]].w, &b = s.v[f[1]].w, &c = s.v[f[2]].w;
+    const auto n = cross(b - a, c - a);
+    const auto side_origin = -dot(n, a), side_d = dot(n, s.v[f[3]].w - a);
+    if (!flat && side_origin * side_d >= 0) continue;
+    Simplex face;
+    face.v[0] = s.v[f[0]];
+    face.v[1] = s.v[f[1]];
+    face.v[2] = s.v[f[2]];
+    face.count = 3;
+    SolveTriangle(face);
+    const auto p = face.Closest();
+    if (dot(p, p) < best) {
+      best = dot(p, p);
+      closest = face;
+    }
+  }
+  // Origin inside, the simplex stays whole for EPA
+  if (best == FLT_MAX) {
+    std::fill(s.lambda, s.lambda + 4, .25f);
+    return;
+  }
+  s = closest;
+}
+
+/**
+ * Barycentric coordinates of p in triangle abc
+ */
+vec3 Barycentric(const vec3& p, const vec3& a, const vec3& b, const vec3& c) {
+  const auto v0 = b - a, v1 = c - a, v2 = p - a;
+  const auto d00 = dot(v0, v0), d01 = dot(v0, v1), d11 = dot(v1, v1);
+  const auto d20 = dot(v2, v0), d21 = dot(v2, v1);
+  const auto denominator = d00 * d11 - d01 * d01;
+  if (denominator == 0.f) return {1.f, 0.f, 0.f};
+  const auto v = (d11 * d20 - d01 * d21) / denominator;
+  const auto w = (d00 * d21 - d01 * d20) / denominator;
+  return {1 - v - w, v, w};
+}
+
+// Named after the two lines it is on, incident edges below kMaxPolygon and
+// reference side planes from there, which do not change as it is clipped
+struct ClipVertex {
+  vec3 p;
+  std::uint32_t in, out;  // Edge arriving at it and edge leaving it
+};
+
+/**
+ * Face of the shape most aligned with d, counter-clockwise from outside
+ */
+struct Polygon {
+  vec3 n;
+  float alignment;
+  std::uint32_t face;
+  int count;
+  ClipVertex v[kMaxPolygon];
+};
+
+void BestPolygon(const ConvexShape& s, const vec3& d, std::uint32_t hint,
+                 Polygon& polygon) {
+  if (!s.hull) {
+    auto j = 0;
+    for (int k = 1; k < 3; ++k) {
+      if (std::abs(dot(s.R[k], d)) > std::abs(dot(s.R[j], d))) j = k;
+    }
+    const auto sign = dot(s.R[j], d) > 0 ? 1.f : -1.f;
+    const auto u = (j + 1) % 3, v = (j + 2) % 3;
+    const auto center = s.c + sign * s.e[j] * s.R[j];
+    const auto eu = s.e[u] * s.R[u], ev = s.e[v] * s.R[v] * sign;
+    polygon.n = sign * s.R[j];
+    polygon.face = std::uint32_t(j * 2 + (sign > 0));
+    polygon.count = 4;
+    polygon.v[0] = {center + eu + ev, 3, 0};
+    polygon.v[1] = {center - eu + ev, 0, 1};
+    polygon.v[2] = {center - eu - ev, 1, 2};
+    polygon.v[3] = {center + eu - ev, 2, 3};
+  } else {
+    const auto local = transpose(s.R) * d;
+    const auto f = s.hull->BestFace(local, s.hull->Support(local, hint));
+    const auto& face = s.hull->GetFaces()[f];
+    polygon.n = s.R * face.n;
+    polygon.face = f;
+    polygon.count = int(std::min<std::uint32_t>(face.count, kMaxPolygon));
+    const auto vertices = s.hull->FaceVertices(face);
+    for (int k = 0; k < polygon.count; ++k) {
+      polygon.v[k] = {s.Vertex(vertices[k]),
+                      std::uint32_t((k + polygon.count - 1) % polygon.count),
+                      std::uint32_t(k)};
+    }
+  }
+  polygon.alignment = dot(polygon.n, d);
+}
+
+/**
+ * Sutherland-Hodgman against the plane dot(m, p) = d, keeping the negative side
+ */
+int ClipPlane(const ClipVertex* in, int n, const vec3& m, float d, int plane,
+              ClipVertex* out) {
+  auto k = 0;
+  for (int i = 0; i < n; ++i) {
+    const auto& v1 = in[i];
+    const auto& v2 = in[(i + 1) % n];
+    const auto d1 = dot(m, v1.p) - d, d2 = dot(m, v2.p) - d;
+    if (d1 <= 0) out[k++] = v1;
+    if ((d1 <= 0) != (d2 <= 0)) {
+      // Where the edge leaves or enters the kept side
+      const auto p = v1.p + d1 / (d1 - d2) * (v2.p - v1.p);
+      const auto line = std::uint32_t(kMaxPolygon + plane);
+      out[k++] = d1 <= 0 ? ClipVertex{p, v1.out, line}
+                         : ClipVertex{p, line, v1.out};
+    }
+  }
+  return k;
+}
+
+/**
+ * Clip the incident face against the side planes of the reference face
+ * The normal points from the reference shape to the incident one.
+ */
+bool FaceContact(const Polygon& ref, const Polygon& inc, bool flip,
+                 float margin, Manifold& m) {
+  ClipVertex buffers[2][2 * kMaxPolygon];
+  std::copy(inc.v, inc.v + inc.count, buffers[0]);
+  auto count = inc.count, current = 0;
+  for (int i = 0; i < ref.count && count > 0; ++i) {
+    const auto& p = ref.v[i].p;
+    const auto side = cross(ref.v[(i + 1) % ref.count].p - p, ref.n);
+    const auto length2 = dot(side, side);
+    if (length2 == 0.f) continue;
+    // The two faces are convex, so the result has at most both their counts
+    count = ClipPlane(buffers[current], count, side, dot(side, p), i,
+                      buffers[1 - current]);
+    current = 1 - current;
+  }
+
+  // Feature IDs only need to be unique within the pair: 24 bits for each
+  // face, 7 for each line
+  const auto faces = std::uint64_t(ref.face & 0xFFFFFF) << 38 |
+                     std::uint64_t(inc.face & 0xFFFFFF) << 14;
+  const auto face = dot(ref.n, ref.v[0].p);
+  Contact contacts[2 * kMaxPolygon];
+  auto n_contacts = 0;
+  for (int i = 0; i < count; ++i) {
+    const auto& p = buffers[current][i];
+    const auto s = dot(ref.n, p.p) - face;
+    if (s > margin) continue;
+    contacts[n_contacts++] = {
+        p.p - ref.n * s / 2.f, -s,
+        std::uint64_t(flip) << 63 | faces | p.in << 7 | p.out};
+  }
+  if (n_contacts == 0) return false;
+
+  m.n = flip ? -ref.n : ref.n;
+  Reduce(contacts, n_contacts, ref.n, m);
+  return true;
+}
+}  // namespace
+
+ConvexShape ConvexShape::FromBox(const OBB& box) {
+  if (box.hull) {
+    return {box.hull,
+            box.c - box.R * (box.hull->GetLower() + box.hull->GetUpper()) / 2.f,
+            box.R, box.e};
+  }
+  return {nullptr, box.c, box.R, box.e};
+}
+
+std::uint32_t ConvexShape::Support(const glm::vec3& d,
+                                   std::uint32_t hint) const {
+  if (hull) return hull->Support(transpose(R) * d, hint);
+  return std::uint32_t(dot(R[0], d) > 0) | std::uint32_t(dot(R[1], d) > 0) << 1 |
+         std::uint32_t(dot(R[2], d) > 0) << 2;
+}
+
+glm::vec3 ConvexShape::Vertex(std::uint32_t v) const {
+  if (hull) return c + R * hull->GetVertices()[v];
+  return c + ((v & 1) ? 1.f : -1.f) * e.x * R[0] +
+         ((v & 2) ? 1.f : -1.f) * e.y * R[1] +
+         ((v & 4) ? 1.f : -1.f) * e.z * R[2];
+}
+
+float Distance(const ConvexShape& a, const ConvexShape& b, SimplexCache& cache,
+               glm::vec3& pa, glm::vec3& pb) {
+  Simplex s;
+  for (int i = 0; i < cache.count; ++i) {
+    s.v[s.count++] = MakeVertex(a, b, cache.a[i], cache.b[i]);
+  }
+  if (s.count == 0) {
+    s.v[s.count++] = MakeVertex(a, b, cache.hint_a, cache.hint_b);
+  }
+  Solve(s);
+
+  auto v = s.Closest();
+  for (int iteration = 0; iteration < kMaxIterations; ++iteration) {
+    if (s.count == 4 || dot(v, v) < kOverlap * kOverlap) break;
+
+    cache.hint_a = a.Support(-v, cache.hint_a);
+    cache.hint_b = b.Support(v, cache.hint_b);
+    const auto w = MakeVertex(a, b, cache.hint_a, cache.hint_b);
+    // No vertex further along, v is as close as it gets
+    if (dot(v, v) - dot(v, w.w) <= kRelativeTolerance * dot(v, v)) break;
+    const auto repeated = std::any_of(s.v, s.v + s.count, [&](const auto& x) {
+      return x.ia == w.ia && x.ib == w.ib;
+    });
+    if (repeated) break;
+
+    s.v[s.count++] = w;
+    Solve(s);
+    v = s.Closest();
+  }
+
+  cache.count = s.count;
+  pa = pb = vec3{0.f};
+  for (int i = 0; i < s.count; ++i) {
+    cache.a[i] = s.v[i].ia;
+    cache.b[i] = s.v[i].ib;
+    pa += s.lambda[i] * s.v[i].a;
+    pb += s.lambda[i] * s.v[i].b;
+  }
+  return s.count == 4 ? 0.f : length(v);
+}
+
+bool Penetration(const ConvexShape& a, const ConvexShape& b,
+                 const SimplexCache& cache, glm::vec3& n, float& depth,
+                 glm::vec3& pa, glm::vec3& pb) {
+  SimplexVertex vertices[kMaxPolytopeVertices];
+  auto n_vertices = 0;
+  for (int i = 0; i < cache.count; ++i) {
+    vertices[n_vertices++] = MakeVertex(a, b, cache.a[i], cache.b[i]);
+  }
+  const auto support = [&](const vec3& d) {
+    return MakeVertex(a, b, a.Support(d, cache.hint_a),
+                      b.Support(-d, cache.hint_b));
+  };
+
+  // A touching simplex may be degenerate, grow it into a tetrahedron
+  const vec3 axes[3] = {{1.f, 0.f, 0.f}, {0.f, 1.f, 0.f}, {0.f, 0.f, 1.f}};
+  const auto eps = kOverlap;
+  if (n_vertices == 0) vertices[n_vertices++] = support(b.c - a.c);
+  for (int tries = 0; n_vertices < 4 && tries < 3; ++tries) {
+    vec3 directions[6];
+    auto n_directions = 0;
+    if (n_vertices == 1) {
+      for (const auto& x : axes) {
+        directions[n_directions++] = x;
+        directions[n_directions++] = -x;
+      }
+    } else if (n_vertices == 2) {
+      const auto line = vertices[1].w - vertices[0].w;
+      for (const auto& x : axes) {
+        const auto d = cross(line, x);
+        if (dot(d, d) == 0.f) continue;
+        directions[n_directions++] = d;
+        directions[n_directions++] = -d;
+      }
+    } else {
+      const auto d = cross(vertices[1].w - vertices[0].w,
+                           vertices[2].w - vertices[0].w);
+      directions[n_directions++] = d;
+      directions[n_directions++] = -d;
+    }
+    for (int k = 0; k < n_directions; ++k) {
+      const auto x = support(directions[k]);
+      // Keep it only if it spans one more dimension
+      const auto& p = vertices[0].w;
+      auto spread = 0.f;
+      if (n_vertices == 1) {
+        spread = length(x.w - p);
+      } else if (n_vertices == 2) {
+        const auto line = vertices[1].w - p;
+        spread = length(cross(x.w - p, line)) / length(line);
+      } else {
+        const auto normal = normalize(
+            cross(vertices[1].w - p, vertices[2].w - p));
+        spread = std::abs(dot(x.w - p, normal));
+      }
+      if (spread > eps) {
+        vertices[n_vertices++] = x;
+        break;
+      }
+    }
+  }
+  if (n_vertices < 4) return false;
+
+  struct Face {
+    int v[3];
+    vec3 n;
+    float d;  // Distance of the origin from the plane, inwards
+  };
+  Face faces[kMaxPolytopeFaces];
+  auto n_faces = 0;
+  const auto make_face = [&](int i, int j, int k) {
+    const auto normal = cross(vertices[j].w - vertices[i].w,
+                              vertices[k].w - vertices[i].w);
+    const auto length2 = dot(normal, normal);
+    if (length2 == 0.f) return false;
+    const auto unit = normal / std::sqrt(length2);
+    faces[n_faces++] = {{i, j, k}, unit, dot(unit, vertices[i].w)};
+    return true;
+  };
+
+  // Tetrahedron wound outwards
+  const auto inside =
+      (vertices[0].w + vertices[1].w + vertices[2].w + vertices[3].w) / 4.f;
+  const int tetrahedron[4][3] = {{0, 1, 2}, {0, 3, 1}, {0, 2, 3}, {1, 3, 2}};
+  for (const auto& t : tetrahedron) {
+    const auto outward = dot(cross(vertices[t[1]].w - vertices[t[0]].w,
+                                   vertices[t[2]].w - vertices[t[0]].w),
+                             vertices[t[0]].w - inside) > 0;
+    const auto ok = outward ? make_face(t[0], t[1], t[2])
+                            : make_face(t[0], t[2], t[1]);
+    if (!ok) return false;
+  }
+
+  const auto closest = [&] {
+    auto best = 0;
+    for (int f = 1; f < n_faces; ++f) {
+      if (faces[f].d < faces[best].d) best = f;
+    }
+    return best;
+  };
+  std::pair<int, int> edges[3 * kMaxPolytopeFaces];
+  for (int iteration = 0; iteration < kMaxIterations; ++iteration) {
+    const auto& face = faces[closest()];
+    const auto w = support(face.n);
+    if (dot(face.n, w.w) - face.d < kEpaTolerance * std::max(face.d, 1.f) ||
+        n_vertices == kMaxPolytopeVertices) {
+      break;
+    }
+
+    // Remove what the new vertex sees, the horizon closes the hole
+    const auto k = n_vertices;
+    vertices[n_vertices++] = w;
+    auto n_edges = 0;
+    for (int f = 0; f < n_faces;) {
+      if (dot(faces[f].n, w.w) - faces[f].d <= 0) {
+        ++f;
+        continue;
+      }
+      for (int e = 0; e < 3; ++e) {
+        const std::pair<int, int> edge{faces[f].v[e], faces[f].v[(e + 1) % 3]};
+        const auto shared =
+            std::find(edges, edges + n_edges,
+                      std::make_pair(edge.second, edge.first));
+        if (shared != edges + n_edges) {
+          *shared = edges[--n_edges];
+        } else {
+          edges[n_edges++] = edge;
+        }
+      }
+      faces[f] = faces[--n_faces];
+    }
+    if (n_faces + n_edges > kMaxPolytopeFaces) return false;
+    for (int e = 0; e < n_edges; ++e) {
+      if (!make_face(edges[e].first, edges[e].second, k)) return false;
+    }
+  }
+
+  const auto& face = faces[closest()];
+  n = face.n;
+  depth = face.d;
+  const auto& x = vertices[face.v[0]];
+  const auto& y = vertices[face.v[1]];
+  const auto& z = vertices[face.v[2]];
+  const auto l = Barycentric(face.n * face.d, x.w, y.w, z.w);
+  pa = l.x * x.a + l.y * y.a + l.z * z.a;
+  pb = l.x * x.b + l.y * y.b + l.z * z.b;
+  return true;
+}
+
+bool CollideConvex(const ConvexShape& a, const ConvexShape& b, float margin,
+                   SimplexCache& cache, Manifold& m) {
+  vec3 pa, pb, n;
+  auto depth = 0.f;
+  const auto distance = Distance(a, b, cache, pa, pb);
+  if (distance > margin) return false;
+  if (distance > kOverlap) {
+    n = (pb - pa) / distance;
+    depth = -distance;
+  } else if (!Penetration(a, b, cache, n, depth, pa, pb)) {
+    // Exactly touching, any sensible direction does
+    n = b.c - a.c;
+    n = dot(n, n) > 0.f ? normalize(n) : vec3{0.f, 1.f, 0.f};
+    depth = 0.f;
+  }
+
+  // Prefer a's face unless b's is clearly better aligned
+  Polygon face_a, face_b;
+  BestPolygon(a, n, cache.hint_a, face_a);
+  BestPolygon(b, -n, cache.hint_b, face_b);
+  if (std::max(face_a.alignment, face_b.alignment) >= kFaceAlignment) {
+    if (face_b.alignment > face_a.alignment + 1E-3f) {
+      return FaceContact(face_b, face_a, true, margin, m);
+    }
+    return FaceContact(face_a, face_b, false, margin, m);
+  }
+
+  // Crossing edges, or a vertex, touch at a single point
+  m.n = n;
+  m.count = 1;
+  m.contacts[0] = {(pa + pb) / 2.f, depth,
+                   std::uint64_t(1) << 62 |
+                       std::uint64_t(a.Support(n, cache.hint_a)) << 31 |
+                       b.Support(-n, cache.hint_b)};
+  return true;
+}
+
+bool CollideGroundConvex(const ConvexShape& a, float margin,
+                         std::uint32_t& hint, Manifold& m) {
+  const auto& hull = *a.hull;
+  hint = a.Support({0.f, -1.f, 0.f}, hint);
+  if (a.Vertex(hint).y > margin) return false;
+
+  // Vertices below the margin are connected, so walk out from the lowest
+  Contact contacts[kMaxPolygon];
+  std::uint32_t found[kMaxPolygon];
+  auto n = 0;
+  found[n] = hint;
+  const auto p = a.Vertex(hint);
+  contacts[n++] = {vec3{p.x, p.y / 2.f, p.z}, -p.y, hint};
+  for (int i = 0; i < n; ++i) {
+    for (auto v = hull.NeighborsBegin(found[i]);
+         v != hull.NeighborsEnd(found[i]) && n < kMaxPolygon; ++v) {
+      if (std::find(found, found + n, *v) != found + n) continue;
+      const auto q = a.Vertex(*v);
+      if (q.y > margin) continue;
+      found[n] = *v;
+      contacts[n++] = {vec3{q.x, q.y / 2.f, q.z}, -q.y, *v};
+    }
+  }
+
+  m.n = vec3{0.f, -1.f, 0.f};
+  Reduce(contacts, n, m.n, m);
+  return true;
+}
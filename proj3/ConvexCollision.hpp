@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#include "Contact.hpp"
+#include "ConvexHull.hpp"
+
+struct OBB;
+
+/**
+ * A hull, or a box, placed in the world
+ * Vertices are named by index, hull vertices or box corners by sign bits.
+ */
+struct ConvexShape {
+  /**
+   * The hull inside the box if it has one, otherwise the box itself
+   */
+  static ConvexShape FromBox(const OBB& box);
+
+  /**
+   * Vertex furthest along d, hull searches start from hint
+   */
+  std::uint32_t Support(const glm::vec3& d, std::uint32_t hint) const;
+
+  glm::vec3 Vertex(std::uint32_t v) const;
+
+  const ConvexHull* hull;  // Null for a box
+  glm::vec3 c;             // Hull origin or box center
+  glm::mat3 R;
+  glm::vec3 e;  // Half extents of a box
+};
+
+/**
+ * What GJK keeps of a pair between steps
+ * The simplex is kept as pairs of vertices, so it is rebuilt at the new
+ * poses and usually already is or is next to the answer.
+ */
+struct SimplexCache {
+  int count = 0;
+  std::uint32_t a[4], b[4];
+  std::uint32_t hint_a = 0, hint_b = 0;  // Last support vertices
+};
+
+/**
+ * GJK distance between the shapes, 0 when they overlap
+ * pa and pb are the closest points, the cache holds the final simplex.
+ */
+float Distance(const ConvexShape& a, const ConvexShape& b, SimplexCache& cache,
+               glm::vec3& pa, glm::vec3& pb);
+
+/**
+ * EPA from the simplex of an overlapping Distance()
+ * n is the unit normal from a to b, depth how far to move b along it to
+ * separate them, pa and pb the deepest points.
+ */
+bool Penetration(const ConvexShape& a, const ConvexShape& b,
+                 const SimplexCache& cache, glm::vec3& n, float& depth,
+                 glm::vec3& pa, glm::vec3& pb);
+
+/**
+ * Contact where at least one shape is a hull, up to margin apart
+ * The normal comes from GJK, or EPA when overlapping. The face of either
+ * shape most aligned with it is clipped against the other's for up to 4
+ * points, crossing edges give 1.
+ */
+bool CollideConvex(const ConvexShape& a, const ConvexShape& b, float margin,
+                   SimplexCache& cache, Manifold& m);
+
+/**
+ * Hull vertices below y = margin, found from the lowest one over the edges
+ * hint is the previous lowest vertex.
+ */
+bool CollideGroundConvex(const ConvexShape& a, float margin,
+                         std::uint32_t& hint, Manifold& m);
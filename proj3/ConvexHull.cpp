@@ -0,0 +1,556 @@
+#include "ConvexHull.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <iostream>
+#include <numeric>
+#include <type_traits>
+#include <unordered_map>
+
+#include "Checkpoint.hpp"
+
+using namespace glm;
+
+namespace {
+// Relative to the size of the point cloud
+const auto kTolerance = 1E-5f;
+// Triangles closer than this to parallel to a face's first triangle, and
+// in its plane, are merged into the face
+const auto kCoplanar = 1E-4f;
+
+// One hull in a checkpoint, its arrays are the next sizes[i] elements of
+// each section in ForEachArray() order
+struct HullRecord {
+  std::uint32_t sizes[7];
+  float volume;
+  vec3 inertia, lo, hi;
+  float radius;
+  vec3 centroid;
+  mat3 frame;
+};
+
+struct Triangle {
+  std::uint32_t v[3];
+  vec3 n;
+  float d;
+  bool alive;
+};
+
+Triangle MakeTriangle(const std::vector<vec3>& p, std::uint32_t a,
+                      std::uint32_t b, std::uint32_t c) {
+  const auto n = normalize(cross(p[b] - p[a], p[c] - p[a]));
+  return {{a, b, c}, n, dot(n, p[a]), true};
+}
+
+std::uint64_t EdgeKey(std::uint32_t a, std::uint32_t b) {
+  return std::uint64_t(a) << 32 | b;
+}
+
+// start is a CSR offset array over n rows into values, each value below
+// limit
+bool IsCsr(const std::vector<std::uint32_t>& start,
+           const std::vector<std::uint32_t>& values, size_t n, size_t limit) {
+  if (start.size() != n + 1 || start.front() != 0 ||
+      start.back() != values.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < n; ++i) {
+    if (start[i] > start[i + 1]) return false;
+  }
+  return std::all_of(values.begin(), values.end(),
+                     [&](std::uint32_t v) { return v < limit; });
+}
+
+/**
+ * Eigenvalues and eigenvectors (columns) of a symmetric matrix, cyclic Jacobi
+ */
+void Eigen(float (&a)[3][3], float (&v)[3][3]) {
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 3; ++j) v[i][j] = i == j;
+  }
+  for (int sweep = 0; sweep < 16; ++sweep) {
+    const auto off = a[0][1] * a[0][1] + a[0][2] * a[0][2] + a[1][2] * a[1][2];
+    const auto diagonal =
+        a[0][0] * a[0][0] + a[1][1] * a[1][1] + a[2][2] * a[2][2];
+    if (off <= 1E-14f * diagonal) return;
+    for (int p = 0; p < 2; ++p) {
+      for (int q = p + 1; q < 3; ++q) {
+        if (a[p][q] == 0.f) continue;
+        // Rotation in the (p, q) plane zeroing a[p][q]
+        const auto theta = (a[q][q] - a[p][p]) / (2 * a[p][q]);
+        const auto t = (theta >= 0 ? 1.f : -1.f) /
+                       (std::abs(theta) + std::sqrt(theta * theta + 1));
+        const auto c = 1 / std::sqrt(t * t + 1), s = t * c;
+        for (int k = 0; k < 3; ++k) {
+          const auto kp = a[k][p], kq = a[k][q];
+          a[k][p] = c * kp - s * kq;
+          a[k][q] = s * kp + c * kq;
+        }
+        for (int k = 0; k < 3; ++k) {
+          const auto pk = a[p][k], qk = a[q][k];
+          a[p][k] = c * pk - s * qk;
+          a[q][k] = s * pk + c * qk;
+        }
+        for (int k = 0; k < 3; ++k) {
+          const auto kp = v[k][p], kq = v[k][q];
+          v[k][p] = c * kp - s * kq;
+          v[k][q] = s * kp + c * kq;
+        }
+      }
+    }
+  }
+}
+
+/**
+ * Quickhull, live triangles wound counter-clockwise from outside
+ * Each triangle keeps the points outside it, and the furthest of them is
+ * added next, which keeps the hull convex in floating point. Empty if the
+ * points span no volume.
+ */
+std::vector<Triangle> Triangulate(const std::vector<vec3>& p) {
+  auto lo = p[0], hi = p[0];
+  for (const auto& x : p) {
+    lo = min(lo, x);
+    hi = max(hi, x);
+  }
+  const auto extent = hi - lo;
+  const auto eps =
+      kTolerance * std::max({extent.x, extent.y, extent.z, 1E-12f});
+
+  // Initial tetrahedron from extreme points
+  auto axis = 0;
+  for (int k = 1; k < 3; ++k) {
+    if (extent[k] > extent[axis]) axis = k;
+  }
+  std::uint32_t i[4] = {0, 0, 0, 0};
+  for (std::uint32_t k = 0; k < p.size(); ++k) {
+    if (p[k][axis] < p[i[0]][axis]) i[0] = k;
+    if (p[k][axis] > p[i[1]][axis]) i[1] = k;
+  }
+  const auto line = p[i[1]] - p[i[0]];
+  auto best = 0.f;
+  for (std::uint32_t k = 0; k < p.size(); ++k) {
+    const auto off = length(cross(p[k] - p[i[0]], line));
+    if (off > best) {
+      best = off;
+      i[2] = k;
+    }
+  }
+  if (best <= eps * length(line)) return {};
+  const auto normal = normalize(cross(line, p[i[2]] - p[i[0]]));
+  best = 0.f;
+  for (std::uint32_t k = 0; k < p.size(); ++k) {
+    const auto off = std::abs(dot(p[k] - p[i[0]], normal));
+    if (off > best) {
+      best = off;
+      i[3] = k;
+    }
+  }
+  if (best <= eps) return {};
+
+  std::vector<Triangle> triangles;
+  std::vector<std::vector<std::uint32_t>> outside;
+  std::unordered_map<std::uint64_t, std::uint32_t> owner;  // Directed edge
+  const auto add = [&](std::uint32_t a, std::uint32_t b, std::uint32_t c) {
+    const auto f = std::uint32_t(triangles.size());
+    triangles.push_back(MakeTriangle(p, a, b, c));
+    outside.emplace_back();
+    for (int e = 0; e < 3; ++e) {
+      owner[EdgeKey(triangles[f].v[e], triangles[f].v[(e + 1) % 3])] = f;
+    }
+  };
+  // Each point goes to the triangle it is furthest outside of, if any
+  const auto assign = [&](std::uint32_t k, std::uint32_t first) {
+    auto best = eps;
+    auto chosen = ~0U;
+    for (auto f = first; f < triangles.size(); ++f) {
+      const auto s = dot(triangles[f].n, p[k]) - triangles[f].d;
+      if (s > best) {
+        best = s;
+        chosen = f;
+      }
+    }
+    if (chosen != ~0U) outside[chosen].push_back(k);
+  };
+
+  const auto inside = (p[i[0]] + p[i[1]] + p[i[2]] + p[i[3]]) / 4.f;
+  for (int k = 0; k < 4; ++k) {
+    const auto t = MakeTriangle(p, i[k], i[(k + 1) % 4], i[(k + 2) % 4]);
+    if (dot(t.n, inside) > t.d) {
+      add(i[k], i[(k + 2) % 4], i[(k + 1) % 4]);
+    } else {
+      add(i[k], i[(k + 1) % 4], i[(k + 2) % 4]);
+    }
+  }
+  for (std::uint32_t k = 0; k < p.size(); ++k) {
+    if (std::find(i, i + 4, k) == i + 4) assign(k, 0);
+  }
+
+  // New triangles are appended, so one pass reaches all of them
+  std::vector<std::uint32_t> visible, orphans;
+  std::vector<std::pair<std::uint32_t, std::uint32_t>> horizon;
+  for (std::uint32_t f = 0; f < triangles.size(); ++f) {
+    if (!triangles[f].alive || outside[f].empty()) continue;
+    const auto k = *std::max_element(
+        outside[f].begin(), outside[f].end(),
+        [&](std::uint32_t a, std::uint32_t b) {
+          return dot(triangles[f].n, p[a]) < dot(triangles[f].n, p[b]);
+        });
+
+    // Visible triangles grown from f, so they form one cap. Those already
+    // taken are dead, the edge map only knows live ones and the cap.
+    triangles[f].alive = false;
+    visible.assign(1, f);
+    horizon.clear();
+    for (size_t j = 0; j < visible.size(); ++j) {
+      const auto& t = triangles[visible[j]];
+      for (int e = 0; e < 3; ++e) {
+        const auto a = t.v[e], b = t.v[(e + 1) % 3];
+        auto& neighbor = triangles[owner[EdgeKey(b, a)]];
+        if (!neighbor.alive) continue;
+        if (dot(neighbor.n, p[k]) - neighbor.d > eps) {
+          neighbor.alive = false;
+          visible.push_back(owner[EdgeKey(b, a)]);
+        } else {
+          horizon.emplace_back(a, b);
+        }
+      }
+    }
+
+    orphans.clear();
+    for (const auto g : visible) {
+      for (const auto q : outside[g]) {
+        if (q != k) orphans.push_back(q);
+      }
+      outside[g].clear();
+      outside[g].shrink_to_fit();
+      for (int e = 0; e < 3; ++e) {
+        const auto key = EdgeKey(triangles[g].v[e], triangles[g].v[(e + 1) % 3]);
+        if (owner[key] == g) owner.erase(key);
+      }
+    }
+    const auto first = std::uint32_t(triangles.size());
+    for (const auto& [a, b] : horizon) add(a, b, k);
+    for (const auto q : orphans) assign(q, first);
+  }
+
+  triangles.erase(std::remove_if(triangles.begin(), triangles.end(),
+                                 [](const Triangle& t) { return !t.alive; }),
+                  triangles.end());
+  return triangles;
+}
+}  // namespace
+
+ConvexHull::ConvexHull(const std::vector<glm::vec3>& points) {
+  if (points.size() < 4) {
+    std::cerr << "Convex hull needs at least 4 points" << std::endl;
+    return;
+  }
+  auto triangles = Triangulate(points);
+  if (triangles.empty()) {
+    std::cerr << "Convex hull of coplanar points" << std::endl;
+    return;
+  }
+
+  // Keep only the points on the hull
+  std::vector<std::uint32_t> index(points.size(), ~0U);
+  for (auto& t : triangles) {
+    for (auto& v : t.v) {
+      if (index[v] == ~0U) {
+        index[v] = std::uint32_t(vertices_.size());
+        vertices_.push_back(points[v]);
+      }
+      v = index[v];
+    }
+  }
+  const auto n_vertices = std::uint32_t(vertices_.size());
+
+  // Mass properties from tetrahedra between a point inside and each triangle
+  const auto origin =
+      std::accumulate(vertices_.begin(), vertices_.end(), vec3{0.f}) /
+      float(n_vertices);
+  auto volume = 0.f;
+  vec3 moment{0.f};
+  float covariance[3][3] = {};
+  for (const auto& t : triangles) {
+    const vec3 x[3] = {vertices_[t.v[0]] - origin, vertices_[t.v[1]] - origin,
+                       vertices_[t.v[2]] - origin};
+    const auto det = dot(x[0], cross(x[1], x[2]));
+    const auto sum = x[0] + x[1] + x[2];
+    volume += det / 6;
+    moment += det / 24 * sum;
+    for (int j = 0; j < 3; ++j) {
+      for (int k = 0; k < 3; ++k) {
+        covariance[j][k] += det / 120 *
+                            (x[0][j] * x[0][k] + x[1][j] * x[1][k] +
+                             x[2][j] * x[2][k] + sum[j] * sum[k]);
+      }
+    }
+  }
+  volume_ = volume;
+  const auto center = moment / volume;
+  centroid_ = origin + center;
+
+  // Inertia about the centroid, unit density, then its principal axes
+  float inertia[3][3], axes[3][3];
+  for (int j = 0; j < 3; ++j) {
+    for (int k = 0; k < 3; ++k) {
+      covariance[j][k] -= volume * center[j] * center[k];
+    }
+  }
+  const auto trace = covariance[0][0] + covariance[1][1] + covariance[2][2];
+  for (int j = 0; j < 3; ++j) {
+    for (int k = 0; k < 3; ++k) {
+      inertia[j][k] = (j == k ? trace : 0.f) - covariance[j][k];
+    }
+  }
+  Eigen(inertia, axes);
+  for (int k = 0; k < 3; ++k) {
+    frame_[k] = vec3{axes[0][k], axes[1][k], axes[2][k]};
+    inertia_[k] = inertia[k][k] / volume;
+  }
+  if (dot(cross(frame_[0], frame_[1]), frame_[2]) < 0) frame_[2] = -frame_[2];
+
+  const auto to_body = transpose(frame_);
+  lo_ = vec3{FLT_MAX};
+  hi_ = vec3{-FLT_MAX};
+  for (auto& v : vertices_) {
+    v = to_body * (v - centroid_);
+    lo_ = min(lo_, v);
+    hi_ = max(hi_, v);
+    radius_ = std::max(radius_, length(v));
+  }
+  for (auto& t : triangles) t = MakeTriangle(vertices_, t.v[0], t.v[1], t.v[2]);
+
+  // Neighbors of each vertex along triangle edges, each edge seen from both
+  // sides
+  std::unordered_map<std::uint64_t, std::uint32_t> edge_triangle;
+  neighbor_start_.assign(n_vertices + 1, 0);
+  for (std::uint32_t f = 0; f < triangles.size(); ++f) {
+    for (int e = 0; e < 3; ++e) {
+      const auto a = triangles[f].v[e], b = triangles[f].v[(e + 1) % 3];
+      edge_triangle[EdgeKey(a, b)] = f;
+      ++neighbor_start_[a + 1];
+    }
+  }
+  std::partial_sum(neighbor_start_.begin(), neighbor_start_.end(),
+                   neighbor_start_.begin());
+  neighbors_.resize(neighbor_start_.back());
+  auto fill = neighbor_start_;
+  for (const auto& t : triangles) {
+    for (int e = 0; e < 3; ++e) neighbors_[fill[t.v[e]]++] = t.v[(e + 1) % 3];
+  }
+
+  // Faces grow from a seed triangle over neighbors in the seed's plane, so
+  // nearly flat steps never chain into a curved face
+  const auto plane_eps = kTolerance * 2 * radius_;
+  std::vector<std::uint32_t> group(triangles.size(), ~0U);
+  std::vector<std::vector<std::uint32_t>> members;
+  for (std::uint32_t seed = 0; seed < triangles.size(); ++seed) {
+    if (group[seed] != ~0U) continue;
+    const auto& plane = triangles[seed];
+    const auto id = std::uint32_t(members.size());
+    group[seed] = id;
+    members.emplace_back(1, seed);
+    auto& face = members.back();
+    for (size_t j = 0; j < face.size(); ++j) {
+      const auto& t = triangles[face[j]];
+      for (int e = 0; e < 3; ++e) {
+        const auto g = edge_triangle[EdgeKey(t.v[(e + 1) % 3], t.v[e])];
+        const auto& u = triangles[g];
+        if (group[g] != ~0U || dot(plane.n, u.n) <= 1 - kCoplanar) continue;
+        const auto in_plane = std::all_of(u.v, u.v + 3, [&](std::uint32_t v) {
+          return std::abs(dot(plane.n, vertices_[v]) - plane.d) <= plane_eps;
+        });
+        if (!in_plane) continue;
+        group[g] = id;
+        face.push_back(g);
+      }
+    }
+  }
+
+  // Boundary edges chain into the polygon, unless they are not one simple
+  // convex loop
+  std::unordered_map<std::uint32_t, std::uint32_t> next;
+  const auto add_polygon = [&](const std::vector<std::uint32_t>& face) {
+    next.clear();
+    vec3 n{0.f};
+    for (const auto f : face) {
+      const auto& t = triangles[f];
+      n += cross(vertices_[t.v[1]] - vertices_[t.v[0]],
+                 vertices_[t.v[2]] - vertices_[t.v[0]]);
+      for (int e = 0; e < 3; ++e) {
+        const auto a = t.v[e], b = t.v[(e + 1) % 3];
+        const auto g = edge_triangle[EdgeKey(b, a)];
+        // A vertex on two boundary edges pinches the polygon
+        if (group[g] != group[f] && !next.emplace(a, b).second) return false;
+      }
+    }
+    if (next.empty()) return false;
+    n = normalize(n);
+
+    Face polygon{n, 0.f, std::uint32_t(face_vertices_.size()), 0};
+    const auto start = next.begin()->first;
+    auto v = start;
+    do {
+      face_vertices_.push_back(v);
+      polygon.d += dot(n, vertices_[v]);
+      v = next[v];
+    } while (v != start && face_vertices_.size() - polygon.first < next.size());
+    polygon.count = std::uint32_t(face_vertices_.size() - polygon.first);
+    // Loops left over are holes or further pieces
+    auto simple = v == start && polygon.count == next.size();
+    const auto loop = face_vertices_.data() + polygon.first;
+    for (std::uint32_t k = 0; simple && k < polygon.count; ++k) {
+      const auto &a = vertices_[loop[k]],
+                 &b = vertices_[loop[(k + 1) % polygon.count]],
+                 &c = vertices_[loop[(k + 2) % polygon.count]];
+      simple = dot(cross(b - a, c - b), n) >=
+               -kCoplanar * length(b - a) * length(c - b);
+    }
+    if (!simple) {
+      face_vertices_.resize(polygon.first);
+      return false;
+    }
+    polygon.d /= float(polygon.count);
+    faces_.push_back(polygon);
+    return true;
+  };
+  for (const auto& face : members) {
+    if (add_polygon(face)) continue;
+    for (const auto f : face) {
+      const auto& t = triangles[f];
+      faces_.push_back({t.n, t.d, std::uint32_t(face_vertices_.size()), 3});
+      face_vertices_.insert(face_vertices_.end(), t.v, t.v + 3);
+    }
+  }
+
+  // Faces around each vertex, where BestFace() looks
+  vertex_face_start_.assign(n_vertices + 1, 0);
+  for (const auto& f : faces_) {
+    for (auto k = f.first; k < f.first + f.count; ++k) {
+      ++vertex_face_start_[face_vertices_[k] + 1];
+    }
+  }
+  std::partial_sum(vertex_face_start_.begin(), vertex_face_start_.end(),
+                   vertex_face_start_.begin());
+  vertex_faces_.resize(vertex_face_start_.back());
+  fill = vertex_face_start_;
+  for (std::uint32_t f = 0; f < faces_.size(); ++f) {
+    for (auto k = faces_[f].first; k < faces_[f].first + faces_[f].count; ++k) {
+      vertex_faces_[fill[face_vertices_[k]]++] = f;
+    }
+  }
+}
+
+std::uint32_t ConvexHull::Support(const glm::vec3& d,
+                                  std::uint32_t start) const {
+  // The support function has no local maxima on the vertex graph of a
+  // convex polytope, so steepest ascent ends at the global one
+  auto best = start;
+  auto best_dot = dot(vertices_[best], d);
+  for (auto current = ~best; current != best;) {
+    current = best;
+    for (auto k = neighbor_start_[current]; k < neighbor_start_[current + 1];
+         ++k) {
+      const auto v = neighbors_[k];
+      if (const auto s = dot(vertices_[v], d); s > best_dot) {
+        best = v;
+        best_dot = s;
+      }
+    }
+  }
+  return best;
+}
+
+std::uint32_t ConvexHull::BestFace(const glm::vec3& d, std::uint32_t v) const {
+  auto best = vertex_faces_[vertex_face_start_[v]];
+  for (auto k = vertex_face_start_[v] + 1; k < vertex_face_start_[v + 1];
+       ++k) {
+    const auto f = vertex_faces_[k];
+    if (dot(faces_[f].n, d) > dot(faces_[best].n, d)) best = f;
+  }
+  return best;
+}
+
+bool ConvexHull::IsConsistent() const {
+  const auto n = vertices_.size();
+  if (n == 0 || !IsCsr(neighbor_start_, neighbors_, n, n) ||
+      !IsCsr(vertex_face_start_, vertex_faces_, n, faces_.size()) ||
+      !std::all_of(face_vertices_.begin(), face_vertices_.end(),
+                   [&](std::uint32_t v) { return v < n; })) {
+    return false;
+  }
+  for (size_t v = 0; v < n; ++v) {
+    if (vertex_face_start_[v] == vertex_face_start_[v + 1]) return false;
+  }
+  return std::all_of(faces_.begin(), faces_.end(), [&](const Face& f) {
+    return f.count > 0 && f.first <= face_vertices_.size() &&
+           f.count <= face_vertices_.size() - f.first;
+  });
+}
+
+void ConvexHull::Save(const std::vector<const ConvexHull*>& hulls,
+                      Checkpoint& checkpoint) {
+  ConvexHull all;
+  std::vector<HullRecord> records;
+  for (const auto hull : hulls) {
+    HullRecord record{};
+    record.volume = hull->volume_;
+    record.inertia = hull->inertia_;
+    record.lo = hull->lo_;
+    record.hi = hull->hi_;
+    record.radius = hull->radius_;
+    record.centroid = hull->centroid_;
+    record.frame = hull->frame_;
+    auto i = 0;
+    ForEachArray(all, *hull, [&](const char*, auto& to, const auto& from) {
+      record.sizes[i++] = std::uint32_t(from.size());
+      to.insert(to.end(), from.begin(), from.end());
+    });
+    records.push_back(record);
+  }
+  checkpoint.Add("hulls", std::move(records));
+  ForEachArray(all, all, [&](const char* tag, auto& to, const auto&) {
+    checkpoint.Add(tag, std::move(to));
+  });
+}
+
+bool ConvexHull::Load(const CheckpointFile& file,
+                      std::vector<std::shared_ptr<const ConvexHull>>& hulls) {
+  size_t count;
+  const auto records = file.Get<HullRecord>("hulls", count);
+  if (!records) return false;
+
+  hulls.clear();
+  size_t offsets[7] = {};
+  auto ok = true;
+  for (size_t h = 0; ok && h < count; ++h) {
+    const auto& record = records[h];
+    auto hull = std::make_shared<ConvexHull>();
+    auto i = 0;
+    ForEachArray(*hull, *hull, [&](const char* tag, auto& to, const auto&) {
+      using T = typename std::decay_t<decltype(to)>::value_type;
+      size_t size;
+      const auto data = ok ? file.Get<T>(tag, size) : nullptr;
+      const auto offset = offsets[i], n = size_t(record.sizes[i]);
+      ok = data && offset + n <= size;
+      if (ok) to.assign(data + offset, data + offset + n);
+      offsets[i++] += n;
+    });
+    hull->volume_ = record.volume;
+    hull->inertia_ = record.inertia;
+    hull->lo_ = record.lo;
+    hull->hi_ = record.hi;
+    hull->radius_ = record.radius;
+    hull->centroid_ = record.centroid;
+    hull->frame_ = record.frame;
+    if (ok && !hull->IsConsistent()) {
+      std::cerr << "Inconsistent convex hull in checkpoint" << std::endl;
+      ok = false;
+    }
+    hulls.push_back(std::move(hull));
+  }
+  return ok;
+}
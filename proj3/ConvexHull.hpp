@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+
+class Checkpoint;
+class CheckpointFile;
+
+/**
+ * Convex hull of a point cloud, in its principal frame
+ *
+ * Built incrementally, coplanar triangles are then merged into convex
+ * polygon faces. The hull is moved so its centroid is at the origin and its
+ * principal axes of inertia are the coordinate axes, so a body using it
+ * keeps a diagonal inertia tensor. GetFrame() maps back to the input points.
+ *
+ * Support() climbs the vertex graph from a starting vertex instead of
+ * testing every vertex. Started from the previous step's answer it takes a
+ * few moves at most, whatever the size of the hull.
+ */
+class ConvexHull {
+public:
+  struct Face {
+    glm::vec3 n;  // Outward unit normal
+    float d;      // dot(n, p) for p on the face
+    std::uint32_t first, count;  // Into face_vertices_, counter-clockwise
+  };
+
+  ConvexHull() = default;
+
+  /**
+   * At least 4 points not all on one plane, otherwise the hull is empty
+   */
+  explicit ConvexHull(const std::vector<glm::vec3>& points);
+
+  bool Empty() const { return vertices_.empty(); }
+
+  const std::vector<glm::vec3>& GetVertices() const { return vertices_; }
+  const std::vector<Face>& GetFaces() const { return faces_; }
+  const std::uint32_t* FaceVertices(const Face& f) const {
+    return face_vertices_.data() + f.first;
+  }
+
+  /**
+   * Vertex furthest along d, climbing from vertex start
+   */
+  std::uint32_t Support(const glm::vec3& d, std::uint32_t start = 0) const;
+
+  const std::uint32_t* NeighborsBegin(std::uint32_t v) const {
+    return neighbors_.data() + neighbor_start_[v];
+  }
+  const std::uint32_t* NeighborsEnd(std::uint32_t v) const {
+    return neighbors_.data() + neighbor_start_[v + 1];
+  }
+
+  /**
+   * Face whose normal is closest to d, among those around vertex v
+   * v should be Support(d), which always touches that face.
+   */
+  std::uint32_t BestFace(const glm::vec3& d, std::uint32_t v) const;
+
+  float GetVolume() const { return volume_; }
+
+  /**
+   * Principal moments of inertia for the given mass, uniform density
+   */
+  glm::vec3 GetInertia(float mass) const { return mass * inertia_; }
+
+  /**
+   * Bounds in the principal frame, the centroid is not their center
+   */
+  glm::vec3 GetLower() const { return lo_; }
+  glm::vec3 GetUpper() const { return hi_; }
+  float GetRadius() const { return radius_; }
+
+  /**
+   * Input point p is at GetCentroid() + GetFrame() * q for q in the hull
+   */
+  glm::vec3 GetCentroid() const { return centroid_; }
+  glm::mat3 GetFrame() const { return frame_; }
+
+  /**
+   * Hulls in the same few sections of a checkpoint, Load() restores them
+   * exactly as they were instead of building them again
+   */
+  static void Save(const std::vector<const ConvexHull*>& hulls,
+                   Checkpoint& checkpoint);
+  static bool Load(const CheckpointFile& file,
+                   std::vector<std::shared_ptr<const ConvexHull>>& hulls);
+
+private:
+  /**
+   * Whether every index of the arrays is in range and every vertex has a
+   * face, as Support() and BestFace() rely on without checking
+   */
+  bool IsConsistent() const;
+
+  // f(tag, array of a, same array of b) for every array
+  template <typename F>
+  static void ForEachArray(ConvexHull& a, const ConvexHull& b, F f) {
+    f("hvert", a.vertices_, b.vertices_);
+    f("hnstart", a.neighbor_start_, b.neighbor_start_);
+    f("hneigh", a.neighbors_, b.neighbors_);
+    f("hvfstart", a.vertex_face_start_, b.vertex_face_start_);
+    f("hvfaces", a.vertex_faces_, b.vertex_faces_);
+    f("hfaces", a.faces_, b.faces_);
+    f("hfverts", a.face_vertices_, b.face_vertices_);
+  }
+
+  std::vector<glm::vec3> vertices_;
+  std::vector<std::uint32_t> neighbor_start_, neighbors_;  // CSR adjacency
+  std::vector<std::uint32_t> vertex_face_start_, vertex_faces_;
+  std::vector<Face> faces_;
+  std::vector<std::uint32_t> face_vertices_;
+
+  float volume_ = 0.f;
+  glm::vec3 inertia_{0.f};  // Per unit mass
+  glm::vec3 lo_{0.f}, hi_{0.f};
+  float radius_ = 0.f;
+
+  glm::vec3 centroid_{0.f};
+  glm::mat3 frame_{1.f};
+};
@@ -0,0 +1,44 @@
+#include "Islands.hpp"
+
+#include <utility>
+
+void Islands::Build(size_t bodies, const std::vector<Manifold>& manifolds) {
+  parent_.resize(bodies);
+  size_.assign(bodies, 1);
+  for (std::uint32_t i = 0; i < bodies; ++i) parent_[i] = i;
+
+  // Union by size
+  for (const auto& m : manifolds) {
+    if (m.b == Manifold::kGround) continue;
+    auto a = Find(m.a), b = Find(m.b);
+    if (a == b) continue;
+    if (size_[a] < size_[b]) std::swap(a, b);
+    parent_[b] = a;
+    size_[a] += size_[b];
+  }
+
+  // Number the roots, then counting sort the bodies by island
+  island_.resize(bodies);
+  start_.assign(1, 0);
+  for (std::uint32_t i = 0; i < bodies; ++i) {
+    if (Find(i) != i) continue;
+    island_[i] = std::uint32_t(start_.size() - 1);
+    start_.push_back(start_.back() + size_[i]);
+  }
+  // Sizes are no longer needed, reuse them as fill pointers
+  size_.assign(start_.begin(), start_.end() - 1);
+  bodies_.resize(bodies);
+  for (std::uint32_t i = 0; i < bodies; ++i) {
+    island_[i] = island_[Find(i)];
+    bodies_[size_[island_[i]]++] = i;
+  }
+}
+
+std::uint32_t Islands::Find(std::uint32_t i) {
+  // Path halving
+  while (parent_[i] != i) {
+    parent_[i] = parent_[parent_[i]];
+    i = parent_[i];
+  }
+  return i;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Contact.hpp"
+
+/**
+ * Connected components of the contact graph, found by union-find
+ *
+ * The ground is static and does not connect the bodies resting on it.
+ * Bodies of an island are stored contiguously.
+ */
+class Islands {
+public:
+  void Build(size_t bodies, const std::vector<Manifold>& manifolds);
+
+  size_t Count() const { return start_.size() - 1; }
+
+  std::uint32_t GetIsland(std::uint32_t body) const { return island_[body]; }
+
+  const std::uint32_t* begin(size_t island) const {
+    return bodies_.data() + start_[island];
+  }
+  const std::uint32_t* end(size_t island) const {
+    return bodies_.data() + start_[island + 1];
+  }
+
+private:
+  std::uint32_t Find(std::uint32_t i);
+
+  std::vector<std::uint32_t> parent_, size_;
+  std::vector<std::uint32_t> island_;
+  std::vector<std::uint32_t> bodies_, start_{0};
+};
@@ -0,0 +1,595 @@
+#include "Narrowphase.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <iostream>
+
+#include "Checkpoint.hpp"
+
+using namespace glm;
+
+namespace {
+// Pairs tested together by the SoA SAT, one per SIMD lane
+constexpr int kLanes = 8;
+
+// Prefer face contacts over edges unless clearly worse
+constexpr float kRelativeTolerance = .95f, kAbsoluteTolerance = .01f;
+
+// Contacts whose feature ID changed still take the impulse of an old one
+// this close, under a normal within about 8 degrees
+constexpr float kMatchDistance = .05f, kMatchCosine = .99f;
+
+// Whether every index of the arrays of a checkpoint is in range, as
+// Update() and GJK rely on without checking
+bool IsConsistent(const std::vector<Manifold>& manifolds,
+                  const std::vector<std::uint64_t>& keys,
+                  const std::vector<SimplexCache>& simplices,
+                  const std::vector<std::uint32_t>& ground_hints,
+                  const std::vector<std::uint32_t>& vertices) {
+  const auto bodies = vertices.size();
+  for (const auto& m : manifolds) {
+    if (m.a >= bodies || (m.b >= bodies && m.b != Manifold::kGround) ||
+        m.count < 0 || m.count > 4) {
+      return false;
+    }
+  }
+  if (!std::is_sorted(keys.begin(), keys.end())) return false;
+  for (size_t k = 0; k < keys.size(); ++k) {
+    const auto a = keys[k] >> 32, b = keys[k] & 0xFFFFFFFF;
+    const auto& cache = simplices[k];
+    if (a >= bodies || b >= bodies || cache.count < 0 || cache.count > 4 ||
+        cache.hint_a >= vertices[a] || cache.hint_b >= vertices[b]) {
+      return false;
+    }
+    for (int i = 0; i < cache.count; ++i) {
+      if (cache.a[i] >= vertices[a] || cache.b[i] >= vertices[b]) {
+        return false;
+      }
+    }
+  }
+  if (ground_hints.size() > bodies) return false;
+  for (size_t i = 0; i < ground_hints.size(); ++i) {
+    if (ground_hints[i] >= vertices[i]) return false;
+  }
+  return true;
+}
+
+struct Lanes {
+  void Set(int l, const OBB& box) {
+    for (int i = 0; i < 3; ++i) {
+      c[i][l] = box.c[i];
+      e[i][l] = box.e[i];
+      for (int k = 0; k < 3; ++k) R[i][k][l] = box.R[i][k];
+    }
+  }
+
+  float c[3][kLanes];
+  float R[3][3][kLanes];  // [axis][component]
+  float e[3][kLanes];
+};
+
+/**
+ * Same as Separation(), kLanes pairs at once
+ * Every loop runs over lanes innermost so it compiles to vector code
+ */
+void SeparationLanes(const Lanes& a, const Lanes& b, float (&sep)[kLanes]) {
+  float d[3][kLanes], T[3][kLanes];
+  float C[3][3][kLanes], A[3][3][kLanes];  // a's axis i dot b's axis j
+  for (int k = 0; k < 3; ++k) {
+    for (int l = 0; l < kLanes; ++l) d[k][l] = b.c[k][l] - a.c[k][l];
+  }
+  for (int i = 0; i < 3; ++i) {
+    for (int l = 0; l < kLanes; ++l) {
+      T[i][l] = a.R[i][0][l] * d[0][l] + a.R[i][1][l] * d[1][l] +
+                a.R[i][2][l] * d[2][l];
+    }
+    for (int j = 0; j < 3; ++j) {
+      for (int l = 0; l < kLanes; ++l) {
+        C[i][j][l] = a.R[i][0][l] * b.R[j][0][l] +
+                     a.R[i][1][l] * b.R[j][1][l] + a.R[i][2][l] * b.R[j][2][l];
+        A[i][j][l] = std::abs(C[i][j][l]) + 1E-6f;
+      }
+    }
+  }
+
+  for (int l = 0; l < kLanes; ++l) sep[l] = -FLT_MAX;
+
+  // Face axes of a, then of b
+  for (int i = 0; i < 3; ++i) {
+    for (int l = 0; l < kLanes; ++l) {
+      const auto s = std::abs(T[i][l]) -
+                     (a.e[i][l] + b.e[0][l] * A[i][0][l] +
+                      b.e[1][l] * A[i][1][l] + b.e[2][l] * A[i][2][l]);
+      sep[l] = std::max(sep[l], s);
+    }
+  }
+  for (int j = 0; j < 3; ++j) {
+    for (int l = 0; l < kLanes; ++l) {
+      const auto t =
+          T[0][l] * C[0][j][l] + T[1][l] * C[1][j][l] + T[2][l] * C[2][j][l];
+      const auto s = std::abs(t) - (a.e[0][l] * A[0][j][l] +
+                                    a.e[1][l] * A[1][j][l] +
+                                    a.e[2][l] * A[2][j][l] + b.e[j][l]);
+      sep[l] = std::max(sep[l], s);
+    }
+  }
+
+  // Cross products of edges, normalized so the separation is a distance
+  for (int i = 0; i < 3; ++i) {
+    const auto i1 = (i + 1) % 3, i2 = (i + 2) % 3;
+    for (int j = 0; j < 3; ++j) {
+      const auto j1 = (j + 1) % 3, j2 = (j + 2) % 3;
+      for (int l = 0; l < kLanes; ++l) {
+        const auto ra = a.e[i1][l] * A[i2][j][l] + a.e[i2][l] * A[i1][j][l];
+        const auto rb = b.e[j1][l] * A[i][j2][l] + b.e[j2][l] * A[i][j1][l];
+        const auto t = std::abs(T[i2][l] * C[i1][j][l] - T[i1][l] * C[i2][j][l]);
+        const auto length2 = 1.f - C[i][j][l] * C[i][j][l];
+        // Parallel edges give no axis
+        const auto s = length2 > 1E-6f
+                           ? (t - ra - rb) / std::sqrt(std::max(length2, 1E-6f))
+                           : -FLT_MAX;
+        sep[l] = std::max(sep[l], s);
+      }
+    }
+  }
+}
+
+struct SatResult {
+  float face_a = -FLT_MAX, face_b = -FLT_MAX, edge = -FLT_MAX;
+  int axis_a = 0, axis_b = 0, edge_a = 0, edge_b = 0;
+  vec3 edge_n{0.f};
+};
+
+SatResult Sat(const OBB& a, const OBB& b) {
+  SatResult r;
+  const auto d = b.c - a.c;
+  vec3 T;
+  mat3 C, A;  // C[i][j]: a's axis i dot b's axis j
+  for (int i = 0; i < 3; ++i) {
+    T[i] = dot(a.R[i], d);
+    for (int j = 0; j < 3; ++j) {
+      C[i][j] = dot(a.R[i], b.R[j]);
+      A[i][j] = std::abs(C[i][j]) + 1E-6f;
+    }
+  }
+
+  for (int i = 0; i < 3; ++i) {
+    const auto s = std::abs(T[i]) -
+                   (a.e[i] + b.e[0] * A[i][0] + b.e[1] * A[i][1] +
+                    b.e[2] * A[i][2]);
+    if (s > r.face_a) {
+      r.face_a = s;
+      r.axis_a = i;
+    }
+  }
+  for (int j = 0; j < 3; ++j) {
+    const auto s = std::abs(dot(b.R[j], d)) -
+                   (a.e[0] * A[0][j] + a.e[1] * A[1][j] + a.e[2] * A[2][j] +
+                    b.e[j]);
+    if (s > r.face_b) {
+      r.face_b = s;
+      r.axis_b = j;
+    }
+  }
+  for (int i = 0; i < 3; ++i) {
+    const auto i1 = (i + 1) % 3, i2 = (i + 2) % 3;
+    for (int j = 0; j < 3; ++j) {
+      const auto j1 = (j + 1) % 3, j2 = (j + 2) % 3;
+      const auto length2 = 1.f - C[i][j] * C[i][j];
+      if (length2 <= 1E-6f) continue;
+      const auto ra = a.e[i1] * A[i2][j] + a.e[i2] * A[i1][j];
+      const auto rb = b.e[j1] * A[i][j2] + b.e[j2] * A[i][j1];
+      const auto t = std::abs(T[i2] * C[i1][j] - T[i1] * C[i2][j]);
+      const auto s = (t - ra - rb) / std::sqrt(length2);
+      if (s > r.edge) {
+        r.edge = s;
+        r.edge_a = i;
+        r.edge_b = j;
+      }
+    }
+  }
+  if (r.edge > -FLT_MAX) {
+    r.edge_n = normalize(cross(a.R[r.edge_a], b.R[r.edge_b]));
+    if (dot(r.edge_n, d) < 0) r.edge_n = -r.edge_n;
+  }
+  return r;
+}
+
+struct ClipVertex {
+  vec3 p;
+  std::uint32_t key;
+};
+
+/**
+ * Sutherland-Hodgman against the plane dot(m, p) = d, keeping the negative side
+ */
+int ClipPlane(const ClipVertex* in, int n, const vec3& m, float d, int plane,
+              ClipVertex* out) {
+  auto k = 0;
+  for (int i = 0; i < n; ++i) {
+    const auto& v1 = in[i];
+    const auto& v2 = in[(i + 1) % n];
+    const auto d1 = dot(m, v1.p) - d, d2 = dot(m, v2.p) - d;
+    if (d1 <= 0) out[k++] = v1;
+    if ((d1 <= 0) != (d2 <= 0)) {
+      // Named after the clip plane and the edge it cuts
+      const auto lo = std::min(v1.key, v2.key) & 0x3F,
+                 hi = std::max(v1.key, v2.key) & 0x3F;
+      out[k++] = {v1.p + d1 / (d1 - d2) * (v2.p - v1.p),
+                  std::uint32_t(plane + 1) << 12 | lo << 6 | hi};
+    }
+  }
+  return k;
+}
+
+/**
+ * Clip the incident box's face against a face of the reference box
+ * n points from the reference box towards the incident one
+ */
+bool FaceContact(const OBB& ref, int axis, const vec3& n, const OBB& inc,
+                 bool flip, float margin, Manifold& m) {
+  // Incident face is the one most anti-parallel to n
+  auto j = 0;
+  for (int k = 1; k < 3; ++k) {
+    if (std::abs(dot(inc.R[k], n)) > std::abs(dot(inc.R[j], n))) j = k;
+  }
+  const auto inc_sign = dot(inc.R[j], n) > 0 ? -1.f : 1.f;
+  const auto u = (j + 1) % 3, v = (j + 2) % 3;
+  const auto center = inc.c + inc_sign * inc.e[j] * inc.R[j];
+  const auto eu = inc.e[u] * inc.R[u], ev = inc.e[v] * inc.R[v];
+
+  ClipVertex buffers[2][8] = {{{center + eu + ev, 0},
+                               {center - eu + ev, 1},
+                               {center - eu - ev, 2},
+                               {center + eu - ev, 3}}};
+  auto count = 4, current = 0;
+
+  // Side planes of the reference face
+  const auto ru = (axis + 1) % 3, rv = (axis + 2) % 3;
+  const vec3 normals[4] = {ref.R[ru], -ref.R[ru], ref.R[rv], -ref.R[rv]};
+  const float extents[4] = {ref.e[ru], ref.e[ru], ref.e[rv], ref.e[rv]};
+  for (int p = 0; p < 4 && count > 0; ++p) {
+    count = ClipPlane(buffers[current], count, normals[p],
+                      dot(normals[p], ref.c) + extents[p], p,
+                      buffers[1 - current]);
+    current = 1 - current;
+  }
+
+  const auto ref_face = std::uint32_t(axis * 2 + (dot(ref.R[axis], n) > 0));
+  const auto inc_face = std::uint32_t(j * 2 + (inc_sign > 0));
+  const auto face = dot(n, ref.c) + ref.e[axis];
+  Contact contacts[8];
+  auto n_contacts = 0;
+  for (int i = 0; i < count; ++i) {
+    const auto& p = buffers[current][i];
+    const auto s = dot(n, p.p) - face;
+    if (s > margin) continue;
+    contacts[n_contacts++] = {
+        p.p - n * s / 2.f, -s,
+        std::uint32_t(flip) << 28 | ref_face << 25 | inc_face << 22 | p.key};
+  }
+  if (n_contacts == 0) return false;
+
+  m.n = flip ? -n : n;
+  Reduce(contacts, n_contacts, n, m);
+  return true;
+}
+
+/**
+ * Closest points of the crossing edges
+ */
+bool EdgeContact(const OBB& a, const OBB& b, const SatResult& sat, Manifold& m) {
+  const auto& n = sat.edge_n;
+  const auto i = sat.edge_a, j = sat.edge_b;
+
+  // Supporting edges, named by the signs of the other two axes
+  auto pa = a.c, pb = b.c;
+  std::uint32_t id_a = 0, id_b = 0;
+  for (int k = 1; k < 3; ++k) {
+    const auto ka = (i + k) % 3, kb = (j + k) % 3;
+    const auto sa = dot(n, a.R[ka]) > 0, sb = dot(n, b.R[kb]) < 0;
+    pa += (sa ? 1.f : -1.f) * a.e[ka] * a.R[ka];
+    pb += (sb ? 1.f : -1.f) * b.e[kb] * b.R[kb];
+    id_a |= std::uint32_t(sa) << (k - 1);
+    id_b |= std::uint32_t(sb) << (k - 1);
+  }
+
+  const auto& da = a.R[i];
+  const auto& db = b.R[j];
+  const auto r = pa - pb;
+  const auto d = dot(da, db), c = dot(da, r), f = dot(db, r);
+  const auto denominator = 1.f - d * d;
+  auto s = denominator > 1E-6f ? (d * f - c) / denominator : 0.f;
+  s = clamp(s, -a.e[i], a.e[i]);
+  const auto t = clamp(d * s + f, -b.e[j], b.e[j]);
+  s = clamp(d * t - c, -a.e[i], a.e[i]);
+
+  m.n = n;
+  m.count = 1;
+  m.contacts[0] = {(pa + s * da + pb + t * db) / 2.f, -sat.edge,
+                   1U << 29 | (i * 4 + id_a) << 8 | (j * 4 + id_b)};
+  return true;
+}
+}  // namespace
+
+void Reduce(const Contact* in, int n, const vec3& normal, Manifold& m) {
+  if (n <= 4) {
+    std::copy(in, in + n, m.contacts.begin());
+    m.count = n;
+    return;
+  }
+
+  int chosen[4];
+  chosen[0] = 0;
+  for (int i = 1; i < n; ++i) {
+    if (in[i].depth > in[chosen[0]].depth) chosen[0] = i;
+  }
+  const auto& a = in[chosen[0]].p;
+
+  chosen[1] = chosen[0] == 0 ? 1 : 0;
+  for (int i = 0; i < n; ++i) {
+    if (distance(in[i].p, a) > distance(in[chosen[1]].p, a)) chosen[1] = i;
+  }
+  const auto& b = in[chosen[1]].p;
+
+  auto area = [&](const vec3& p, const vec3& q, const vec3& r) {
+    return dot(cross(q - p, r - p), normal);
+  };
+  auto best = -1.f;
+  chosen[2] = chosen[1];
+  for (int i = 0; i < n; ++i) {
+    if (const auto s = std::abs(area(a, b, in[i].p)); s > best) {
+      best = s;
+      chosen[2] = i;
+    }
+  }
+  const auto& c = in[chosen[2]].p;
+
+  // Fourth point furthest outside the triangle, on the opposite side of c
+  const auto sign = area(a, b, c) >= 0 ? 1.f : -1.f;
+  best = -FLT_MAX;
+  chosen[3] = chosen[2];
+  for (int i = 0; i < n; ++i) {
+    if (i == chosen[0] || i == chosen[1] || i == chosen[2]) continue;
+    const auto& p = in[i].p;
+    const auto outside = -std::min(
+        {sign * area(a, b, p), sign * area(b, c, p), sign * area(c, a, p)});
+    if (outside > best) {
+      best = outside;
+      chosen[3] = i;
+    }
+  }
+
+  m.count = 0;
+  for (const auto i : chosen) m.contacts[m.count++] = in[i];
+}
+
+OBB OBB::FromBody(const RigidBody& rb) {
+  const auto R = rb.GetRotation();
+  if (const auto& hull = rb.hull_) {
+    // Bounds of the hull, which are not centered on its centroid
+    return {rb.GetCenter() + R * (hull->GetLower() + hull->GetUpper()) / 2.f,
+            R, (hull->GetUpper() - hull->GetLower()) / 2.f, hull.get()};
+  }
+  return {rb.GetCenter(), R, rb.size_ / 2.f};
+}
+
+AABB OBB::Bounds() const {
+  const auto extent =
+      abs(R[0]) * e.x + abs(R[1]) * e.y + abs(R[2]) * e.z;
+  return {c - extent, c + extent};
+}
+
+float Separation(const OBB& a, const OBB& b) {
+  const auto sat = Sat(a, b);
+  return std::max({sat.face_a, sat.face_b, sat.edge});
+}
+
+bool CollideBoxes(const OBB& a, const OBB& b, float margin, Manifold& m) {
+  const auto sat = Sat(a, b);
+  const auto face = std::max(sat.face_a, sat.face_b);
+  if (std::max(face, sat.edge) > margin) return false;
+
+  if (kRelativeTolerance * sat.edge > face + kAbsoluteTolerance) {
+    return EdgeContact(a, b, sat, m);
+  } else if (kRelativeTolerance * sat.face_b >
+             sat.face_a + kAbsoluteTolerance) {
+    const auto& axis = b.R[sat.axis_b];
+    return FaceContact(b, sat.axis_b, dot(axis, a.c - b.c) > 0 ? axis : -axis,
+                       a, true, margin, m);
+  } else {
+    const auto& axis = a.R[sat.axis_a];
+    return FaceContact(a, sat.axis_a, dot(axis, b.c - a.c) > 0 ? axis : -axis,
+                       b, false, margin, m);
+  }
+}
+
+bool CollideGround(const OBB& a, float margin, Manifold& m) {
+  Contact contacts[8];
+  auto n = 0;
+  for (std::uint32_t corner = 0; corner < 8; ++corner) {
+    const auto p = a.c +
+                   ((corner & 1) ? 1.f : -1.f) * a.e.x * a.R[0] +
+                   ((corner & 2) ? 1.f : -1.f) * a.e.y * a.R[1] +
+                   ((corner & 4) ? 1.f : -1.f) * a.e.z * a.R[2];
+    if (p.y <= margin) {
+      contacts[n++] = {vec3{p.x, p.y / 2.f, p.z}, -p.y, corner};
+    }
+  }
+  if (n == 0) return false;
+
+  m.n = vec3{0.f, -1.f, 0.f};
+  Reduce(contacts, n, m.n, m);
+  return true;
+}
+
+const std::vector<Manifold>& Narrowphase::Update(
+    const std::vector<OBB>& boxes, const std::vector<Broadphase::Pair>& pairs,
+    const std::vector<char>& asleep) {
+  std::swap(previous_, manifolds_);
+  manifolds_.clear();
+  for (const auto& m : previous_) {
+    if (asleep[m.a] && (m.b == Manifold::kGround || asleep[m.b])) {
+      manifolds_.push_back(m);
+    }
+  }
+
+  awake_.clear();
+  for (const auto& pair : pairs) {
+    if (!asleep[pair.first] || !asleep[pair.second]) awake_.push_back(pair);
+  }
+  Filter(boxes, awake_);
+  std::swap(previous_caches_, caches_);
+  caches_.clear();
+  for (const auto k : touching_) {
+    Manifold m;
+    m.a = awake_[k].first;
+    m.b = awake_[k].second;
+    const auto& a = boxes[m.a];
+    const auto& b = boxes[m.b];
+    if (!a.hull && !b.hull) {
+      if (CollideBoxes(a, b, margin_, m)) manifolds_.push_back(m);
+      continue;
+    }
+    auto cache = FindCache(m.Key());
+    if (CollideConvex(ConvexShape::FromBox(a), ConvexShape::FromBox(b),
+                      margin_, cache, m)) {
+      manifolds_.push_back(m);
+    }
+    caches_.emplace_back(m.Key(), cache);
+  }
+  std::sort(caches_.begin(), caches_.end(),
+            [](const auto& a, const auto& b) { return a.first < b.first; });
+
+  ground_hints_.resize(boxes.size(), 0);
+  for (std::uint32_t i = 0; i < boxes.size(); ++i) {
+    if (asleep[i]) continue;
+    Manifold m;
+    m.a = i;
+    m.b = Manifold::kGround;
+    const auto touching =
+        boxes[i].hull ? CollideGroundConvex(ConvexShape::FromBox(boxes[i]),
+                                            margin_, ground_hints_[i], m)
+                      : CollideGround(boxes[i], margin_, m);
+    if (touching) manifolds_.push_back(m);
+  }
+  std::sort(
+      manifolds_.begin(), manifolds_.end(),
+      [](const Manifold& a, const Manifold& b) { return a.Key() < b.Key(); });
+
+  WarmStart();
+  return manifolds_;
+}
+
+void Narrowphase::Filter(const std::vector<OBB>& boxes,
+                         const std::vector<Broadphase::Pair>& pairs) {
+  touching_.clear();
+  Lanes a, b;
+  float sep[kLanes];
+  for (size_t base = 0; base < pairs.size(); base += kLanes) {
+    const auto n = int(std::min<size_t>(kLanes, pairs.size() - base));
+    // Unused lanes repeat the last pair
+    for (int l = 0; l < kLanes; ++l) {
+      const auto& pair = pairs[base + std::min(l, n - 1)];
+      a.Set(l, boxes[pair.first]);
+      b.Set(l, boxes[pair.second]);
+    }
+    SeparationLanes(a, b, sep);
+    for (int l = 0; l < n; ++l) {
+      if (sep[l] <= margin_) touching_.push_back(std::uint32_t(base + l));
+    }
+  }
+}
+
+SimplexCache Narrowphase::FindCache(std::uint64_t key) const {
+  const auto it = std::lower_bound(
+      previous_caches_.begin(), previous_caches_.end(), key,
+      [](const auto& entry, std::uint64_t key) { return entry.first < key; });
+  return it != previous_caches_.end() && it->first == key ? it->second
+                                                          : SimplexCache{};
+}
+
+void Narrowphase::WarmStart() {
+  // Both lists are sorted by key
+  size_t k = 0;
+  for (auto& m : manifolds_) {
+    while (k < previous_.size() && previous_[k].Key() < m.Key()) ++k;
+    if (k == previous_.size()) break;
+    const auto& old = previous_[k];
+    if (old.Key() != m.Key()) continue;
+
+    // By feature ID first. Corners of faces flush with each other sit right
+    // on the clipping planes, so their IDs flip as clipping rounds either
+    // way; those take the closest old contact left, as long as the normal
+    // held. Carrying only part of a manifold's impulse rocks stacks.
+    int match[4] = {-1, -1, -1, -1};
+    bool used[4] = {};
+    for (int i = 0; i < m.count; ++i) {
+      for (int j = 0; j < old.count; ++j) {
+        if (!used[j] && old.contacts[j].id == m.contacts[i].id) {
+          match[i] = j;
+          used[j] = true;
+          break;
+        }
+      }
+    }
+    if (dot(old.n, m.n) > kMatchCosine) {
+      for (int i = 0; i < m.count; ++i) {
+        if (match[i] >= 0) continue;
+        auto closest = kMatchDistance * kMatchDistance;
+        for (int j = 0; j < old.count; ++j) {
+          const auto d = old.contacts[j].p - m.contacts[i].p;
+          if (!used[j] && dot(d, d) < closest) {
+            closest = dot(d, d);
+            match[i] = j;
+          }
+        }
+        if (match[i] >= 0) used[match[i]] = true;
+      }
+    }
+
+    for (int i = 0; i < m.count; ++i) {
+      if (match[i] < 0) continue;
+      m.contacts[i].j_n = old.contacts[match[i]].j_n;
+      m.contacts[i].j_t = old.contacts[match[i]].j_t;
+    }
+  }
+}
+
+void Narrowphase::Save(Checkpoint& checkpoint) const {
+  // std::pair is not plain data, keys and simplices go apart
+  std::vector<std::uint64_t> keys;
+  std::vector<SimplexCache> simplices;
+  for (const auto& c : caches_) {
+    keys.push_back(c.first);
+    simplices.push_back(c.second);
+  }
+  checkpoint.Add("manifold", manifolds_);
+  checkpoint.Add("cachekey", std::move(keys));
+  checkpoint.Add("simplex", std::move(simplices));
+  checkpoint.Add("ghints", ground_hints_);
+}
+
+bool Narrowphase::Load(const CheckpointFile& file,
+                       const std::vector<std::uint32_t>& vertices) {
+  std::vector<Manifold> manifolds;
+  std::vector<std::uint64_t> keys;
+  std::vector<SimplexCache> simplices;
+  std::vector<std::uint32_t> ground_hints;
+  if (!file.Read("manifold", manifolds) || !file.Read("cachekey", keys) ||
+      !file.Read("simplex", simplices) || keys.size() != simplices.size() ||
+      !file.Read("ghints", ground_hints)) {
+    return false;
+  }
+  if (!IsConsistent(manifolds, keys, simplices, ground_hints, vertices)) {
+    std::cerr << "Inconsistent contacts in checkpoint" << std::endl;
+    return false;
+  }
+  Clear();
+  manifolds_ = std::move(manifolds);
+  for (size_t i = 0; i < keys.size(); ++i) {
+    caches_.emplace_back(keys[i], simplices[i]);
+  }
+  ground_hints_ = std::move(ground_hints);
+  return true;
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "Broadphase.hpp"
+#include "Contact.hpp"
+#include "ConvexCollision.hpp"
+#include "RigidBody.hpp"
+
+class Checkpoint;
+class CheckpointFile;
+
+struct OBB {
+  static OBB FromBody(const RigidBody& rb);
+
+  AABB Bounds() const;
+
+  glm::vec3 c;  // Center
+  glm::mat3 R;  // Columns are the box axes
+  glm::vec3 e;  // Half extents
+
+  const ConvexHull* hull = nullptr;  // Inside the box, if not a plain box
+};
+
+/**
+ * Largest separation along the 15 SAT axes, negative when overlapping
+ * Never more than the distance between the boxes
+ */
+float Separation(const OBB& a, const OBB& b);
+
+/**
+ * Box-box contact from the SAT axis of least penetration
+ * Faces are clipped against each other for up to 4 points, crossing edges
+ * give 1. Contacts are kept up to margin apart.
+ */
+bool CollideBoxes(const OBB& a, const OBB& b, float margin, Manifold& m);
+
+/**
+ * Corners of the box below y = margin
+ */
+bool CollideGround(const OBB& a, float margin, Manifold& m);
+
+/**
+ * Keep the deepest point and the 3 spanning the largest area with it
+ */
+void Reduce(const Contact* in, int n, const glm::vec3& normal, Manifold& m);
+
+class Narrowphase {
+public:
+  /**
+   * Manifolds of the touching pairs and of boxes touching the ground, sorted
+   * by Key(). Impulses of contacts whose feature persists from the previous
+   * step are carried over.
+   * Boxes flagged in asleep have not moved, manifolds among them only are
+   * kept from the previous step instead of recomputed.
+   * Pairs with a hull go through GJK, warm started from their previous
+   * simplex.
+   */
+  const std::vector<Manifold>& Update(const std::vector<OBB>& boxes,
+                                      const std::vector<Broadphase::Pair>& pairs,
+                                      const std::vector<char>& asleep);
+
+  void Clear() {
+    manifolds_.clear();
+    previous_.clear();
+    caches_.clear();
+    ground_hints_.clear();
+  }
+
+  const std::vector<Manifold>& GetManifolds() const { return manifolds_; }
+  std::vector<Manifold>& GetManifolds() { return manifolds_; }
+
+  /**
+   * What the next Update() carries over: manifolds, GJK simplices and
+   * ground hints
+   * Load() refuses indices beyond the bodies, vertices has each body's
+   * vertex count, 8 corners for a box.
+   */
+  void Save(Checkpoint& checkpoint) const;
+  bool Load(const CheckpointFile& file,
+            const std::vector<std::uint32_t>& vertices);
+
+  float margin_ = .01f;
+
+private:
+  /**
+   * SAT on batches of pairs in SoA lanes, keeps those possibly in contact
+   */
+  void Filter(const std::vector<OBB>& boxes,
+              const std::vector<Broadphase::Pair>& pairs);
+
+  /**
+   * Impulses of last step's contacts, matched by feature ID or else position
+   */
+  void WarmStart();
+
+  /**
+   * Of the pair in the previous step, or a new one
+   */
+  SimplexCache FindCache(std::uint64_t key) const;
+
+  std::vector<Broadphase::Pair> awake_;  // Pairs with a box awake
+  std::vector<std::uint32_t> touching_;  // Indices into awake_
+  std::vector<Manifold> manifolds_, previous_;
+
+  // Of hull pairs by key, and lowest vertex of each hull
+  std::vector<std::pair<std::uint64_t, SimplexCache>> caches_,
+      previous_caches_;
+  std::vector<std::uint32_t> ground_hints_;
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <vector>
+
+#include "RigidBody.hpp"
+
+/**
+ * Many independent boxes that only collide with the y = 0 ground, stepped
+ * Lanes at a time, e.g. for Monte Carlo studies of tumbling
+ *
+ * State is stored as SoA groups of Lanes bodies and every loop runs over the
+ * lanes innermost, so each step compiles to vector code without branches.
+ * Free motion is the same as RigidBody's: symplectic Euler with the rotation
+ * split about the principal axes. Every corner below the ground is a
+ * contact, solved with sequential impulses like ContactSolver: restitution
+ * above a threshold, friction clamped by the normal impulse and a Baumgarte
+ * bias for penetration. There is no warm starting.
+ */
+template <int Lanes>
+class RigidBatch {
+public:
+  void Add(const RigidBody& rb);
+
+  void Clear();
+
+  size_t Size() const { return size_; }
+
+  void Step(float dt);
+
+  glm::vec3 GetCenter(size_t i) const;
+  glm::vec3 GetLinearVelocity(size_t i) const;
+  glm::quat GetAttitude(size_t i) const;
+  glm::vec3 GetAngularMomentum(size_t i) const;
+  float GetKineticEnergy(size_t i) const;
+
+  static constexpr int kLanes = Lanes;
+
+  glm::vec3 gravity_{0.f, -9.8f, 0.f};
+  int iterations_ = 8;
+  float eps_{.5f}, mu_{.5f};  // Restitution and friction
+  float baumgarte_ = .2f, slop_ = .005f;
+  float bounce_threshold_ = .5f;  // No restitution below this speed
+
+private:
+  struct Group {
+    float c[3][Lanes], v[3][Lanes];
+    float q[4][Lanes];  // w, x, y, z
+    float L[3][Lanes];  // World space angular momentum
+    float inv_I[3][Lanes], e[3][Lanes], inv_m[Lanes];
+  };
+
+  void Collide(Group& g, float dt) const;
+
+  void Integrate(Group& g, float dt) const;
+
+  std::vector<Group> groups_;
+  size_t size_ = 0;
+};
+
+using RigidBatch8 = RigidBatch<8>;
+using RigidBatch16 = RigidBatch<16>;
@@ -1,31 +1,137 @@
 #include "RigidBody.hpp"
 
-#include <glm/gtx/matrix_interpolation.hpp>
+#include <cmath>
 #include <glm/gtx/transform.hpp>
+#include <iostream>
 
 using namespace glm;
 
+namespace {
+/**
+ * Exact torque-free flow about body axis i for dt
+ * Rotates the attitude by the angle swept about the axis and the body space
+ * momentum back by the same angle, so the world momentum does not change.
+ */
+void RotateAbout(int i, float dt, const vec3& inv_I, quat& q, vec3& L) {
+  const auto theta = dt * inv_I[i] * L[i];
+  const auto c = std::cos(theta / 2), s = std::sin(theta / 2);
+  auto axis = vec3{0.f};
+  axis[i] = s;
+  q = q * quat(c, axis);
+
+  // Rotate the other two components by -theta, via the double angle
+  const auto j = (i + 1) % 3, k = (i + 2) % 3;
+  const auto cos_theta = c * c - s * s, sin_theta = 2 * s * c;
+  const auto l_j = L[j], l_k = L[k];
+  L[j] = cos_theta * l_j + sin_theta * l_k;
+  L[k] = -sin_theta * l_j + cos_theta * l_k;
+}
+}  // namespace
+
 RigidBody::RigidBody(const glm::vec3& center, const glm::mat3& attitude,
                      const glm::vec3& L, const glm::vec3& size, float mass)
-    : r_{center}, A_(attitude), L_(L), size_{size}, m_{mass} {
-  I_ = mat3{0.f};
-  I_[0][0] = m_ / 12 * (pow(size[1], 2.f) + pow(size[2], 2.f));
-  I_[1][1] = m_ / 12 * (pow(size[0], 2.f) + pow(size[2], 2.f));
-  I_[2][2] = m_ / 12 * (pow(size[0], 2.f) + pow(size[1], 2.f));
+    : size_{size},
+      m_{mass},
+      r_{center},
+      q_{normalize(quat_cast(attitude))},
+      L_{L} {
+  SetInertia(m_ / 12 * vec3(pow(size[1], 2.f) + pow(size[2], 2.f),
+                            pow(size[0], 2.f) + pow(size[2], 2.f),
+                            pow(size[0], 2.f) + pow(size[1], 2.f)));
+}
+
+RigidBody::RigidBody(const glm::vec3& center, const glm::mat3& attitude,
+                     const glm::vec3& L, std::shared_ptr<const ConvexHull> hull,
+                     float mass)
+    : RigidBody(center, attitude, L, vec3{1.f}, mass) {
+  // Degenerate points give an empty hull, with no support points and zero
+  // moments to invert
+  if (!hull || hull->Empty()) {
+    std::cerr << "Empty convex hull, simulated as a unit box" << std::endl;
+    return;
+  }
+  size_ = hull->GetUpper() - hull->GetLower();
+  hull_ = std::move(hull);
+  SetInertia(hull_->GetInertia(m_));
 }
 
-glm::mat4 RigidBody::GetTransform() const { return translate(r_) * mat4(A_); }
+RigidBody::RigidBody(const State& state,
+                     std::shared_ptr<const ConvexHull> hull)
+    : size_{state.size},
+      m_{state.m},
+      hull_{std::move(hull)},
+      fast_{bool(state.fast)},
+      r_{state.r},
+      v_{state.v},
+      f_{state.f},
+      q_{state.q},
+      L_{state.L},
+      M_{state.M},
+      I_body_{state.I_body},
+      inv_I_body_{state.inv_I_body},
+      inv_m_{state.inv_m},
+      R_{state.R},
+      inv_I_{state.inv_I},
+      awake_{bool(state.awake)} {}
 
-void RigidBody::Update(float dt) {
-  p_ += f_ * dt;
-  r_ += p_ / m_ * dt;
+RigidBody::State RigidBody::GetState() const {
+  return {size_, m_, r_, v_, f_, q_, L_, M_, I_body_, inv_I_body_,
+          inv_m_, R_, inv_I_, fast_, awake_};
+}
 
-  L_ += M_ * dt;
-  const auto omega = GetOmega();
-  if (glm::length(omega) != 0.f) {
-    A_ = mat3(axisAngleMatrix(omega, length(omega) * dt)) * A_;
+glm::mat4 RigidBody::GetTransform() const { return translate(r_) * mat4(R_); }
+
+void RigidBody::SetVelocity(const glm::vec3& v, const glm::vec3& omega) {
+  v_ = v;
+  L_ = R_ * (I_body_ * (transpose(R_) * omega));
+}
+
+void RigidBody::SetAwake(bool awake) {
+  awake_ = awake;
+  if (!awake) {
+    v_ = f_ = vec3{0.f};
+    L_ = M_ = vec3{0.f};
   }
+}
+
+float RigidBody::GetKineticEnergy() const {
+  const auto L_body = transpose(R_) * L_;
+  return .5f * (m_ * dot(v_, v_) + dot(L_body, inv_I_body_ * L_body));
+}
+
+void RigidBody::IntegrateVelocity(float dt) {
+  v_ += inv_m_ * f_ * dt;
+  L_ += M_ * dt;
 
   f_ = vec3{0.f};
   M_ = vec3{0.f};
 }
+
+void RigidBody::IntegratePosition(float dt) {
+  r_ += v_ * dt;
+
+  // Symmetric splitting of the free rigid body, second order
+  auto L_body = transpose(R_) * L_;
+  RotateAbout(0, dt / 2, inv_I_body_, q_, L_body);
+  RotateAbout(1, dt / 2, inv_I_body_, q_, L_body);
+  RotateAbout(2, dt, inv_I_body_, q_, L_body);
+  RotateAbout(1, dt / 2, inv_I_body_, q_, L_body);
+  RotateAbout(0, dt / 2, inv_I_body_, q_, L_body);
+  q_ = normalize(q_);
+  UpdateInertia();
+}
+
+void RigidBody::SetInertia(const glm::vec3& I_body) {
+  I_body_ = I_body;
+  inv_I_body_ = 1.f / I_body_;
+  inv_m_ = 1.f / m_;
+  UpdateInertia();
+}
+
+void RigidBody::UpdateInertia() {
+  R_ = mat3_cast(q_);
+  // R diag(inv_I_body) R^T, without forming the diagonal matrix
+  const auto scaled =
+      mat3(R_[0] * inv_I_body_.x, R_[1] * inv_I_body_.y, R_[2] * inv_I_body_.z);
+  inv_I_ = scaled * transpose(R_);
+}
@@ -1,6 +1,24 @@
 #pragma once
+#include <cstdint>
 #include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <memory>
 
+#include "ConvexHull.hpp"
+
+/**
+ * Box or convex hull with quaternion attitude
+ *
+ * Inertia is diagonal in body space and its inverse is cached there. The
+ * world space inverse inertia is rebuilt once per IntegratePosition(), so
+ * impulses and velocities never invert a matrix.
+ *
+ * Stepping is symplectic Euler: IntegrateVelocity() kicks the momenta with
+ * the accumulated force and torque, IntegratePosition() then drifts with
+ * them. The torque-free rotation, including the gyroscopic term, is split
+ * into exact rotations about the principal axes, which keeps the angular
+ * momentum exact and the energy error bounded for large steps.
+ */
 class RigidBody {
 public:
   RigidBody() = default;
@@ -8,38 +26,111 @@ public:
   RigidBody(const glm::vec3& center, const glm::mat3& attitude,
             const glm::vec3& L, const glm::vec3& size, float mass);
 
+  /**
+   * center and attitude are those of the hull's principal frame, size_ is
+   * set to its bounds. An empty hull is replaced by a unit box.
+   */
+  RigidBody(const glm::vec3& center, const glm::mat3& attitude,
+            const glm::vec3& L, std::shared_ptr<const ConvexHull> hull,
+            float mass);
+
+  /**
+   * Everything but the hull as plain data, for checkpoints
+   */
+  struct State {
+    glm::vec3 size;
+    float m;
+    glm::vec3 r, v, f;
+    glm::quat q;
+    glm::vec3 L, M;
+    glm::vec3 I_body, inv_I_body;
+    float inv_m;
+    glm::mat3 R, inv_I;
+    std::uint8_t fast, awake;
+  };
+
+  RigidBody(const State& state, std::shared_ptr<const ConvexHull> hull);
+
+  State GetState() const;
+
   glm::mat4 GetTransform() const;
-  glm::mat3 GetInertia() const { return A_ * I_ * transpose(A_); }
+  glm::mat3 GetRotation() const { return R_; }
+  glm::quat GetAttitude() const { return q_; }
+  glm::mat3 GetInverseInertia() const { return inv_I_; }
+  float GetInverseMass() const { return inv_m_; }
+  glm::vec3 GetCenter() const { return r_; }
   glm::vec3 GetOffset(const glm::vec3& r) const { return r - r_; }
 
+  glm::vec3 GetLinearVelocity() const { return v_; }
+  glm::vec3 GetAngularVelocity() const { return inv_I_ * L_; }
+  void SetVelocity(const glm::vec3& v, const glm::vec3& omega);
+
+  glm::vec3 GetMomentum() const { return m_ * v_; }
+  glm::vec3 GetAngularMomentum() const { return L_; }
+  float GetKineticEnergy() const;
+
+  /**
+   * Asleep bodies are not simulated and have zero velocity
+   * Forces and impulses wake them.
+   */
+  bool IsAwake() const { return awake_; }
+  void SetAwake(bool awake);
+
   // Functions below use offset vector
   glm::vec3 GetVelocity(const glm::vec3& r) const {
-    return p_ / m_ + glm::cross(GetOmega(), r);
+    return v_ + glm::cross(GetAngularVelocity(), r);
   }
   void AddForce(const glm::vec3& f, const glm::vec3& r) {
+    awake_ = true;
     f_ += f;
     M_ += cross(r, f);
   }
   void AddImpulse(const glm::vec3& j, const glm::vec3& r) {
-    p_ += j;
+    awake_ = true;
+    v_ += inv_m_ * j;
     L_ += cross(r, j);
   }
 
-  void Update(float dt);
+  void Update(float dt) {
+    IntegrateVelocity(dt);
+    IntegratePosition(dt);
+  }
+
+  /**
+   * Momentum from the accumulated force and torque
+   */
+  void IntegrateVelocity(float dt);
+
+  /**
+   * Position and attitude from the current momentum
+   */
+  void IntegratePosition(float dt);
 
   glm::vec3 size_;
   float m_;
+  std::shared_ptr<const ConvexHull> hull_;  // A box of size_ when null
+  bool fast_ = false;  // Always checked for tunneling, e.g. projectiles
 
 private:
-  glm::vec3 GetOmega() const { return inverse(GetInertia()) * L_; }
+  void SetInertia(const glm::vec3& I_body);
+
+  void UpdateInertia();
 
   glm::vec3 r_{0.f};
-  glm::vec3 p_{0.f};
+  glm::vec3 v_{0.f};
   glm::vec3 f_{0.f};
 
-  glm::mat3 A_{1.f};
-  glm::vec3 L_{.0f};
+  glm::quat q_{1.f, 0.f, 0.f, 0.f};
+  glm::vec3 L_{0.f};
   glm::vec3 M_{0.f};
 
-  glm::mat3 I_{};
+  glm::vec3 I_body_{0.f};      // Diagonal of the body space inertia
+  glm::vec3 inv_I_body_{0.f};  // And its inverse
+  float inv_m_ = 0.f;
+
+  // Derived from q_ once per step
+  glm::mat3 R_{1.f};
+  glm::mat3 inv_I_{0.f};
+
+  bool awake_ = true;
 };
@@ -2,18 +2,18 @@
 
 #include <glad/glad.h>
 
-#include <glm/gtx/transform.hpp>
-#include <glpp/buffer.hpp>
-#include <glpp/program.hpp>
+#include <algorithm>
+#include <array>
+#include <cstddef>
 #include <proj3_shaders.hpp>
 
 #include "Camera.hpp"
+#include "RigidBody.hpp"
 
 using namespace glm;
 using namespace glpp;
 
 namespace {
-std::unique_ptr<Program> program;
 std::array<float, 6 * 6 * 6> vertices{
     -0.5f, -0.5f, -0.5f, 0.0f,  0.0f,  -1.0f, 0.5f,  -0.5f, -0.5f,
     0.0f,  0.0f,  -1.0f, 0.5f,  0.5f,  -0.5f, 0.0f,  0.0f,  -1.0f,
@@ -44,38 +44,182 @@ std::array<float, 6 * 6 * 6> vertices{
     0.0f,  1.0f,  0.0f,  0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,
     0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  -0.5f, 0.5f,  0.5f,
     0.0f,  1.0f,  0.0f,  -0.5f, 0.5f,  -0.5f, 0.0f,  1.0f,  0.0f};
+
+const GLuint kVertexBinding = 0, kInstanceBinding = 1;
 }  // namespace
 
-RigidBodyRenderer::RigidBodyRenderer(const glm::vec3& size)
-    : size_(size), transform_(scale(size)) {
-  Buffer vbo;
-
-  vbo.CreateStorage(vertices, GL_DYNAMIC_STORAGE_BIT);
-
-  vao = std::make_unique<VertexArray>();
-  vao->BindVertexBuffer(0, vbo, 2 * sizeof(vec3), 0);
-  vao->EnableAttrib(0, 1);
-  vao->AttribBinding(0, 0, 1);
-  vao->AttribFormat<vec3>(0, 0);
-  vao->AttribFormat<vec3>(1, sizeof(vec3));
-
-  if (!program) {
-    program = std::make_unique<Program>(
-        Shader(VERTEX_SHADER,
-               std::string(phong_vert.begin(), phong_vert.end())),
-        Shader(FRAGMENT_SHADER,
-               std::string(phong_frag.begin(), phong_frag.end())));
+RigidBodyRenderer::RigidBodyRenderer()
+    : program_(std::make_unique<Program>(
+          Shader(VERTEX_SHADER,
+                 std::string(phong_vert.begin(), phong_vert.end())),
+          Shader(FRAGMENT_SHADER,
+                 std::string(phong_frag.begin(), phong_frag.end())))) {
+  glCreateVertexArrays(1, &vao_);
+  BuildMeshes({});
+  for (GLuint attrib : {0, 1}) {
+    glEnableVertexArrayAttrib(vao_, attrib);
+    glVertexArrayAttribBinding(vao_, attrib, kVertexBinding);
+    glVertexArrayAttribFormat(vao_, attrib, 3, GL_FLOAT, GL_FALSE,
+                              attrib * 3 * sizeof(float));
+  }
+
+  // Instances advance once per cube, the buffer is attached in Reserve()
+  glVertexArrayBindingDivisor(vao_, kInstanceBinding, 1);
+  const std::array<GLuint, 3> offsets = {offsetof(Instance, attitude),
+                                         offsetof(Instance, center),
+                                         offsetof(Instance, size)};
+  const std::array<GLint, 3> sizes = {4, 3, 3};
+  for (GLuint i = 0; i < 3; ++i) {
+    glEnableVertexArrayAttrib(vao_, 2 + i);
+    glVertexArrayAttribBinding(vao_, 2 + i, kInstanceBinding);
+    glVertexArrayAttribFormat(vao_, 2 + i, sizes[i], GL_FLOAT, GL_FALSE,
+                              offsets[i]);
   }
+
+  Reserve(1024);
 }
 
-void RigidBodyRenderer::Update(const glm::mat4& transform) {
-  transform_ = transform * scale(size_);
+RigidBodyRenderer::~RigidBodyRenderer() {
+  for (auto fence : fences_) {
+    if (fence) glDeleteSync(static_cast<GLsync>(fence));
+  }
+  if (mapped_) glUnmapNamedBuffer(instances_);
+  glDeleteBuffers(1, &instances_);
+  glDeleteBuffers(1, &vbo_);
+  glDeleteVertexArrays(1, &vao_);
+}
+
+void RigidBodyRenderer::BuildMeshes(const std::vector<RigidBody>& bodies) {
+  std::vector<float> data(vertices.begin(), vertices.end());
+  meshes_ = {Mesh{nullptr, 0, 36}};
+  hull_meshes_.clear();
+  for (const auto& rb : bodies) {
+    if (!rb.hull_ || hull_meshes_.count(rb.hull_.get())) continue;
+    hull_meshes_[rb.hull_.get()] = std::uint32_t(meshes_.size());
+    Mesh mesh{rb.hull_, int(data.size() / 6)};
+    // Faces are convex polygons, fanned out with their flat normal
+    const auto& hull_vertices = rb.hull_->GetVertices();
+    for (const auto& f : rb.hull_->GetFaces()) {
+      const auto indices = rb.hull_->FaceVertices(f);
+      for (std::uint32_t k = 1; k + 1 < f.count; ++k) {
+        for (const auto i : {indices[0], indices[k], indices[k + 1]}) {
+          const auto& p = hull_vertices[i];
+          data.insert(data.end(), {p.x, p.y, p.z, f.n.x, f.n.y, f.n.z});
+        }
+      }
+    }
+    mesh.count = int(data.size() / 6) - mesh.first;
+    meshes_.push_back(std::move(mesh));
+  }
+
+  // Draws already issued keep the old buffer until they are done
+  glDeleteBuffers(1, &vbo_);
+  glCreateBuffers(1, &vbo_);
+  glNamedBufferStorage(vbo_, GLsizeiptr(data.size() * sizeof(float)),
+                       data.data(), 0);
+  glVertexArrayVertexBuffer(vao_, kVertexBinding, vbo_, 0, 6 * sizeof(float));
+}
+
+void RigidBodyRenderer::Reserve(size_t count) {
+  if (count <= capacity_) return;
+  // Whatever is in flight must finish before the storage goes away
+  for (auto& fence : fences_) {
+    if (!fence) continue;
+    glClientWaitSync(static_cast<GLsync>(fence), GL_SYNC_FLUSH_COMMANDS_BIT,
+                     GL_TIMEOUT_IGNORED);
+    glDeleteSync(static_cast<GLsync>(fence));
+    fence = nullptr;
+  }
+  if (mapped_) glUnmapNamedBuffer(instances_);
+  glDeleteBuffers(1, &instances_);
+
+  capacity_ = std::max(count, capacity_ * 3 / 2);
+  const auto bytes = GLsizeiptr(kFrames * capacity_ * sizeof(Instance));
+  glCreateBuffers(1, &instances_);
+  // Coherent, so writes need no flush before the draw
+  const GLbitfield flags =
+      GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+  glNamedBufferStorage(instances_, bytes, nullptr, flags);
+  mapped_ = static_cast<Instance*>(
+      glMapNamedBufferRange(instances_, 0, bytes, flags));
+  glVertexArrayVertexBuffer(vao_, kInstanceBinding, instances_, 0,
+                            sizeof(Instance));
+}
+
+void RigidBodyRenderer::Acquire() {
+  auto& fence = fences_[frame_];
+  if (!fence) return;
+  // Normally long signaled, the ring is three frames deep
+  while (glClientWaitSync(static_cast<GLsync>(fence),
+                          GL_SYNC_FLUSH_COMMANDS_BIT,
+                          1000000) == GL_TIMEOUT_EXPIRED) {
+  }
+  glDeleteSync(static_cast<GLsync>(fence));
+  fence = nullptr;
+}
+
+bool RigidBodyRenderer::AssignMeshes(const std::vector<RigidBody>& bodies) {
+  body_meshes_.resize(bodies.size());
+  for (auto& mesh : meshes_) mesh.instances = 0;
+  const ConvexHull* last_hull = nullptr;
+  std::uint32_t last_mesh = 0;
+  for (size_t i = 0; i < bodies.size(); ++i) {
+    const auto hull = bodies[i].hull_.get();
+    if (hull && hull != last_hull) {
+      const auto found = hull_meshes_.find(hull);
+      if (found == hull_meshes_.end()) return false;
+      last_hull = hull;
+      last_mesh = found->second;
+    }
+    body_meshes_[i] = hull ? last_mesh : 0;
+    ++meshes_[body_meshes_[i]].instances;
+  }
+  return true;
+}
+
+void RigidBodyRenderer::Update(const std::vector<RigidBody>& bodies) {
+  // A hull not seen before is a new scene, its hulls replace the last one's
+  if (!AssignMeshes(bodies)) {
+    BuildMeshes(bodies);
+    AssignMeshes(bodies);
+  }
+  Reserve(bodies.size());
+  frame_ = (frame_ + 1) % kFrames;
+  Acquire();
+
+  // Instances grouped by mesh, in mesh order
+  next_.assign(meshes_.size(), 0);
+  for (size_t m = 1; m < meshes_.size(); ++m) {
+    next_[m] = next_[m - 1] + meshes_[m - 1].instances;
+  }
+  const auto region = mapped_ + frame_ * capacity_;
+  for (size_t i = 0; i < bodies.size(); ++i) {
+    const auto& rb = bodies[i];
+    const auto q = rb.GetAttitude();
+    // Hull meshes are to scale already, around the centroid
+    const auto size = rb.hull_ ? vec3{1.f} : rb.size_;
+    region[next_[body_meshes_[i]]++] = {vec4{q.x, q.y, q.z, q.w},
+                                        rb.GetCenter(), size};
+  }
+  size_ = bodies.size();
 }
 
 void RigidBodyRenderer::Draw(const Camera& camera) {
-  vao->Bind();
-  program->Use();
-  program->Uniform("model", transform_);
-  program->Uniform("view_proj", camera.Projection() * camera.View());
-  glDrawArrays(GL_TRIANGLES, 0, 36);
+  if (!size_) return;
+  program_->Use();
+  program_->Uniform("view_proj", camera.Projection() * camera.View());
+  glBindVertexArray(vao_);
+  auto base = frame_ * capacity_;
+  for (const auto& mesh : meshes_) {
+    if (mesh.instances) {
+      glDrawArraysInstancedBaseInstance(GL_TRIANGLES, mesh.first, mesh.count,
+                                        GLsizei(mesh.instances),
+                                        GLuint(base));
+    }
+    base += mesh.instances;
+  }
+
+  // The region is free again once this draw has been consumed
+  if (fences_[frame_]) glDeleteSync(static_cast<GLsync>(fences_[frame_]));
+  fences_[frame_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
 }
@@ -1,26 +1,89 @@
 #pragma once
+#include <cstdint>
 #include <glm/glm.hpp>
-#include <glpp/buffer.hpp>
-#include <glpp/vertexarray.hpp>
+#include <glpp/program.hpp>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 class Camera;
-struct Particle;
+class ConvexHull;
+class RigidBody;
 
+/**
+ * All bodies in one instanced draw per shape
+ *
+ * Boxes are instances of the unit cube with their center, attitude and
+ * size. Hull bodies are instances of their hull's own mesh, one mesh per
+ * distinct hull, all in one vertex buffer after the cube. Instances are
+ * copied straight from the bodies into a persistently mapped buffer, grouped
+ * by mesh. The buffer is a ring of kFrames regions guarded by fences, so a
+ * frame never writes instances the GPU may still be reading.
+ */
 class RigidBodyRenderer {
 public:
-  RigidBodyRenderer() = default;
+  RigidBodyRenderer();
 
-  explicit RigidBodyRenderer(const glm::vec3& size);
+  RigidBodyRenderer(const RigidBodyRenderer&) = delete;
+  RigidBodyRenderer& operator=(const RigidBodyRenderer&) = delete;
 
-  void Update(const glm::mat4& transform);
+  ~RigidBodyRenderer();
+
+  void Update(const std::vector<RigidBody>& bodies);
 
   void Draw(const Camera& camera);
 
 private:
-  std::unique_ptr<glpp::VertexArray> vao;
+  static constexpr int kFrames = 3;
+
+  struct Instance {
+    glm::vec4 attitude;  // x, y, z, w
+    glm::vec3 center;
+    glm::vec3 size;
+  };
+
+  // Triangles in vbo_, the box's first
+  struct Mesh {
+    // Held, so its address is not reused while it is a key of hull_meshes_
+    std::shared_ptr<const ConvexHull> hull;
+    int first = 0, count = 0;
+    size_t instances = 0;  // In the current region, after earlier meshes
+  };
+
+  /**
+   * Meshes of the cube and of every hull of bodies, replacing the others
+   */
+  void BuildMeshes(const std::vector<RigidBody>& bodies);
+
+  /**
+   * body_meshes_ and the instances of every mesh, false if a body's hull
+   * has no mesh
+   */
+  bool AssignMeshes(const std::vector<RigidBody>& bodies);
+
+  /**
+   * Room for at least count instances per region, previous contents are lost
+   */
+  void Reserve(size_t count);
+
+  /**
+   * Waits until the GPU is done with region frame_
+   */
+  void Acquire();
+
+  std::unique_ptr<glpp::Program> program_;
+
+  unsigned vao_ = 0, vbo_ = 0, instances_ = 0;
+  Instance* mapped_ = nullptr;  // Whole ring
+
+  size_t capacity_ = 0;  // Instances per region
+  size_t size_ = 0;      // Instances in the current region
+  int frame_ = 0;
+  void* fences_[kFrames] = {};
 
-  glm::vec3 size_{1.f};
-  glm::mat4 transform_{1.f};
+  std::vector<Mesh> meshes_;
+  std::unordered_map<const ConvexHull*, std::uint32_t> hull_meshes_;
+  // Scratch of Update()
+  std::vector<std::uint32_t> body_meshes_;
+  std::vector<size_t> next_;
 };
@@ -0,0 +1,76 @@
+#include "RigidScenes.hpp"
+
+#include <cmath>
+#include <glm/gtx/component_wise.hpp>
+#include <memory>
+#include <random>
+
+using namespace glm;
+
+void AddColumns(RigidWorld& world, int count, const vec3& center,
+                const mat3& R, const vec3& L, const vec3& size) {
+  const auto spacing = 1.5f * compMax(size);
+  const auto side = int(std::ceil(std::sqrt(float(count))));
+  for (int i = 0; i < count; ++i) {
+    const auto layer = i / (side * side), cell = i % (side * side);
+    const auto offset = vec3{cell % side, layer, cell / side} * spacing;
+    world.Add(RigidBody(center + offset, R, L, size, 1.f));
+  }
+}
+
+bool GetRigidScene(const std::string& name, int count, RigidWorld& world) {
+  world.Clear();
+  // Fixed seed, so a scene is the same on every run
+  std::mt19937 rng(1);
+  std::uniform_real_distribution<float> uniform(-1.f, 1.f);
+  // Drawn one at a time, braced init lists are evaluated in order
+  const auto random_vec3 = [&] {
+    return vec3{uniform(rng), uniform(rng), uniform(rng)};
+  };
+  const auto random_rotation = [&] {
+    const auto w = uniform(rng);
+    return mat3_cast(normalize(quat(w, random_vec3())));
+  };
+
+  if (name == "columns") {
+    // Resting boxes, falls asleep
+    AddColumns(world, count, {0.f, .5f, 0.f}, mat3{1.f}, vec3{0.f}, vec3{1.f});
+  } else if (name == "tumble") {
+    // Boxes spinning as they fall on each other
+    const auto side = int(std::ceil(std::sqrt(float(count))));
+    for (int i = 0; i < count; ++i) {
+      const auto layer = i / (side * side), cell = i % (side * side);
+      const auto center = vec3{cell % side, 2 + layer, cell / side} * 2.f;
+      const auto R = random_rotation();
+      const auto L = random_vec3();
+      world.Add(RigidBody(center, R, L, vec3{1.f, .6f, 1.4f}, 1.f));
+    }
+  } else if (name == "rocks") {
+    // Random hulls shared by all bodies, mixed with boxes
+    std::vector<std::shared_ptr<const ConvexHull>> hulls;
+    for (int h = 0; h < 4; ++h) {
+      std::vector<vec3> points(16 + 16 * h);
+      for (auto& p : points) p = normalize(random_vec3()) * vec3{.7f, .5f, .6f};
+      hulls.push_back(std::make_shared<const ConvexHull>(points));
+    }
+    const auto side = int(std::ceil(std::sqrt(float(count))));
+    for (int i = 0; i < count; ++i) {
+      const auto layer = i / (side * side), cell = i % (side * side);
+      const auto center = vec3{cell % side, 1 + layer, cell / side} * 1.8f;
+      const auto R = random_rotation();
+      const auto L = random_vec3();
+      if (i % 4 == 3) {
+        world.Add(RigidBody(center, R, L, vec3{1.f, .8f, 1.2f}, 1.f));
+      } else {
+        world.Add(RigidBody(center, R, L, hulls[i % hulls.size()], 1.f));
+      }
+    }
+  } else {
+    return false;
+  }
+  return true;
+}
+
+std::vector<std::string> GetRigidSceneNames() {
+  return {"columns", "tumble", "rocks"};
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+#include "RigidWorld.hpp"
+
+/**
+ * count bodies stacked in columns on a square grid, the first at center
+ * Spaced so that none overlap initially.
+ */
+void AddColumns(RigidWorld& world, int count, const glm::vec3& center,
+                const glm::mat3& R, const glm::vec3& L, const glm::vec3& size);
+
+/**
+ * Named scenes of count bodies: columns, tumble, rocks
+ * Returns false for unknown names
+ */
+bool GetRigidScene(const std::string& name, int count, RigidWorld& world);
+
+std::vector<std::string> GetRigidSceneNames();
@@ -0,0 +1,295 @@
+#include "RigidWorld.hpp"
+
+#include <algorithm>
+#include <glm/gtx/component_wise.hpp>
+#include <iostream>
+#include <unordered_map>
+
+#include "Checkpoint.hpp"
+#include "Profiler.hpp"
+
+using namespace glm;
+
+namespace {
+// Settings of a world in a checkpoint
+struct WorldParameters {
+  vec3 gravity;
+  std::int32_t iterations;
+  std::uint32_t warm_start, ccd, sleep;
+  float eps, mu, baumgarte, slop, bounce_threshold;
+  float ccd_threshold, sleep_linear, sleep_angular, time_to_sleep;
+  float margin;
+};
+}  // namespace
+
+size_t RigidWorld::Add(const RigidBody& body) {
+  bodies_.push_back(body);
+  return bodies_.size() - 1;
+}
+
+void RigidWorld::Clear() {
+  bodies_.clear();
+  boxes_.clear();
+  bounds_.clear();
+  continuous_.clear();
+  time_of_impact_.clear();
+  asleep_.clear();
+  sleep_time_.clear();
+  narrowphase_.Clear();
+}
+
+void RigidWorld::Step(float dt) {
+  PROFILE_ZONE("RigidWorld::Step");
+  Detect(dt);
+  Solve(dt);
+  Integrate(dt);
+}
+
+void RigidWorld::Detect(float dt) {
+  PROFILE_ZONE("RigidWorld::Detect");
+  asleep_.resize(bodies_.size());
+  for (size_t i = 0; i < bodies_.size(); ++i) {
+    asleep_[i] = !bodies_[i].IsAwake();
+  }
+  UpdateBounds(dt);
+  {
+    PROFILE_ZONE("Broadphase::Update");
+    broadphase_.Update(bounds_);
+  }
+  {
+    PROFILE_ZONE("Narrowphase::Update");
+    narrowphase_.Update(boxes_, broadphase_.GetPairs(), asleep_);
+  }
+  {
+    PROFILE_ZONE("Islands::Build");
+    islands_.Build(bodies_.size(), narrowphase_.GetManifolds());
+  }
+  Wake();
+}
+
+void RigidWorld::Solve(float dt) {
+  PROFILE_ZONE("RigidWorld::Solve");
+  ForEach([&](size_t i) {
+    auto& rb = bodies_[i];
+    if (!rb.IsAwake()) return;
+    rb.AddForce(rb.m_ * gravity_, {0, 0, 0});
+    rb.IntegrateVelocity(dt);
+  });
+  PROFILE_ZONE("ContactSolver::Solve");
+  solver_.Solve(bodies_, narrowphase_.GetManifolds(), islands_, dt, jobs_);
+}
+
+void RigidWorld::Integrate(float dt) {
+  PROFILE_ZONE("RigidWorld::Integrate");
+  Advance(dt);
+  ForEach([&](size_t i) {
+    if (bodies_[i].IsAwake()) bodies_[i].IntegratePosition(time_of_impact_[i]);
+  });
+  Sleep(dt);
+}
+
+void RigidWorld::SetThreads(size_t threads) {
+  jobs_.SetThreads(threads);
+}
+
+template <typename F>
+void RigidWorld::ForEach(F f) {
+  jobs_.ParallelFor(bodies_.size(), 256, [&](size_t begin, size_t end) {
+    for (auto i = begin; i < end; ++i) f(i);
+  });
+}
+
+size_t RigidWorld::AwakeCount() const {
+  return size_t(std::count_if(bodies_.begin(), bodies_.end(),
+                              [](const RigidBody& rb) { return rb.IsAwake(); }));
+}
+
+void RigidWorld::UpdateBounds(float dt) {
+  const auto old_size = boxes_.size();
+  boxes_.resize(bodies_.size());
+  bounds_.resize(bodies_.size());
+  continuous_.assign(bodies_.size(), false);
+  for (size_t i = 0; i < bodies_.size(); ++i) {
+    const auto& rb = bodies_[i];
+    // Asleep bodies have not moved, bodies added since have no box yet
+    if (asleep_[i] && i < old_size) continue;
+    boxes_[i] = OBB::FromBody(rb);
+    bounds_[i] = boxes_[i].Bounds();
+
+    if (ccd_) {
+      // Velocity is not solved yet, gravity is the only known change
+      const Sweep sweep{boxes_[i], rb.GetLinearVelocity() + gravity_ * dt,
+                        rb.GetAngularVelocity()};
+      continuous_[i] = rb.fast_ || sweep.Speed() * dt >
+                                       ccd_threshold_ * compMin(boxes_[i].e);
+      if (continuous_[i]) bounds_[i] = sweep.Bounds(dt);
+    }
+
+    // Pairs within the contact margin still reach the narrowphase
+    bounds_[i].lo -= narrowphase_.margin_;
+    bounds_[i].hi += narrowphase_.margin_;
+  }
+}
+
+void RigidWorld::Advance(float dt) {
+  time_of_impact_.assign(bodies_.size(), dt);
+  if (!ccd_) return;
+
+  // Stop short of contact, inside the margin so the next step sees it
+  const auto target = narrowphase_.margin_ / 2;
+  const auto sweep = [&](std::uint32_t i) {
+    return Sweep{boxes_[i], bodies_[i].GetLinearVelocity(),
+                 bodies_[i].GetAngularVelocity()};
+  };
+  for (std::uint32_t i = 0; i < bodies_.size(); ++i) {
+    if (continuous_[i]) {
+      time_of_impact_[i] = TimeOfImpactGround(sweep(i), dt, target);
+    }
+  }
+  // Only fast bodies are held back, slow ones are left to the solver
+  for (const auto& [a, b] : broadphase_.GetPairs()) {
+    if (!continuous_[a] && !continuous_[b]) continue;
+    const auto t = TimeOfImpact(sweep(a), sweep(b), dt, target);
+    if (continuous_[a]) time_of_impact_[a] = min(time_of_impact_[a], t);
+    if (continuous_[b]) time_of_impact_[b] = min(time_of_impact_[b], t);
+  }
+}
+
+void RigidWorld::Wake() {
+  // An island touched by an awake body, or one given an impulse, wakes whole
+  for (size_t k = 0; k < islands_.Count(); ++k) {
+    const auto awake =
+        std::any_of(islands_.begin(k), islands_.end(k),
+                    [&](std::uint32_t i) { return bodies_[i].IsAwake(); });
+    if (!awake) continue;
+    for (auto i = islands_.begin(k); i != islands_.end(k); ++i) {
+      bodies_[*i].SetAwake(true);
+    }
+  }
+}
+
+void RigidWorld::Sleep(float dt) {
+  sleep_time_.resize(bodies_.size(), 0.f);
+  for (size_t i = 0; i < bodies_.size(); ++i) {
+    const auto& rb = bodies_[i];
+    // Woken bodies start over
+    const auto resting =
+        rb.IsAwake() && length(rb.GetLinearVelocity()) < sleep_linear_ &&
+        length(rb.GetAngularVelocity()) < sleep_angular_;
+    sleep_time_[i] = sleep_ && resting ? sleep_time_[i] + dt : 0.f;
+    if (!sleep_) bodies_[i].SetAwake(true);
+  }
+  if (!sleep_) return;
+
+  // Islands sleep together, once their most restless body has rested long
+  // enough
+  for (size_t k = 0; k < islands_.Count(); ++k) {
+    const auto ready = std::all_of(
+        islands_.begin(k), islands_.end(k), [&](std::uint32_t i) {
+          return sleep_time_[i] >= time_to_sleep_;
+        });
+    if (!ready) continue;
+    for (auto i = islands_.begin(k); i != islands_.end(k); ++i) {
+      bodies_[*i].SetAwake(false);
+    }
+  }
+}
+
+void RigidWorld::Save(Checkpoint& checkpoint) const {
+  WorldParameters params;
+  params.gravity = gravity_;
+  params.iterations = solver_.iterations_;
+  params.warm_start = solver_.warm_start_;
+  params.ccd = ccd_;
+  params.sleep = sleep_;
+  params.eps = solver_.eps_;
+  params.mu = solver_.mu_;
+  params.baumgarte = solver_.baumgarte_;
+  params.slop = solver_.slop_;
+  params.bounce_threshold = solver_.bounce_threshold_;
+  params.ccd_threshold = ccd_threshold_;
+  params.sleep_linear = sleep_linear_;
+  params.sleep_angular = sleep_angular_;
+  params.time_to_sleep = time_to_sleep_;
+  params.margin = narrowphase_.margin_;
+  checkpoint.AddValue("params", params);
+
+  // Shared hulls once, bodies by index, -1 for boxes
+  std::vector<const ConvexHull*> hulls;
+  std::unordered_map<const ConvexHull*, std::int32_t> hull_index;
+  std::vector<RigidBody::State> states;
+  std::vector<std::int32_t> body_hulls;
+  for (const auto& rb : bodies_) {
+    states.push_back(rb.GetState());
+    auto index = -1;
+    if (rb.hull_) {
+      const auto it = hull_index.emplace(rb.hull_.get(), hulls.size()).first;
+      if (it->second == std::int32_t(hulls.size())) {
+        hulls.push_back(rb.hull_.get());
+      }
+      index = it->second;
+    }
+    body_hulls.push_back(index);
+  }
+  checkpoint.Add("bodies", std::move(states));
+  checkpoint.Add("bodyhull", std::move(body_hulls));
+  ConvexHull::Save(hulls, checkpoint);
+  checkpoint.Add("sleep", sleep_time_);
+  narrowphase_.Save(checkpoint);
+}
+
+bool RigidWorld::Load(const CheckpointFile& file) {
+  WorldParameters params;
+  size_t count = 0, hull_count = 0;
+  const auto states = file.Get<RigidBody::State>("bodies", count);
+  const auto body_hulls = file.Get<std::int32_t>("bodyhull", hull_count);
+  std::vector<std::shared_ptr<const ConvexHull>> hulls;
+  std::vector<float> sleep_time;
+  Narrowphase narrowphase;
+  if (!file.ReadValue("params", params) || !states || !body_hulls ||
+      hull_count != count || !ConvexHull::Load(file, hulls) ||
+      !file.Read("sleep", sleep_time)) {
+    return false;
+  }
+  // Vertices of each body, for the narrowphase to check its indices against
+  std::vector<std::uint32_t> vertices(count, 8);
+  auto consistent = sleep_time.size() == count;
+  for (size_t i = 0; consistent && i < count; ++i) {
+    const auto h = body_hulls[i];
+    consistent = h >= -1 && h < std::int32_t(hulls.size());
+    if (consistent && h >= 0) {
+      vertices[i] = std::uint32_t(hulls[h]->GetVertices().size());
+    }
+  }
+  if (!consistent) {
+    std::cerr << "Inconsistent bodies in checkpoint" << std::endl;
+    return false;
+  }
+  if (!narrowphase.Load(file, vertices)) return false;
+
+  Clear();
+  gravity_ = params.gravity;
+  solver_.iterations_ = params.iterations;
+  solver_.warm_start_ = params.warm_start;
+  ccd_ = params.ccd;
+  sleep_ = params.sleep;
+  solver_.eps_ = params.eps;
+  solver_.mu_ = params.mu;
+  solver_.baumgarte_ = params.baumgarte;
+  solver_.slop_ = params.slop;
+  solver_.bounce_threshold_ = params.bounce_threshold;
+  ccd_threshold_ = params.ccd_threshold;
+  sleep_linear_ = params.sleep_linear;
+  sleep_angular_ = params.sleep_angular;
+  time_to_sleep_ = params.time_to_sleep;
+  narrowphase_ = std::move(narrowphase);
+  narrowphase_.margin_ = params.margin;
+
+  bodies_.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    bodies_.emplace_back(states[i],
+                         body_hulls[i] < 0 ? nullptr : hulls[body_hulls[i]]);
+  }
+  sleep_time_ = std::move(sleep_time);
+  return true;
+}
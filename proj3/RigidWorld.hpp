@@ -0,0 +1,128 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+
+#include "Broadphase.hpp"
+#include "ContactSolver.hpp"
+#include "ContinuousCollision.hpp"
+#include "Islands.hpp"
+#include "Narrowphase.hpp"
+#include "RigidBody.hpp"
+#include "JobSystem.hpp"
+
+class Checkpoint;
+class CheckpointFile;
+
+/**
+ * All rigid bodies of a scene in contiguous storage, plus the y = 0 ground
+ */
+class RigidWorld {
+public:
+  /**
+   * Returns the index of the body
+   */
+  size_t Add(const RigidBody& body);
+
+  void Clear();
+
+  void Step(float dt);
+
+  // Passes of Step() in order, public for benchmarks
+  // Contacts and islands, then velocities, then positions and sleep
+  void Detect(float dt);
+  void Solve(float dt);
+  void Integrate(float dt);
+
+  /**
+   * Threads stepping the world, including the caller
+   * Results do not depend on it.
+   */
+  void SetThreads(size_t threads);
+  size_t GetThreads() const { return jobs_.GetThreads(); }
+
+  size_t Size() const { return bodies_.size(); }
+  size_t AwakeCount() const;
+
+  const std::vector<RigidBody>& GetBodies() const { return bodies_; }
+  std::vector<RigidBody>& GetBodies() { return bodies_; }
+
+  /**
+   * Candidate pairs of the last step
+   */
+  const std::vector<Broadphase::Pair>& GetPairs() const {
+    return broadphase_.GetPairs();
+  }
+
+  /**
+   * Contacts of the last step, including those with the ground
+   */
+  const std::vector<Manifold>& GetManifolds() const {
+    return narrowphase_.GetManifolds();
+  }
+
+  /**
+   * Islands of the last step, connected through contacts
+   */
+  const Islands& GetIslands() const { return islands_; }
+
+  /**
+   * Bodies with their hulls, settings, sleep timers and the last contacts
+   * for warm starting. Load() keeps the threads; on failure the world is
+   * left as it was.
+   */
+  void Save(Checkpoint& checkpoint) const;
+  bool Load(const CheckpointFile& file);
+
+  glm::vec3 gravity_{0.f, -9.8f, 0.f};
+  ContactSolver solver_;
+
+  /**
+   * Continuous collision for bodies moving more than ccd_threshold_ times
+   * their smallest half extent in a step, or flagged fast_
+   */
+  bool ccd_ = true;
+  float ccd_threshold_ = 1.f;
+
+  /**
+   * Islands whose bodies all stay below both speeds for time_to_sleep_ are
+   * no longer simulated until touched or given an impulse
+   */
+  bool sleep_ = true;
+  float sleep_linear_ = .05f, sleep_angular_ = .05f;
+  float time_to_sleep_ = .5f;
+
+private:
+  /**
+   * Fast bodies get bounds swept over the step so the broadphase also finds
+   * what they could hit
+   */
+  void UpdateBounds(float dt);
+
+  /**
+   * Fraction of the step each body may move without tunneling
+   */
+  void Advance(float dt);
+
+  void Wake();
+  void Sleep(float dt);
+
+  /**
+   * f(i) for every body, in chunks on the pool
+   */
+  template <typename F>
+  void ForEach(F f);
+
+  std::vector<RigidBody> bodies_;
+  std::vector<OBB> boxes_;
+  std::vector<AABB> bounds_;
+  std::vector<char> continuous_;
+  std::vector<float> time_of_impact_;
+  std::vector<char> asleep_;  // At the start of the step
+  std::vector<float> sleep_time_;
+  Broadphase broadphase_;
+  Narrowphase narrowphase_;
+  Islands islands_;
+  JobArena jobs_{1};
+};
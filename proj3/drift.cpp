@@ -0,0 +1,113 @@
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <glm/glm.hpp>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "Arguments.hpp"
+#include "RigidBody.hpp"
+
+using namespace glm;
+
+namespace {
+// Largest drift that passes. The energy bound is at dt = 1/60 and shrinks
+// with dt^2, the integrator being second order, plus float round-off that
+// adds up over the steps. The direction bound is a few float steps of acos
+// near 1.
+const auto kEnergyDrift = 5E-3f, kRoundOff = 2E-9f;
+const auto kMomentumDrift = 1E-4f, kDirectionDrift = 2E-3f;
+
+struct Case {
+  std::string name;
+  vec3 L;  // In body space
+};
+
+struct Drift {
+  float energy = 0.f, momentum = 0.f, direction = 0.f;
+  float seconds = 0.f;
+  size_t steps = 0;
+  bool finite = true;
+
+  bool IsWithinBounds(float dt) const {
+    const auto scale = dt * 60.f;
+    return finite &&
+           energy <= kEnergyDrift * scale * scale + kRoundOff * steps &&
+           momentum <= kMomentumDrift && direction <= kDirectionDrift;
+  }
+};
+
+// Torque free box tumbling for duration, no contacts or gravity
+Drift Tumble(const vec3& size, const vec3& L, float dt, float duration) {
+  RigidBody rb(vec3{0.f}, mat3{1.f}, L, size, 1.f);
+  const auto energy_0 = rb.GetKineticEnergy();
+  const auto L_0 = rb.GetAngularMomentum();
+
+  Drift drift;
+  const auto steps = drift.steps = size_t(std::ceil(duration / dt));
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < steps; ++i) {
+    rb.Update(dt);
+
+    const auto energy = rb.GetKineticEnergy();
+    const auto L_t = rb.GetAngularMomentum();
+    drift.finite &= std::isfinite(energy);
+    drift.energy =
+        max(drift.energy, std::abs(energy - energy_0) / energy_0);
+    drift.momentum =
+        max(drift.momentum, std::abs(length(L_t) - length(L_0)) / length(L_0));
+    drift.direction =
+        max(drift.direction,
+            std::acos(clamp(dot(normalize(L_t), normalize(L_0)), -1.f, 1.f)));
+  }
+  drift.seconds = std::chrono::duration<float>(
+                      std::chrono::steady_clock::now() - start)
+                      .count() /
+                  float(steps);
+  return drift;
+}
+}  // namespace
+
+// Energy and angular momentum drift of the rigid body integrator, fails
+// when any case drifts beyond the bounds
+// proj3_drift [duration in seconds]
+int main(int argc, char* argv[]) {
+  auto duration = 20.f;
+  if (!ParseArgument(argc, argv, 1, duration) || duration <= 0.f) {
+    std::cerr << "Usage: proj3_drift [duration in seconds]" << std::endl;
+    return EXIT_FAILURE;
+  }
+  const auto size = vec3(1.f, 2.f, 3.f);  // Three distinct moments
+  // Near the smallest and largest moments the spin is stable, near the
+  // intermediate one it flips periodically (Dzhanibekov effect)
+  const Case cases[] = {{"minor", {5.f, .05f, .05f}},
+                        {"middle", {.05f, 5.f, .05f}},
+                        {"major", {.05f, .05f, 5.f}},
+                        {"general", {3.f, -2.f, 4.f}}};
+  const float steps[] = {1.f / 480, 1.f / 120, 1.f / 60, 1.f / 30, 1.f / 10};
+
+  std::cout << "Duration " << duration << " s, relative drift\n"
+            << std::setw(10) << "case" << std::setw(12) << "dt"
+            << std::setw(14) << "energy" << std::setw(14) << "|L|"
+            << std::setw(14) << "L angle" << std::setw(14) << "us/step"
+            << std::endl;
+  auto failed = 0;
+  for (const auto& c : cases) {
+    for (const auto dt : steps) {
+      const auto drift = Tumble(size, c.L, dt, duration);
+      const auto ok = drift.IsWithinBounds(dt);
+      failed += !ok;
+      std::cout << std::setw(10) << c.name << std::setw(12) << dt
+                << std::setw(14) << drift.energy << std::setw(14)
+                << drift.momentum << std::setw(14) << drift.direction
+                << std::setw(14) << drift.seconds * 1E6f
+                << (ok ? "" : "  beyond bounds") << std::endl;
+    }
+  }
+
+  if (failed) {
+    std::cerr << failed << " cases drifted beyond the bounds" << std::endl;
+    return EXIT_FAILURE;
+  }
+}
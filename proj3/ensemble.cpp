@@ -0,0 +1,114 @@
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <glm/glm.hpp>
+#include <glm/gtx/euler_angles.hpp>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "RigidBatch.hpp"
+#include "RigidBody.hpp"
+
+using namespace glm;
+
+namespace {
+const auto time_step = 1.f / 60;
+
+// The tumbling scene of the GUI with random attitude and angular momentum
+std::vector<RigidBody> Scene(size_t n, const vec3& size) {
+  std::mt19937 random(0);
+  std::uniform_real_distribution<float> angle(-180.f, 180.f), L(-5.f, 5.f);
+  std::vector<RigidBody> bodies;
+  for (size_t i = 0; i < n; ++i) {
+    const auto attitude = yawPitchRoll(radians(angle(random)),
+                                       radians(angle(random)),
+                                       radians(angle(random)));
+    bodies.emplace_back(vec3{0, 5, 0}, mat3(attitude),
+                        vec3(L(random), L(random), L(random)), size, 1.f);
+  }
+  return bodies;
+}
+
+template <typename Batch>
+float Run(Batch& batch, const std::vector<RigidBody>& bodies, size_t steps) {
+  for (const auto& rb : bodies) batch.Add(rb);
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < steps; ++i) batch.Step(time_step);
+  return std::chrono::duration<float>(std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+// Largest deviation from RigidBody while still in the air
+float FreeFlightError(const std::vector<RigidBody>& bodies, size_t steps) {
+  RigidBatch8 batch;
+  for (const auto& rb : bodies) batch.Add(rb);
+  auto reference = bodies;
+  auto error = 0.f;
+  for (size_t s = 0; s < steps; ++s) {
+    batch.Step(time_step);
+    for (size_t i = 0; i < reference.size(); ++i) {
+      auto& rb = reference[i];
+      rb.AddForce(rb.m_ * batch.gravity_, {0, 0, 0});
+      rb.Update(time_step);
+      error = max(error, length(rb.GetCenter() - batch.GetCenter(i)));
+      error = max(error, length(rb.GetAngularMomentum() -
+                                batch.GetAngularMomentum(i)));
+      const auto q = rb.GetAttitude(), p = batch.GetAttitude(i);
+      error = max(error, 1.f - std::abs(dot(q, p)));
+    }
+  }
+  return error;
+}
+}  // namespace
+
+// Monte Carlo tumbling of independent boxes against the ground
+// proj3_ensemble [bodies] [steps] [size x y z]
+int main(int argc, char* argv[]) {
+  const auto n = argc > 1 ? std::stoul(argv[1]) : 10000UL;
+  const auto steps = argc > 2 ? std::stoul(argv[2]) : 600UL;
+  auto size = vec3{1.f};
+  if (argc > 5) size = {std::stof(argv[3]), std::stof(argv[4]), std::stof(argv[5])};
+  const auto bodies = Scene(n, size);
+
+  // Falling from y = 5 takes about 50 steps before any corner lands
+  std::cout << "Free flight deviation from RigidBody: "
+            << FreeFlightError(Scene(64, size), 40) << std::endl;
+
+  RigidBatch<1> scalar;
+  RigidBatch8 batch8;
+  RigidBatch16 batch16;
+  const auto seconds = std::array<float, 3>{Run(scalar, bodies, steps),
+                                            Run(batch8, bodies, steps),
+                                            Run(batch16, bodies, steps)};
+  const char* names[] = {"scalar", "8 lanes", "16 lanes"};
+  std::cout << std::setw(10) << "lanes" << std::setw(16) << "body steps/s"
+            << std::setw(10) << "speedup" << std::endl;
+  for (int i = 0; i < 3; ++i) {
+    std::cout << std::setw(10) << names[i] << std::setw(16)
+              << float(n * steps) / seconds[i] << std::setw(10)
+              << seconds[0] / seconds[i] << std::endl;
+  }
+
+  // Which face ends up on top, and how many are still moving
+  std::array<size_t, 6> faces{};
+  size_t moving = 0;
+  auto deviation = 0.f;
+  for (size_t i = 0; i < n; ++i) {
+    const auto R = mat3_cast(batch8.GetAttitude(i));
+    auto face = 0;
+    for (int j = 1; j < 3; ++j) {
+      if (std::abs(R[j].y) > std::abs(R[face].y)) face = j;
+    }
+    ++faces[face * 2 + (R[face].y < 0)];
+    moving += batch8.GetKineticEnergy(i) > 1E-3f;
+    deviation = max(deviation,
+                    length(batch8.GetCenter(i) - batch16.GetCenter(i)));
+  }
+  std::cout << "Face up (+x -x +y -y +z -z):";
+  for (const auto f : faces) std::cout << ' ' << f;
+  std::cout << "\nStill moving: " << moving << " of " << n
+            << "\n8 and 16 lanes differ by " << deviation << std::endl;
+}
@@ -0,0 +1,100 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "Arguments.hpp"
+#include "HeadlessRunner.hpp"
+#include "RigidScenes.hpp"
+#include "RigidWorld.hpp"
+
+namespace {
+const auto time_step = 1.f / 60;
+
+double CountContacts(const RigidWorld& world) {
+  double contacts = 0;
+  for (const auto& m : world.GetManifolds()) contacts += m.count;
+  return contacts;
+}
+}  // namespace
+
+// Steps a scene as fast as possible, without a window
+// proj3_headless [scene] [bodies] [steps] [threads]
+// PHYSIM_PERF=1 adds hardware counters of every pass, PHYSIM_METRICS=port
+// serves live metrics, PHYSIM_CHECKPOINT=file writes checkpoints and
+// PHYSIM_RESTORE=file resumes from one.
+int main(int argc, char* argv[]) {
+  std::string name = argc > 1 ? argv[1] : "tumble";
+  unsigned long count = 1000, steps = 600, threads = 0;
+  if (!ParseArgument(argc, argv, 2, count) ||
+      !ParseArgument(argc, argv, 3, steps) ||
+      !ParseArgument(argc, argv, 4, threads)) {
+    std::cerr << "Usage: proj3_headless [scene] [bodies] [steps] [threads]"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  HeadlessRunner runner("rigid");
+  RigidWorld world;
+  world.SetThreads(threads);
+  if (const auto restore = HeadlessRunner::RestorePath()) {
+    if (!runner.Restore(restore, [&](const CheckpointFile& file) {
+          return world.Load(file);
+        })) {
+      return EXIT_FAILURE;
+    }
+    name = restore;
+  } else if (!GetRigidScene(name, int(count), world)) {
+    std::cerr << "Unknown scene, one of:";
+    for (const auto& s : GetRigidSceneNames()) std::cerr << ' ' << s;
+    std::cerr << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::cout << "Scene: " << name << ", bodies: " << world.Size()
+            << ", threads: " << world.GetThreads() << std::endl;
+
+  const double bodies = world.Size();
+  auto& metrics = runner.GetMetrics();
+  metrics.GetGauge("physim_particles", "Particles or bodies").Set(bodies);
+  auto& awake = metrics.GetGauge("physim_awake_bodies", "Bodies not asleep");
+  auto& contacts = metrics.GetGauge("physim_contacts", "Contact points");
+  auto& max_velocity =
+      metrics.GetGauge("physim_max_velocity", "Fastest particle or body");
+
+  // Passes of RigidWorld::Step()
+  auto error = false;
+  const auto taken = runner.Run(
+      steps, time_step,
+      [&] {
+        runner.Pass("detect", "body", bodies,
+                    [&] { world.Detect(time_step); });
+        const auto step_contacts = CountContacts(world);
+        runner.Pass("solve", "contact", step_contacts,
+                    [&] { world.Solve(time_step); });
+        runner.Pass("integrate", "body", bodies,
+                    [&] { world.Integrate(time_step); });
+
+        auto fastest = 0.f;
+        for (const auto& rb : world.GetBodies()) {
+          fastest = std::max(fastest, glm::length(rb.GetLinearVelocity()));
+          error |= !std::isfinite(rb.GetCenter().y);
+        }
+        max_velocity.Set(fastest);
+        awake.Set(double(world.AwakeCount()));
+        contacts.Set(step_contacts);
+        return error;
+      },
+      [&](Checkpoint& checkpoint) { world.Save(checkpoint); });
+  const auto seconds = runner.GetSeconds();
+
+  std::cout << "Steps/s: " << taken / seconds << std::endl
+            << "Body steps/s: " << world.Size() * taken / seconds << std::endl
+            << "Awake: " << world.AwakeCount()
+            << ", manifolds: " << world.GetManifolds().size() << std::endl;
+  runner.PrintCounters(std::cout);
+  if (error) {
+    std::cerr << "Blown up after " << taken << " steps" << std::endl;
+    return EXIT_FAILURE;
+  }
+}
@@ -8,12 +8,20 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/euler_angles.hpp>
+#include <memory>
+#include <vector>
 
 #include "Axes.hpp"
 #include "Camera.hpp"
-#include "Collision.hpp"
+#include "DriverPanel.hpp"
+#include "Profiler.hpp"
+#include "ProfilerPanel.hpp"
 #include "RigidBody.hpp"
 #include "RigidBodyRenderer.hpp"
+#include "RigidWorld.hpp"
+#include "RigidScenes.hpp"
+#include "SimulationDriver.hpp"
+#include "TripleBuffer.hpp"
 
 using namespace glm;
 
@@ -24,20 +32,63 @@ auto center = vec3{0, 5, 0};
 auto yaw_pitch_roll = glm::vec3(0.f, 0.f, 0.f);
 auto size = vec3{1.f};
 auto L = vec3{0.f};
+auto boxes = 1;
+
+const auto time_step = 1.f / 60;
+
+// What the renderer and the control window need of a step
+struct Snapshot {
+  std::vector<RigidBody> bodies;
+  size_t pairs = 0, manifolds = 0, awake = 0, islands = 0;
+};
+
+// World settings edited in the control window, copied over by Apply()
+struct Settings {
+  float restitution, friction;
+  int iterations, threads;
+  bool warm_start, ccd, sleep;
+};
+
+// Touched by the simulation thread only, through the driver
+RigidWorld world;
+
+TripleBuffer<Snapshot> snapshots;
+std::unique_ptr<SimulationDriver> driver;
+Settings settings;
+
+void Publish() {
+  auto &snapshot = snapshots.Back();
+  snapshot.bodies = world.GetBodies();
+  snapshot.pairs = world.GetPairs().size();
+  snapshot.manifolds = world.GetManifolds().size();
+  snapshot.awake = world.AwakeCount();
+  snapshot.islands = world.GetIslands().Count();
+  snapshots.Publish();
+}
 
-const auto time_step = 1E-5f;
-
-RigidBody rb;
-Collision collision;
-RigidBodyRenderer renderer;
+void Apply() {
+  driver->Post([s = settings] {
+    world.solver_.eps_ = s.restitution;
+    world.solver_.mu_ = s.friction;
+    world.solver_.iterations_ = s.iterations;
+    world.solver_.warm_start_ = s.warm_start;
+    world.ccd_ = s.ccd;
+    world.sleep_ = s.sleep;
+    if (size_t(s.threads) != world.GetThreads()) {
+      world.SetThreads(size_t(s.threads));
+    }
+  });
+}
 
 void Restart() {
-  rb = RigidBody(
-      center,
+  const auto rotation =
       yawPitchRoll(radians(yaw_pitch_roll.x), radians(yaw_pitch_roll.y),
-                   radians(yaw_pitch_roll.z)),
-      L, size, 1.f);
-  renderer = RigidBodyRenderer(size);
+                   radians(yaw_pitch_roll.z));
+  driver->Post([boxes = boxes, center = center, rotation, L = L,
+                size = size] {
+    world.Clear();
+    AddColumns(world, boxes, center, rotation, L, size);
+  });
 }
 
 auto simulating = false;
@@ -91,12 +142,13 @@ void KeyCallback(GLFWwindow *window, int key, int scancode, int action,
   }
   if (key == GLFW_KEY_SPACE && action == GLFW_PRESS) {
     simulating = !simulating;
+    driver->SetRunning(simulating);
   }
   if (key == GLFW_KEY_R && action == GLFW_PRESS) {
     Restart();
   }
   if (key == GLFW_KEY_ENTER && action == GLFW_REPEAT) {
-    rb.Update(time_step);
+    driver->Step();
   }
 }
 
@@ -106,6 +158,12 @@ GLFWwindow *Initialize() {
     exit(EXIT_FAILURE);
   }
 
+  // Instanced drawing needs 4.5, which Mesa (llvmpipe too) only gives a core
+  // profile
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
   // GLFW window
   const auto window =
       glfwCreateWindow(640, 480, "Rigid Body", nullptr, nullptr);
@@ -153,9 +211,11 @@ void RenderUI() {
   ImGui::Separator();
   ImGui::Text("W, A, S, D to move camera");
   ImGui::Text("Hold left mouse button to rotate camera");
-  ImGui::Checkbox("Simulate (Space)", &simulating);
+  if (ImGui::Checkbox("Simulate (Space)", &simulating)) {
+    driver->SetRunning(simulating);
+  }
   if (ImGui::Button("Step (Enter)")) {
-    rb.Update(time_step);
+    driver->Step();
   }
   ImGui::SameLine();
   if (ImGui::Button("Restart (R)")) {
@@ -168,12 +228,29 @@ void RenderUI() {
       ImGui::SliderFloat3("original rotation", glm::value_ptr(yaw_pitch_roll),
                           -180.f, 180.f) |
       ImGui::SliderFloat3("original angular momentum", glm::value_ptr(L), -5.f,
-                          5.f)) {
+                          5.f) |
+      ImGui::SliderInt("Boxes", &boxes, 1, 10000)) {
     Restart();
   }
+  const auto &snapshot = snapshots.Front();
+  ImGui::Text("Candidate pairs: %zu, manifolds: %zu", snapshot.pairs,
+              snapshot.manifolds);
+  ImGui::Text("Awake: %zu, islands: %zu", snapshot.awake, snapshot.islands);
   ImGui::Separator();
-  ImGui::SliderFloat("Restitution", &collision.eps_, 0.f, 1.f);
-  ImGui::SliderFloat("Friction", &collision.mu_, 0.f, 1.5f);
+  if (ImGui::SliderFloat("Restitution", &settings.restitution, 0.f, 1.f) |
+      ImGui::SliderFloat("Friction", &settings.friction, 0.f, 1.5f) |
+      ImGui::SliderInt("Iterations", &settings.iterations, 1, 30) |
+      ImGui::Checkbox("Warm start", &settings.warm_start) |
+      ImGui::Checkbox("Continuous collision", &settings.ccd) |
+      ImGui::Checkbox("Sleep", &settings.sleep) |
+      ImGui::SliderInt("Threads", &settings.threads, 1,
+                       int(JobSystem::Global().Size()))) {
+    Apply();
+  }
+  ImGui::Separator();
+  DrawDriverPanel(*driver);
+  ImGui::Separator();
+  DrawProfilerPanel("RigidWorld::Step");
   ImGui::End();
 
   ImGui::Render();
@@ -183,38 +260,43 @@ void RenderUI() {
 }  // namespace
 
 int main() {
+  Profiler::SetThreadName("main");
   const auto window = Initialize();
 
-  Axes axes;
-  Restart();
+  {
+    // GL objects go before the context
+    Axes axes;
+    RigidBodyRenderer renderer;
+    settings = {world.solver_.eps_, world.solver_.mu_,
+                world.solver_.iterations_, int(world.GetThreads()),
+                world.solver_.warm_start_, world.ccd_, world.sleep_};
+    driver = std::make_unique<SimulationDriver>(
+        [](float dt) { world.Step(dt); }, Publish, time_step);
+    Restart();
 
-  auto last_time = glfwGetTime();
+    auto last_time = glfwGetTime();
 
-  // Rendering
-  glClearColor(0.f, 0.f, 0.f, 0.f);
-  glEnable(GL_DEPTH_TEST);
-  while (!glfwWindowShouldClose(window)) {
-    const auto dt = glfwGetTime() - last_time;
-    last_time = glfwGetTime();
+    // Rendering
+    glClearColor(0.f, 0.f, 0.f, 0.f);
+    glEnable(GL_DEPTH_TEST);
+    while (!glfwWindowShouldClose(window)) {
+      const auto dt = glfwGetTime() - last_time;
+      last_time = glfwGetTime();
 
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+      glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    camera.Update(dt);
-    // Do multiple physical simulation in one render loop
-    for (auto ddt = dt; simulating && ddt > 0.f; ddt -= time_step) {
-      rb.AddForce({0, -9.8f, 0}, {0, 0, 0});
-      collision.Compute(rb);
-      rb.Update(time_step);
-    }
-    renderer.Update(rb.GetTransform());
+      camera.Update(dt);
+      if (snapshots.Update()) renderer.Update(snapshots.Front().bodies);
 
-    axes.Draw(camera);
-    renderer.Draw(camera);
+      axes.Draw(camera);
+      renderer.Draw(camera);
 
-    RenderUI();
+      RenderUI();
 
-    glfwSwapBuffers(window);
-    glfwPollEvents();
+      glfwSwapBuffers(window);
+      glfwPollEvents();
+    }
+    driver.reset();
   }
 
   // Clean up
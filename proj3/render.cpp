@@ -0,0 +1,93 @@
+#include <glad/glad.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <glm/glm.hpp>
+#include <iostream>
+#include <string>
+
+#include "Arguments.hpp"
+#include "Axes.hpp"
+#include "Camera.hpp"
+#include "FrameRecorder.hpp"
+#include "OffscreenContext.hpp"
+#include "RigidBodyRenderer.hpp"
+#include "RigidScenes.hpp"
+#include "RigidWorld.hpp"
+
+namespace {
+// One step per frame, like the GUI at 60 Hz
+const auto time_step = 1.f / 60;
+
+// From above a corner of the scene's bounds, all of it in view
+Camera FrameScene(const RigidWorld& world, float width, float height) {
+  glm::vec3 lower(0.f), upper(0.f);
+  for (const auto& rb : world.GetBodies()) {
+    lower = glm::min(lower, rb.GetCenter());
+    upper = glm::max(upper, rb.GetCenter());
+  }
+  const auto center = glm::vec3((lower.x + upper.x) / 2, 0.f,
+                                (lower.z + upper.z) / 2);
+  const auto extent = glm::length(upper - lower) + 2.f;
+  return Camera(center + glm::vec3(-.7f, .6f, -.7f) * extent, center, width,
+                height);
+}
+}  // namespace
+
+// Renders a scene to frames at 60 per simulated second, without a window or
+// a display
+// proj3_render [scene] [bodies] [output] [frames]
+// output is a pattern like frames/%05d.png or a raw RGBA file, see
+// FrameRecorder. PHYSIM_RENDER_SIZE=WxH sets the frame size.
+int main(int argc, char *argv[]) {
+  const std::string name = argc > 1 ? argv[1] : "tumble";
+  const std::string output = argc > 3 ? argv[3] : "proj3_%05d.png";
+  unsigned long count = 100, frames = 300;
+  if (!ParseArgument(argc, argv, 2, count) ||
+      !ParseArgument(argc, argv, 4, frames)) {
+    std::cerr << "Usage: proj3_render [scene] [bodies] [output] [frames]"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  RigidWorld world;
+  if (!GetRigidScene(name, int(count), world)) {
+    std::cerr << "Unknown scene, one of:";
+    for (const auto &s : GetRigidSceneNames()) std::cerr << ' ' << s;
+    std::cerr << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  const OffscreenContext context;
+  if (!context) return EXIT_FAILURE;
+  const auto size = FrameRecorder::SizeFromEnvironment();
+  const auto camera = FrameScene(world, size.x, size.y);
+
+  // GL objects go before the context
+  Axes axes;
+  RigidBodyRenderer renderer;
+  FrameRecorder recorder(output, size.x, size.y);
+  if (recorder.GetError()) return EXIT_FAILURE;
+
+  glClearColor(0.f, 0.f, 0.f, 1.f);
+  glEnable(GL_DEPTH_TEST);
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t frame = 0; frame < frames; ++frame) {
+    world.Step(time_step);
+
+    recorder.Bind();
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    renderer.Update(world.GetBodies());
+    axes.Draw(camera);
+    renderer.Draw(camera);
+    recorder.Capture();
+  }
+  recorder.Finish();
+  const auto seconds =
+      std::chrono::duration<float>(std::chrono::steady_clock::now() - start)
+          .count();
+
+  std::cout << "Frames written: " << recorder.Written() << " of " << frames
+            << ", frames/s: " << frames / seconds << std::endl;
+  return recorder.GetError() ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -3,14 +3,23 @@
 layout (location = 0) in vec3 pos;
 layout (location = 1) in vec3 normal;
 
-uniform mat4 model;
+// Per instance
+layout (location = 2) in vec4 attitude;
+layout (location = 3) in vec3 center;
+layout (location = 4) in vec3 size;
+
 uniform mat4 view_proj;
 
 out vec3 vPos;
 out vec3 vNormal;
 
+vec3 Rotate(vec4 q, vec3 v) {
+    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
 void main() {
-    gl_Position = view_proj * model * vec4(pos, 1.0);
-    vPos = vec3(model * vec4(pos, 1.0));
-    vNormal = normal * mat3(inverse(model));
-}
\ No newline at end of file
+    vPos = center + Rotate(attitude, pos * size);
+    gl_Position = view_proj * vec4(vPos, 1.0);
+    // Faces are axis aligned, so scaling keeps their normals
+    vNormal = Rotate(attitude, normal);
+}